@@ -96,6 +96,7 @@ public:
     }
 private:
     //Double seqProbUnderModel(Matrix<Double> &patprob, char *s, int len, int frame); 
+    class EStepWorker;
 
 private:
     int k;                  // order of the HMM
@@ -73,4 +73,57 @@ private:
 
 void scaleDblVector(vector<Double>& v, Double sum);
 
+
+/*
+ * PatternCounter
+ * Counting the (k+1)-patterns of the training sequences for the content models takes most of
+ * the training time. The models therefore only register the sequence segments while they go
+ * through the training genes and the counting is done afterwards by count(), in several
+ * threads (option threads). Each thread counts a contiguous part of the segments, i.e. of the
+ * training genes, into count vectors of its own; these are then added to the count vectors
+ * of the model. The result is identical to the serial counting.
+ */
+class PatternCounter {
+public:
+    /*
+     * register the segment begin..end for counting the patterns ending at each position
+     * counts: array of numFrames count vectors, the first base is counted in frame 'frame'
+     *         and the frame increases by one with each base (modulo numFrames)
+     * basecount: array of numFrames numbers of counted bases
+     * withRC: count also the reverse complement of each pattern (twice the bases)
+     */
+    void add(vector<Integer> *counts, Integer *basecount, const char *begin, const char *end, int k, Integer weight,
+	     int numFrames = 1, int frame = 0, bool withRC = false){
+	if (begin > end)
+	    return;
+	Segment seg;
+	seg.counts = counts;
+	seg.basecount = basecount;
+	seg.begin = begin;
+	seg.end = end;
+	seg.k = k;
+	seg.weight = weight;
+	seg.numFrames = numFrames;
+	seg.frame = frame;
+	seg.withRC = withRC;
+	segments.push_back(seg);
+    }
+    // count all registered segments and forget them
+    void count();
+    int size() const { return segments.size(); }
+private:
+    struct Segment {
+	vector<Integer> *counts;
+	Integer *basecount;
+	const char *begin, *end;
+	int k;
+	Integer weight;
+	int numFrames, frame;
+	bool withRC;
+    };
+    class Worker;
+    static void countSegment(const Segment &seg, vector<Integer> *counts, Integer *basecount);
+    vector<Segment> segments;
+};
+
 #endif   // _COMMONTRAIN_HH
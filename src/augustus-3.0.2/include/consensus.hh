@@ -51,17 +51,17 @@ class consensus{
    * powers is the array used to store the powers 4 for caculating the character to int conversion and vice versa
    * tpm is the transition probabiliry matrix
    * var is the vector of structure sequence containing all the input sequences
-   * t_values is a flag array used to store the actuall frequencies of the patterns
-   * f_values stores the actual frequencies of the patterns
+   * f_values stores the actual frequencies of the patterns, i.e. the number of sequences they occur in
    * back_probs store the background probabilities
    * significant_strings and relevant_strings store the significant and relevant strings respectively
+   * num_threads is the number of threads that count the patterns in the input sequences
    */
-  int pattern_size,max_allowed_mismatch,number_seq,starting,ending,no_iterations;
+  int pattern_size,max_allowed_mismatch,number_seq,starting,ending,no_iterations,num_threads;
   float delta,p_value;
   vector<double> powers;
   float tpm[4][4];
   vector<sequence> var;
-  vector<int> t_values,f_values;
+  vector<int> f_values;
   vector<float> r_values,mean_values;
   float back_probs[4];
   vector<int> significant_strings,relevant_strings;
@@ -77,6 +77,14 @@ class consensus{
   int max_string_length;
   int max_freq;
 
+  /* counts the f values of all patterns in num_threads threads
+   */
+  void count_frequencies();
+  /* counts the occurrences of the given patterns at each position of the input sequences in num_threads threads,
+   * stores them in final_list and sets max_freq
+   */
+  void count_occurences(const vector<int> &patterns);
+
 public:
 
   consensus(int starting1,int ending1);
@@ -85,6 +93,9 @@ public:
    * to find the neighbours and the number of iterations n we want to perform to get the consensus patterns
    */
   void set_values(int pattern_size1,float p_value1, float delta1, int max_allowed_mismatch1,int n);
+  /* sets the number of threads used to count the patterns in the input sequences
+   */
+  void set_threads(int n);
 
   /* takes the file name to store the sequences
    */
@@ -131,10 +142,10 @@ public:
    */
   char num2char(int a);
   /* recursive function used by find_neighbours function to find k mismatch neighbours which uses the newly formed number
-   * the actual number for which we want the neighbours, number of mismatches k, length of pattern, object Seq2Int for
-   * performing the calculations and the vector where the new neighbours is to be stored
+   * the actual number for which we want the neighbours, number of mismatches k, length of pattern and the vector where
+   * the new neighbours is to be stored. The bases are changed directly in the 2 bits per base of the number.
    */
-  void k_mismatch(int new_m, int old_m, int k, int length,Seq2Int s2i,vector<int> &neighbours_index);
+  void k_mismatch(int new_m, int old_m, int k, int length,vector<int> &neighbours_index);
   /* returns a vector containing k mismatch neighbours of pattern with interger value m and length as specified
    */
   vector<int> find_neighbours(int m,int k, int length);
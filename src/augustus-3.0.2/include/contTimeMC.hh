@@ -34,7 +34,7 @@ using namespace std;
  */
 class Evo {
 public:
-    Evo(int s) : states(s), m(0) {};
+    Evo(int s) : states(s), m(0), matrixData(NULL), matrixRows(0), matrixCols(0) {};
     virtual ~Evo();
     int getNumStates(){return states;}
 
@@ -66,6 +66,21 @@ public:
 
 protected:
     int findClosestIndex(vector<double> &v, double val);
+    /*
+     * The matrices P and log P for all rows u and columns (times) v are stored in one
+     * contiguous array: first all P, then all log P, each matrix row-major and the matrices
+     * ordered by u, then v. allPs and allLogPs point to gsl_matrix views into this array.
+     * allocMatrices resizes the array and keeps the matrices that are still in range.
+     */
+    void allocMatrices(int rows, int cols);
+    void setMatrices(int u, int v, gsl_matrix *P, gsl_matrix *logP); // copies P and log P
+    /*
+     * binary on-disk cache of the matrices, in directory dir, for the parameters 'params'
+     * on which the matrices depend (including the times)
+     * readMatrixCache returns false if there is no file for exactly these parameters
+     */
+    bool readMatrixCache(string dir, string name, const vector<double> &params);
+    void writeMatrixCache(string dir, string name, const vector<double> &params);
 
 protected:
     int states; //number of states (64 in codon model and (currently) 2 in exon model)
@@ -74,6 +89,11 @@ protected:
     vector<double> times; // sorted vector of branch lengths
     Matrix<gsl_matrix *> allPs; // parametrized probability matrices
     Matrix<gsl_matrix *> allLogPs; // parametrized log probability matrices
+private:
+    string getMatrixCacheFile(string dir, string name, const vector<double> &params);
+    double *matrixData; // all P and log P, see allocMatrices
+    int matrixRows, matrixCols;
+    vector<gsl_matrix> matrixViews;
 };
 
 /*
@@ -139,6 +159,17 @@ public:
 			      int &subst); // output variables
     // for GRK proposal
     double graphOmegaOnCodonAli(vector<string> &seqtuple, PhyloTree *tree);
+    /*
+     * graphOmegaOnCodonAli for many codon alignments, Eomegas[a] is the estimate for seqtuples[a].
+     * The log likelihoods for all pairs of alignment and omega are computed in numThreads threads.
+     */
+    void graphOmegaOnCodonAlis(vector<vector<string> > &seqtuples, PhyloTree *tree,
+			       vector<double> &Eomegas, int numThreads = 1);
+    /*
+     * log likelihood of a set of codon tuples (e.g. the columns of a codon alignment) for the
+     * omega with index u. The pruning algorithm runs on all tuples at once.
+     */
+    double logLikOnCodonTuples(const vector<vector<int> > &tuples, PhyloTree *tree, int u);
     /* 
      * add new branch length b
      * this function is currently not needed, since the pruning algorithm does change the phylogenetic tree
@@ -146,6 +177,10 @@ public:
     void addBranchLength(double b){} 
 
 private:
+    // the columns of a codon alignment with at least 2 codons, as tuples of codons (64 = missing codon)
+    void getCodonTuples(vector<string> &seqtuple, PhyloTree *tree, vector<vector<int> > &tuples);
+    double posteriorMeanOmega(const vector<double> &logliks); // from the log likelihoods of all omegas
+
     int k; // number of different omega values for which P's are stored
     double kappa;
     vector<double> omegas; // sorted vector of omegas (contains values below, around and above 1)
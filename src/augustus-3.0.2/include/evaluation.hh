@@ -67,7 +67,12 @@ public:
   void finishEvaluation();
   void print();
   void printQuotients();
+  void add(Evaluation &other);      // add the counts of another evaluation, e.g. of another cross-validation fold
+  void write(ostream &out);         // write and read the counts in binary
+  void read(istream &in);
 private:
+  void getCounters(vector<int*> &counters);
+  void updateDerivedValues();
   /*
    * Quick evaluation is fast but requires that both gene lists 
    *
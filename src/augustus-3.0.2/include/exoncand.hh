@@ -88,8 +88,39 @@ public:
 
 list<ExonCandidate*> *findExonCands(const char *dna, int minLen=1, double assmotifqthresh=0.15, double assqthresh=0.3, double dssqthresh=0.7);
 
+// compare function to sort the exon candidates by start position, findExonCands returns them in this order
+bool compBegin (ExonCandidate* a, ExonCandidate* b);
+
 //computes the score for the splice sites of an exon candidate
 Double computeSpliceSiteScore(Double exonScore, Double minProb, Double maxProb); 
 
+/*
+ * ExonCandIndex
+ * The exon candidates of a sequence indexed by their right end and strand.
+ * For each right end the left ends (begin) of the candidates are stored
+ * in descending order in one array (compressed row storage), so the exon
+ * states can walk the candidate begins instead of all begins in the ORF.
+ * Candidates of different exon types with the same boundaries are stored once.
+ */
+class ExonCandIndex {
+public:
+    ExonCandIndex(list<ExonCandidate*> *cands, int n);
+    // sets [first, last) to the begins of the candidates ending at 'end' on the given strand
+    void getBegins(int end, bool plusStrand, const int* &first, const int* &last) const {
+	const vector<int> &offs = offsets[plusStrand? 0 : 1];
+	if (end < 0 || end >= n) {
+	    first = last = NULL;
+	    return;
+	}
+	first = &begins[plusStrand? 0 : 1][0] + offs[end];
+	last = &begins[plusStrand? 0 : 1][0] + offs[end+1];
+    }
+    int size() const {return begins[0].size() + begins[1].size();}
+private:
+    int n;                  // sequence length
+    vector<int> offsets[2]; // begins of the candidates ending at e are begins[s][offsets[s][e]] ... begins[s][offsets[s][e+1]-1]
+    vector<int> begins[2];  // 0: forward strand, 1: reverse strand
+};
+
 
 #endif  //  _EXONCAND_HH
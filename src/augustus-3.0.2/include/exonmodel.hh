@@ -21,6 +21,7 @@
 
 #include "statemodel.hh"
 
+class ExonCandIndex; // forward declaration, see exoncand.hh
 
 /*
  * The reading frame of an exon is the position of the nucleotide following the exon
@@ -86,15 +87,17 @@ public:
     Double endPartEmiProb(int end) const;
     Double notEndPartEmiProb(int beginOfStart, int right, int frameOfRight, Feature *exonparts) const;
     void initAlgorithms(Matrix<Double>&, int);
+    void useGCPars();
     static void storeGCPars(int idx);
 	
     // class functions
     static void init();
     static void resetPars() {
-	initAlgorithmsCalled = false;
+	haveGCPars = false;
     }
     static void readProbabilities(int parIndex);
     static void readAllParameters();
+    static void makeEmiTables();
     static double *getCodonUsage();
     static void resetModelCount(){exoncount = 0;};
     static int getMaxStateLen() { return Constant::max_exon_len + trans_init_window; }
@@ -102,8 +105,11 @@ public:
       if (orf)
 	delete orf;
       orf = new OpenReadingFrame(sequence, Constant::max_exon_len, dnalen);
-      initAlgorithmsCalled = false;
+      haveGCPars = false;
+      setExonCands(NULL); // candidates belong to the previous sequence
+      clearTransInitTracks();
     }
+    static void setExonCands(ExonCandIndex *cands);
 
 private:
     void processExons(const Gene* gene);
@@ -124,6 +130,9 @@ private:
     static void fillTailsOfLengthDistributions( );
     static int getBaseOffset(StateType type);
     static int getInnerPartEndOffset(StateType type);
+    static Double transInitProb(int pos, bool forwardStrand);
+    static Double computeTransInitProb(int pos, bool forwardStrand);
+    static void clearTransInitTracks();
 
     StateType        etype;
     Integer          win,                 // reading frame of this state (fixed)
@@ -152,6 +161,10 @@ private:
     static vector<Double>   **GCinitemiprobs;
     static vector<Double>   etemiprobs[3];
     static vector<Double>   **GCetemiprobs;
+    // single precision copies of GCemiprobs, GCinitemiprobs and GCetemiprobs for the algorithms,
+    // which use the current GC content class through the pointers cur*EmiTable
+    static FloatEmiTable    emiTable, initEmiTable, etEmiTable;
+    static const float      *curEmiTable, *curInitEmiTable, *curEtEmiTable;
     static vector<Integer>  numExonsOfType;
     static vector<Integer>  numHugeExonsOfType;  // number of exons exceeding the maximal length 
                                                  // modelled by the length distribution
@@ -163,6 +176,7 @@ private:
     static Integer numHugeSingle, numHugeInitial, numHugeInternal, numHugeTerminal; 
     static Matrix<vector<Double> > Pls;
     static Matrix<vector<Double> >* GCPls;    // array with one matrix per GC content class
+    static const Matrix<vector<Double> >* curPls;
     static Integer        exoncount;
     static Boolean        hasLenDist;
     static Integer        gesbasen[3];
@@ -179,6 +193,9 @@ private:
     static Motif          *GCtransInitMotif; // array for each GC content class
     static BinnedMMGroup  transInitBinProbs; // CRF-features based on transInitMotif
     static BinnedMMGroup  *GCtransInitBinProbs;// for all GC content classes
+    static const BinnedMMGroup *curTransInitBinProbs;
+    static MotifTrack     *transInitTrack;   // translation initiation probs of the current sequence
+    static MotifTrack     **GCtransInitTracks;// array, one for each GC content class
     static Integer        tis_motif_memory;  // order of the trans init motif
     static Integer        tis_motif_radius;  // radius for the smoothing of the trans init motif
     static Motif          **etMotif;         // weight matrices before the donor splice site (3 frames)
@@ -187,8 +204,9 @@ private:
     static Double         *modelStartProbs;
     static int            ilend;
     static OpenReadingFrame *orf;
+    static ExonCandIndex  *exonCands; // if not NULL, only exons with these boundaries are considered
     static int            ochrecount, ambercount, opalcount; // frequencies of the 3 stop codons
-    static bool           initAlgorithmsCalled, haveORF;
+    static bool           haveGCPars, haveORF;
     static int            lastParIndex; // GC-index of current parameter set   
     static int            verbosity;
     static list<string>   *tiswins; // holds translation initiation windows (for CRF training)
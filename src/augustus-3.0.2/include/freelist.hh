@@ -0,0 +1,59 @@
+/**********************************************************************
+ * file:    freelist.hh
+ * licence: Artistic Licence, see file LICENCE.TXT or
+ *          http://www.opensource.org/licenses/artistic-license.php
+ * descr.:  pooled allocation of small objects that are created and
+ *          destroyed in large numbers (State)
+ *
+ **********************************************************************/
+
+#ifndef _FREELIST_HH
+#define _FREELIST_HH
+
+#include <cstddef>
+#include <new>
+
+/*
+ * FreeListPool<T> hands out memory for objects of type T from blocks of OBJECTS_PER_BLOCK objects.
+ * Freed objects go to a free list and are reused by the next allocation, so the memory of the
+ * states of one sampled path or sequence is reused for the next one instead of going through
+ * malloc/free every time. Blocks are kept until the program ends.
+ * The free list is thread-local, so no locking is needed. An object may be freed in a different
+ * thread than the one that allocated it; its memory then goes to that thread's free list.
+ * Use it from the class-specific operator new/delete of T.
+ */
+template <class T, int OBJECTS_PER_BLOCK = 512>
+class FreeListPool {
+public:
+    static void *alloc() {
+	if (!freeList)
+	    newBlock();
+	Item *item = freeList;
+	freeList = item->next;
+	return item;
+    }
+    static void release(void *p) {
+	Item *item = static_cast<Item*>(p);
+	item->next = freeList;
+	freeList = item;
+    }
+private:
+    union Item {
+	Item *next;
+	char data[sizeof(T)];
+	double align; // same alignment as any member of T
+    };
+    static void newBlock() {
+	Item *block = static_cast<Item*>(::operator new(OBJECTS_PER_BLOCK * sizeof(Item)));
+	for (int i=0; i<OBJECTS_PER_BLOCK-1; i++)
+	    block[i].next = &block[i+1];
+	block[OBJECTS_PER_BLOCK-1].next = freeList;
+	freeList = block;
+    }
+    static __thread Item *freeList;
+};
+
+template <class T, int OBJECTS_PER_BLOCK>
+__thread typename FreeListPool<T, OBJECTS_PER_BLOCK>::Item *FreeListPool<T, OBJECTS_PER_BLOCK>::freeList = NULL;
+
+#endif // _FREELIST_HH
@@ -14,6 +14,7 @@
 #include "motif.hh"
 #include "pp_scoring.hh"
 #include "hints.hh"
+#include "freelist.hh"
 
 
 // Forward declarations
@@ -156,6 +157,18 @@ public:
   Strand strand() {return isOnFStrand(type)? plusstrand : minusstrand;}
   State *getBiologicalState();
   void setTruncFlag(int end, int predEnd, int dnalen);
+  // states are created and deleted by the million when sampling, take them from a free list
+  static void *operator new(size_t size) {
+      return (size == sizeof(State))? FreeListPool<State>::alloc() : ::operator new(size);
+  }
+  static void operator delete(void *p, size_t size) {
+      if (!p)
+	  return;
+      if (size == sizeof(State))
+	  FreeListPool<State>::release(p);
+      else
+	  ::operator delete(p);
+  }
 };
 
 bool frame_compatible(State *ex1, State* ex2);
@@ -312,9 +325,10 @@ public:
     void printProteinSeq(AnnoSequence *annoseq) const;
     void printBlockSequences(AnnoSequence *annoseq) const;
     void printEvidence();
-    void truncateMaskedUTR(AnnoSequence *annoseq);
+    void truncateMaskedUTR(const char *dna);
 
     static void init();
+    // the genes that pass the filter are moved from gl to the returned list
     static list<Gene> *filterGenePrediction(list<Gene> *gl, const char *seq, Strand strand, bool noInFrameStop, double minmeanexonintronprob=0.0, double minexonintronprob=0.0);
     static void filterTranscriptsByMaxTracks(list<Gene> *gl, int maxTracks);
     static Gene* getGenesOnStrand(Gene* genes, Strand strand);
@@ -420,12 +434,12 @@ Gene* getPtr(list<AltGene> *gl);
 void printGeneList(list<AltGene> *genelist, AnnoSequence *annoseq, bool withCS, bool withAA, bool withEvidence);
 void printGeneList(Gene* seq, AnnoSequence *annoseq, bool withCS, bool withAA);
 void printGeneSequence(Gene* seq, AnnoSequence *annoseq = NULL, bool withCS=false, bool withAA=true);
-list<Gene*>* sortGenePtrList(list<Gene*>);
+list<Gene*>* sortGenePtrList(const list<Gene*> &glist);
 list<AltGene> *reverseGeneList(list<AltGene> *altGeneList, int endpos);
 list<AltGene>* groupTranscriptsToGenes(list<Gene> *transcripts);
  
 void reverseGeneSequence(Gene* &seq, int endpos);
-void postProcessGenes(list<AltGene> *genes, AnnoSequence *annoseq);
+void postProcessGenes(list<AltGene> *genes, const char *dna);
 
 
 class Annotation {
@@ -534,6 +548,85 @@ public:
     int          weight;
 };
 
+/*
+ * StrandedDNA
+ * The DNA of one sequence on both strands, it does not own the forward strand.
+ * The reverse complement is built on first use and then shared by all pieces of the sequence.
+ */
+class StrandedDNA {
+public:
+    StrandedDNA(char *dna, int len) : forward(dna), reverse(NULL), length(len) {}
+    ~StrandedDNA(){
+	if (reverse)
+	    delete [] reverse;
+    }
+    char *getStrand(Strand strand){
+	if (strand != minusstrand)
+	    return forward;
+	if (!reverse)
+	    reverse = reverseComplement(forward);
+	return reverse;
+    }
+    int getLength() const {return length;}
+private:
+    StrandedDNA(const StrandedDNA&);
+    StrandedDNA& operator=(const StrandedDNA&);
+    char *forward;
+    char *reverse;
+    int length;
+};
+
+/*
+ * DNAView
+ * Non-owning view on the piece begin..end (forward strand coordinates) of a sequence,
+ * read on the given strand. Pieces are not copied: on the minus strand the view points
+ * into the shared reverse complement of StrandedDNA.
+ * While the view exists the base behind the piece is replaced by '\0' so that the
+ * prediction code can use the view as a C string. The destructor restores the base,
+ * so nested views must be destroyed in the reverse order of their construction.
+ */
+class DNAView {
+public:
+    DNAView(StrandedDNA &dna, int begin, int end, Strand strand, int offset = 0) :
+	length(end - begin + 1),
+	offset(offset),
+	strand(strand)
+    {
+	if (strand == minusstrand)
+	    terminate(dna.getStrand(minusstrand) + dna.getLength() - 1 - end);
+	else
+	    terminate(dna.getStrand(plusstrand) + begin);
+    }
+    // the piece begin..end of another view, in the coordinates of that view
+    DNAView(const DNAView &outer, int begin, int end) :
+	length(end - begin + 1),
+	offset(outer.offset + begin),
+	strand(outer.strand)
+    {
+	terminate(outer.sequence + begin);
+    }
+    ~DNAView(){
+	sequence[length] = saved;
+    }
+    const char *getSequence() const {return sequence;}
+    int getLength() const {return length;}
+    int getOffset() const {return offset;}
+    Strand getStrand() const {return strand;}
+private:
+    DNAView(const DNAView&);
+    DNAView& operator=(const DNAView&);
+    void terminate(char *start){
+	sequence = start;
+	saved = sequence[length];
+	sequence[length] = '\0';
+    }
+    char *sequence;
+    int length;
+    int offset; // position of the first base in the original input sequence, as in AnnoSequence
+    Strand strand;
+    char saved; // the base behind the piece
+};
+
 class AnnoSeqGeneIterator {
 public:
   AnnoSeqGeneIterator(const AnnoSequence* annoseqHead){
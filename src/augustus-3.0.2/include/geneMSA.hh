@@ -20,6 +20,7 @@
 
 //forward declarations
 class OrthoGraph;
+class NAMGene;
 
 class GeneMSA {
 public:
@@ -48,7 +49,7 @@ public:
      * that have a pattern, such that 5% of true splice site patterns have lower probability.
      * The default threshold of 0 means that all splice site patterns are considered.
      */
-    void createExonCands(int s, const char *dna);
+    void createExonCands(int s, const char *dna, NAMGene &namgene);
 
     /**
      * find all ortholog exon candidates, that are present in at least max(2, consThresh * m)
@@ -65,7 +66,7 @@ public:
     void printGeneRanges();
     void printExonCands();
     void printOrthoExons(RandSeqAccess *rsa);
-    void computeOmegas(vector<AnnoSequence> const &seqRanges);
+    void computeOmegas(vector<AnnoSequence> const &seqRanges, int numThreads = 1);
 
     // calculate a columnwise conservation score and output it (for each species) in wiggle format
     void printConsScore(vector<AnnoSequence> const &seqRanges);
@@ -78,6 +79,7 @@ public:
     static int numSpecies(){ return tree->numSpecies(); }
     static void openOutputFiles();
     static void closeOutputFiles();
+    static void flushOutputFiles();
 
     // static data members
     static int padding; // add this many bases to the region before and after the aligned region
@@ -16,6 +16,7 @@
 #include "randseqaccess.hh"
 #include <boost/graph/adjacency_list.hpp>
 #include <boost/graph/depth_first_search.hpp>
+#include <climits>
 
 #define NUMCOLNAMES 32
 const string colornames[NUMCOLNAMES] = {"aquamarine", "darksalmon", "gainsboro", "gold", "cadetblue", "yellowgreen",
@@ -72,16 +73,82 @@ public:
 
 
 
+/*
+ * a row of a .maf alignment block as it is in the file
+ */
+struct MafRow {
+    string completeName; // species name and sequence ID, e.g. hg19.chr21
+    int chrStart;
+    int seqLen;
+    char strandChar;
+    int lenOfChr;
+    string rowseq;
+    // start and end (exclusive) on the forward strand, 0-based
+    int plusStart() const { return (strandChar == '-')? lenOfChr - chrStart - seqLen : chrStart; }
+    int plusEnd() const { return plusStart() + seqLen; }
+};
+
+/*
+ * reads the next alignment block of a .maf file, false at the end of the file
+ * A block starts with an 'a' line or an 's' line and ends with an empty line. Other lines
+ * (e.g. 'i', 'e' and 'q' lines) are skipped. 'offset' is the position of the first line of the block.
+ */
+bool readMafBlock(istream &in, vector<MafRow> &rows, streamoff &offset);
+
+/*
+ * a part of a .maf file: the alignment blocks whose first row is on sequence seqname
+ * (e.g. hg19.chr21) and overlaps the range [start, end) of the forward strand, 0-based
+ */
+struct MafRegion {
+    MafRegion(string name = "", int s = 0, int e = INT_MAX) : seqname(name), start(s), end(e) {}
+    string seqname;
+    int start, end;
+};
+
+/*
+ * MafIndex
+ * Index of a .maf file for reading only the blocks of a region (see MafRegion). Consecutive blocks
+ * whose first rows are on the same sequence are grouped into bins of at most BINSIZE blocks.
+ * For each bin the index holds the sequence, the range covered by the first rows and the byte range
+ * in the file. It is built in one pass over the file and stored in the file alignFilename.idx,
+ * where it is read from the next time, unless the .maf file is newer.
+ */
+struct MafBin {
+    string seqname;
+    int start, end;        // range of the first rows of the blocks, as in MafRegion
+    streamoff begin, stop; // byte range in the file
+};
+
+class MafIndex {
+public:
+    MafIndex(string alignFilename);
+    void getBins(const MafRegion &region, vector<MafBin> &result) const; // bins that may contain blocks of the region
+    vector<string> getSeqNames() const { return seqnames; } // sequences of the first rows in the order of the file
+    static const int BINSIZE = 1000;
+private:
+    bool read(string indexFilename, string alignFilename);
+    void build(string alignFilename);
+    void write(string indexFilename) const;
+    vector<MafBin> bins;
+    vector<string> seqnames;
+};
+
 // use funcion overloading on this as the STL list cannot delete from normal and reverse iterators in the same way
 void eraseListRange(list<int> L, list<int>::reverse_iterator from, list<int>::reverse_iterator to);
 void eraseListRange(list<int> L, list<int>::iterator from, list<int>::iterator to);
 
 class GenomicMSA {
 public:
-    GenomicMSA(RandSeqAccess *rsa_) : rsa(rsa_){}
-   ~GenomicMSA(){}
+    GenomicMSA(RandSeqAccess *rsa_) : rsa(rsa_), mafIndex(NULL) {}
+   ~GenomicMSA(){ delete mafIndex; }
 
     void readAlignment(string alignFilename); // reads a multiple species alignment from a *.maf file
+    /*
+     * reads only the blocks of a region, using the index of the file (see MafIndex)
+     * The alignments of a previous region must have been taken with getNextGene.
+     */
+    void readAlignment(string alignFilename, const MafRegion &region);
+    vector<string> getMafSeqNames(string alignFilename); // sequences of the first rows of the blocks
     void printAlignment(string outFname); // print alignment in .maf format, to stdout if outFname is empty string
     int numAlignments() { return alignment.size(); }
  
@@ -127,9 +194,15 @@ public:
     static int weight(const Alignment *a, const Alignment *b, const MsaSignature *sig); // edge weight after projection to sig
 
 private:
+    // adds the alignment made of the rows of a .maf block, species that are not in the tree are noted in notExistingSpecies
+    void addMafBlock(const vector<MafRow> &mafrows, map<string, size_t> &notExistingSpecies);
+    void warnNotExistingSpecies(const map<string, size_t> &notExistingSpecies);
+    MafIndex *getMafIndex(string alignFilename);
+
     list<Alignment*> alignment;
     int numSpecies;
     RandSeqAccess *rsa; // the actual data is manages in CompGenePred
+    MafIndex *mafIndex; // built when a region is read the first time
     map<string, MsaSignature> signatures;
     static int maxIntronLen;
     static int minGeneLen;
@@ -27,6 +27,7 @@ enum NodeType{NOT_KNOWN=-1, IR, plus0, plus1, plus2, minus0, minus1, minus2, T_p
 extern string nodeTypeIdentifiers[NUM_NODETYPES];
 
 class Status;
+class NodeKey;
 class Node;
 class Edge;
 class Graph;
@@ -52,6 +53,28 @@ public:
     const void *item;
 };
 
+/*
+ * NodeKey identifies a node by integers only, which is much cheaper to build and compare than a string:
+ * exons are identified by (begin, end, StateType), neutral nodes by (begin, -1, NodeType)
+ */
+
+class NodeKey{
+public:
+    NodeKey(int b=0, int e=0, int t=0):
+	begin(b),
+	end(e),
+	type(t)
+    {}
+    bool operator<(const NodeKey &other) const {
+	if (begin != other.begin)
+	    return begin < other.begin;
+	if (end != other.end)
+	    return end < other.end;
+	return type < other.type;
+    }
+    int begin, end, type;
+};
+
 class Node{
 public:
     Node(int s=0, int e=0, double sc=0.0, const void *it=NULL, NodeType t=NOT_KNOWN, Node *p=NULL, bool b=0, Node *n=NULL, Node *r=NULL):
@@ -63,7 +86,8 @@ public:
 	pred(p),
 	label(b),
 	topSort_next(n),
-	topSort_pred(r)
+	topSort_pred(r),
+	id(-1)
     {}
     int begin, end;
     double score;
@@ -73,6 +97,7 @@ public:
     bool label;           // label is 1, if node is in path, else label is 0
     Node *topSort_next;   // pointer to next node in a topologically sorted list of nodes
     Node *topSort_pred;   // pointer to previous node in a topologically sorted list of nodes
+    int id;               // position in Graph::nodes, set by Graph::buildCSR()
     list<Edge> edges;
 
     StateType castToStateType(); //casts void* back to State* and returns the StateType
@@ -94,9 +119,10 @@ public:
     const void *item;
 };
 
-//print functions for Nodes and Edges
+//print functions for Nodes, Edges and keys
 ostream& operator<<(ostream& ostrm, Node *node);
 ostream& operator<<(ostream& ostrm, const Edge &edge);
+ostream& operator<<(ostream& ostrm, const NodeKey &key);
 
 /*
  * ordering needed by statelist: 
@@ -114,17 +140,29 @@ public:
     list<Node*> nodelist;      //stores all nodes belonging to the graph
     list<Status> *statelist;
     int min, max;
-    map<string,Node*> existingNodes;
+    map<NodeKey,Node*> existingNodes;
     Node *head;
     Node *tail;
+
+    /*
+     * compressed sparse row copy of the graph for the path search:
+     * the outgoing edges of node nodes[i] are edgeTo[k], edgeScore[k] for edgeOffset[i] <= k < edgeOffset[i+1]
+     * in the order of Node::edges. Has to be rebuilt with buildCSR() after edges were added.
+     */
+    vector<Node*> nodes;
+    vector<int> edgeOffset;
+    vector<int> edgeTo;
+    vector<double> edgeScore;
  
     void buildGraph(); //needs to be called in constructor of derived class
+    void buildCSR();   // numbers the nodes in the order of nodelist and fills the arrays above
 
     template<class T> inline bool alreadyProcessed(T *temp){
-	return(existingNodes[getKey(temp)]!=NULL);    
+	return(getNode(temp)!=NULL);    
     }
     template<class T> inline Node* getNode(T *temp){
-	return existingNodes[getKey(temp)];
+	map<NodeKey,Node*>::iterator it = existingNodes.find(getKey(temp));
+	return (it != existingNodes.end())? it->second : NULL;
     }
 
     // functions needed to build the graph
@@ -139,7 +177,6 @@ protected:
     void addCompatibleEdges();
     void insertIntron(Node *exon1, Node *exon2);  
     int minInQueue(queue<Node*> *q);
-    bool nonneutralIncomingEdge(Node *exon);
     void printGraphToShell();
     void getSizeNeutralLine();
     void addWeightToEdge();
@@ -147,14 +184,20 @@ protected:
     // program specific functions
     virtual bool exonAtGeneStart(Status *st)=0;
     virtual bool exonAtGeneEnd(Status *st)=0;
-    virtual string getKey(Node *n)=0;
-    virtual string getKey(Status *st)=0;
-    virtual string getKey(State *st)=0;
-    virtual string getKey(ExonCandidate *exoncand)=0;
+    virtual NodeKey getKey(Node *n)=0;
+    virtual NodeKey getKey(Status *st)=0;
+    virtual NodeKey getKey(State *st)=0;
+    virtual NodeKey getKey(ExonCandidate *exoncand)=0;
     virtual double getIntronScore(Status *predExon, Status *nextExon)=0;
     virtual void addEdgeFromHead(Status *exon)=0;
     virtual void addEdgeToTail(Status *exon)=0; 
     virtual bool compatible(Node *exon1, Node *exon2)=0;
+    /*
+     * classes for the sweep in addCompatibleEdges(): if exon2 does not begin directly behind exon1 then
+     * compatible(exon1, exon2) implies that successorClass(exon2) is one of targetClasses(exon1)
+     */
+    virtual int successorClass(Node *exon)=0;
+    virtual void targetClasses(Node *exon, vector<int> &classes)=0;
     virtual double setScore(Status *st)=0;
     virtual void calculateBaseScores()=0;
     virtual void printGraph(string filename)=0;   
@@ -260,14 +303,16 @@ public:
     bool exonAtGeneEnd(Status *st);
     bool exonAtCodingStart(Node *st);
     bool exonAtCodingEnd(Node *st);
-    string getKey(Node *n);
-    string getKey(Status *st);
-    string getKey(State *st);
-    string getKey(ExonCandidate *exoncand);
+    NodeKey getKey(Node *n);
+    NodeKey getKey(Status *st);
+    NodeKey getKey(State *st);
+    NodeKey getKey(ExonCandidate *exoncand);
     double getIntronScore(Status *predExon, Status *nextExon);  
     void addEdgeFromHead(Status *exon);
     void addEdgeToTail(Status *exon);
     bool compatible(Node *exon1, Node *exon2);
+    int successorClass(Node *exon);
+    void targetClasses(Node *exon, vector<int> &classes);
     bool sameStrand(StateType typeA, StateType typeB);
     bool sameReadingFrame(Node *e1, Node *e2);
     void calculateBaseScores();
@@ -42,6 +42,7 @@ public:
     void printProbabilities ( int zusNumber, BaseCount *bc, const char* suffix = NULL );
 
     void initAlgorithms     ( Matrix<Double>&, int);
+    void useGCPars          ( );
     void viterbiForwardAndSampling(ViterbiMatrixType&, ViterbiMatrixType&, int, int,
 				   AlgorithmVariant, OptionListItem&) const;
     Double emiProbUnderModel(int begin, int end) const;
@@ -52,6 +53,7 @@ public:
     static void resetPars() {}
     static void readProbabilities(int zusNumber);
     static void readAllParameters();
+    static void makeEmiTables();
     static void storeGCPars(int idx);
     static double getGeoProb(){return geoProb;}
 private:
@@ -60,6 +62,8 @@ public:
   static Integer         k;           // UTR intron and intron
   static PatMMGroup      emiprobs;    // can use this data.
   static PatMMGroup      *GCemiprobs; // array for each GC content class
+  static FloatEmiTable   emiTable;    // single precision copy of GCemiprobs for the algorithms
+  static const float     *curEmiTable; // emission probabilities of the current GC content class
 private:
   Integer                gweight;
   static Double          patpseudocount;
@@ -67,6 +71,7 @@ private:
   static vector<Integer> emicount;
   static vector<vector<Double> > Pls;
   static vector<vector<Double> >* GCPls;
+  static const vector<vector<Double> >* curPls;
   static int             lastParIndex; // GC-index of current parameter set
   static int             verbosity;
   static double          geoProb;
@@ -49,6 +49,7 @@ public:
      */
     void printProbabilities( int parIndex, BaseCount *bc, const char* suffix = NULL );
     void initAlgorithms(Matrix<Double>&, int);
+    void useGCPars();
     void viterbiForwardAndSampling(ViterbiMatrixType&, ViterbiMatrixType&, int, int, 
 				   AlgorithmVariant, OptionListItem&) const;
     Double emiProbUnderModel  (int begin, int end) const;
@@ -59,11 +60,13 @@ public:
     static void resetPars() {
 	if (!haveSnippetProbs) 
 	    initSnippetProbs();
-	initAlgorithmsCalled = false;
+	haveGCPars = false;
     }
+    static void clearSnippetProbs() { haveSnippetProbs = false; } // at the start of a new sequence
   	
     static void readProbabilities(int parIndex);
     static void readAllParameters();
+    static void makeEmiTables();
     static void updateParameters(int idx);
     static void storeGCPars(int idx);
     static Integer getD() {return d;}
@@ -72,6 +75,8 @@ public:
     static Double getAssMotifProbThreshold(double q) {return assMotif->getProbThreshold(q);}
 private:
     static void initSnippetProbs();
+    static Double computeDSSProb(int base, bool forwardStrand);
+    static Double computeASSProb(int base, bool forwardStrand);
     void processSequence( const char* start, const char* end);
     /**
      *
@@ -90,6 +95,8 @@ public:
     static Integer         k;
     static PatMMGroup      emiprobs;
     static PatMMGroup      *GCemiprobs;
+    static FloatEmiTable   emiTable;    // single precision copy of GCemiprobs for the algorithms
+    static const float     *curEmiTable; // emiTable of the current GC content class
     static BinnedMMGroup   dssBinProbs;
     static BinnedMMGroup   assBinProbs;
 private:
@@ -130,7 +137,10 @@ private:
     static double          non_gt_dss_prob;
     static double          non_ag_ass_prob;
     static SnippetProbs    *snippetProbs, *rSnippetProbs;  
-    static bool            initAlgorithmsCalled, haveSnippetProbs;
+    static SnippetProbs    **GCsnippetProbs, **GCrSnippetProbs; // arrays, one for each GC content class
+    static MotifTrack      *assTrack, *dssTrack; // splice site probs of the current sequence
+    static MotifTrack      **GCassTracks;        // array, one for each GC content class (the ass motif depends on it)
+    static bool            haveGCPars, haveSnippetProbs;
     static int             lastParIndex; // GC-index of current parameter set
     static Integer         verbosity;
     static double          geoProb;
@@ -15,7 +15,7 @@ void addToList(State *st, Statename name, list<Status> *slist);
 bool compareStatus(Status first, Status second);
 bool compareGenes(Gene first, Gene second);
 void printStatelist(list<Status> *list);
-void getMeaGenelist(list<Node*> meaPath, list<Gene> *meaGenes);
+void getMeaGenelist(const list<Node*> &meaPath, list<Gene> *meaGenes);
 void addExonToGene(Gene *gene, State *exon);
 void addIntronToGene(Gene *gene, Node *predExon, Node *succExon);
 StateType getIntronStateType(State *exon1, State *exon2);
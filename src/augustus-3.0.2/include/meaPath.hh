@@ -1,6 +1,10 @@
 #ifndef _MEAPATH_HH
 #define _MEAPATH_HH
 
+/*
+ * the path search works on the integer node ids and the compressed sparse row edges of the graph (Graph::buildCSR())
+ */
+
 class MEApath{
 public:
   MEApath(AugustusGraph *g):graph(g){}
@@ -8,16 +12,16 @@ public:
 
   void findMEApath();
   void getTopologicalOrdering();
-  void dfs(Node *n);
+  void dfs(int start);
   void relax();
   void backtracking();
-  inline list<Node*> getPath(){
+  inline const list<Node*> &getPath() const {
     return meaPath;
   }
 private:
   AugustusGraph *graph;
-  vector<Node*> topSort;  // reverse topological ordering of nodelist starting with tail
-  map<string,Node*> processed;
+  vector<int> topSort;  // reverse topological ordering of the node ids starting with tail
+  vector<bool> processed;
   list<Node*> meaPath;
 };
 
@@ -138,7 +138,7 @@ public:
 	setProperties();
     }
     BaseCount getBaseCount(int i);
-    int getNearestBaseCountIndex(BaseCount bc);
+    int getNearestBaseCountIndex(const BaseCount &bc);
 private:
     void setProperties();
     void makeDecomposition();
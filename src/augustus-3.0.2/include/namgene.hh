@@ -18,6 +18,7 @@
 #include "pp_scoring.hh"
 #include "statemodel.hh"
 
+class ExonCandidate;
 
 class NAMGeneError : public ProjectError {
 public:
@@ -28,7 +29,7 @@ public:
 class NAMGene {
 public:
     NAMGene();
-    ~NAMGene() {}
+    ~NAMGene() { delete [] GCtransitions; }
 
     void readModelProbabilities( int number = 1);
     StatePath* getSampledPath(const char *dna, const char* seqname = NULL);
@@ -74,6 +75,9 @@ public:
     void setPathAndProb(AnnoSequence *annoseq, FeatureCollection &extrinsicFeatures);
     list<Gene> *getAllTranscripts() {return sampledTxs;}
     void getPrepareModels(const char *dna, int len) {prepareModels(dna, len);}
+    // exon candidates of dna (after getPrepareModels), each found with the splice site models of its GC content class
+    list<ExonCandidate*> *getExonCands(const char *dna, int minLen, double assmotifqthresh, double assqthresh, double dssqthresh);
+    void printBeamCheck();
 private:
     /**
      * Start the viterbi algorithm with the given DNA sequence.
@@ -81,12 +85,14 @@ private:
      * @param   dna The DNA sequence to be used in the algorithm.
      * @return   the viterbi path
      */
-    void viterbiAndForward(const char* dna, bool useProfile=false);
+    void viterbiAndForward(const char* dna, bool useProfile=false, bool noBeam=false);
+    void setColumnBest(int j);
+    void setExonCands(const char* dna, int dnalen);
     
     /*
      * repeatedly do the viterbi algorithm on pieces of dna, no strands
      */
-    list<AltGene>* getStepGenes(AnnoSequence *annoseq, SequenceFeatureCollection& sfc, Strand strand, bool onlyViterbi=true);
+    list<AltGene>* getStepGenes(const DNAView &piece, SequenceFeatureCollection& sfc, Strand strand, bool onlyViterbi=true);
 
     list<AltGene>* findGenes(const char *dna, Strand strand, bool onlyViterbi=true);
     int getNextCutEndPoint(const char *dna, int beginPos, int maxstep, SequenceFeatureCollection& sfc);
@@ -112,6 +118,10 @@ private:
     ViterbiMatrixType      viterbi; 
     /// @doc The transitions matrix.
     Matrix<Double>      transitions;
+    /// @doc The transitions matrix as corrected by the states, one for each GC content class
+    Matrix<Double>      *GCtransitions;
+    /// @doc whether GCtransitions and the predecessor lists are set up for the current sequence
+    vector<bool>        haveGCtransitions;
     /// @doc The initial probabilities
     vector<Double>      initProbs;
     /// @doc The initial probabilities
@@ -124,6 +134,12 @@ private:
     Integer             statecount;
     /// @doc mapping from state numbers to state types
     vector<StateType>   stateMap;
+    /// @doc compare the beam pruned with the exact Viterbi path (option beamCheck)
+    bool beamCheck;
+    int beamChecked, beamChanged;
+    /// @doc restrict the exons to the candidates from findExonCands (option exoncand)
+    bool exonCands;
+    double ecAssMotifQthresh, ecAssQthresh, ecDssQthresh;
     /// @doc index of the parameters read into the models (based on sequence composition)
     int                 lastParIndex;
     /// overlap length distributions for bacterial model
@@ -15,6 +15,9 @@
 #include "orthoexon.hh"
 #include "phylotree.hh"
 
+// standard C/C++ includes
+#include <stdint.h>
+
 class OrthoGraph{
 
 public:
@@ -106,24 +109,42 @@ struct Score{
  * 0 if the exon in the i-th species has label 0
  * 1 if the exon in the i-th species has label 1
  * 2 if exon in the i-th species does not exist
+ *
+ * The patterns are stored as keys with 2 bits per species, so at most MAXSPECIES species.
+ * With more species nothing is cached. The cache holds at most maxSize patterns; when it is
+ * full, the least recently used pattern is removed. It is split into shards with a lock each,
+ * so that it can be used by several threads.
  */
 
 namespace cache{
 
-    extern map<string, Score> labelscore;
+    typedef uint64_t Key;
+    const int MAXSPECIES = 4 * sizeof(Key);
+    const int NUMSHARDS = 16;
+    void init(size_t numSpecies, size_t maxSize);
     /*
      * cache functions
      */
     bool inHash(string labelpattern);
+    bool lookup(string labelpattern, double &score); // false if the pattern is not in the cache
     void resetCounter();
     void addToHash(string labelpattern, double score);
     double getScore(string labelpattern);
     void incrementCounter(string labelpattern);
+    void getEntries(vector<pair<string, Score> > &entries); // sorted by label pattern
+    /*
+     * statistics: number of lookups that found the pattern (hits) or not (misses)
+     * and number of patterns removed because the cache was full
+     */
+    void getStatistics(long &hits, long &misses, long &evictions);
+    void setStatistics(long hits, long misses, long evictions);
+    void printStatistics();
 }
 
 //functions to redirect filestreams
 vector<ofstream*> initOutputFiles(string extension = string());
 void closeOutputFiles(vector<ofstream*> filestreams);
+void flushOutputFiles(const vector<ofstream*> &filestreams);
 
 
 #endif
@@ -0,0 +1,324 @@
+/**********************************************************************
+ * file:    parallel.hh
+ * licence: Artistic Licence, see file LICENCE.TXT or
+ *          http://www.opensource.org/licenses/artistic-license.php
+ * descr.:  running independent pieces of work in several threads
+ *
+ **********************************************************************/
+
+#ifndef _PARALLEL_HH
+#define _PARALLEL_HH
+
+// project includes
+#include "properties.hh"
+
+// standard C/C++ includes
+#include <vector>
+#include <string>
+#include <sstream>
+#include <iostream>
+#include <boost/thread.hpp>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <signal.h>
+
+/*
+ * number of threads, from the option 'threads' (default 1)
+ */
+inline int getNumThreads(){
+    int numThreads = 1;
+    try {
+	numThreads = Properties::getIntProperty("threads");
+    } catch (...) {}
+    return (numThreads < 1)? 1 : numThreads;
+}
+
+/*
+ * calls a worker and keeps the message of a ProjectError it throws,
+ * as exceptions must not leave a thread
+ */
+template <class Worker>
+class GuardedWorker {
+public:
+    GuardedWorker(Worker *w) : worker(w), failed(false) {}
+    void operator()() {
+	try {
+	    (*worker)();
+	} catch (ProjectError &e) {
+	    failed = true;
+	    message = e.getMessage();
+	} catch (...) {
+	    failed = true;
+	    message = "unknown error in worker thread";
+	}
+    }
+    Worker *worker;
+    bool failed;
+    string message;
+};
+
+/*
+ * runInThreads
+ * Calls operator() of each worker in a thread of its own and waits until all are done.
+ * A single worker is called directly. A ProjectError of a worker is thrown again
+ * in the calling thread after all threads have finished.
+ */
+template <class Worker>
+void runInThreads(vector<Worker> &workers){
+    if (workers.size() == 1) {
+	workers[0]();
+	return;
+    }
+    vector<GuardedWorker<Worker> > guards;
+    for (int i=0; i < workers.size(); i++)
+	guards.push_back(GuardedWorker<Worker>(&workers[i]));
+    boost::thread_group group;
+    for (int i=0; i < guards.size(); i++)
+	group.create_thread(boost::ref(guards[i]));
+    group.join_all();
+    for (int i=0; i < guards.size(); i++)
+	if (guards[i].failed)
+	    throw ProjectError(guards[i].message);
+}
+
+/*
+ * writes all of s to the file descriptor fd, false if this is not possible
+ */
+inline bool writeToPipe(int fd, const string &s){
+    const char *buf = s.data();
+    size_t left = s.size();
+    while (left > 0) {
+	ssize_t n = ::write(fd, buf, left);
+	if (n <= 0)
+	    return false;
+	buf += n;
+	left -= n;
+    }
+    return true;
+}
+
+/*
+ * reads from the file descriptor fd until the end
+ */
+inline string readFromPipe(int fd){
+    string in;
+    char buf[65536];
+    ssize_t n;
+    while ((n = ::read(fd, buf, sizeof(buf))) > 0)
+	in.append(buf, n);
+    return in;
+}
+
+/*
+ * a worker process sends whether it succeeded, what it wrote to cout and its
+ * result (or error message) to the parent and terminates
+ */
+inline void sendJobResult(int fd, bool ok, const string &log, const string &text){
+    string out(1, ok? 1 : 0);
+    size_t loglen = log.size();
+    out.append((const char*) &loglen, sizeof(loglen));
+    out += log;
+    out += text;
+    if (!writeToPipe(fd, out))
+	_exit(1);
+    close(fd);
+    _exit(0);
+}
+
+/*
+ * the parent receives what sendJobResult sent, prints the log and returns the result in text
+ * false if the worker failed, then text is the error message
+ */
+inline bool receiveJobResult(int fd, pid_t pid, string &text, const string &caller){
+    string in = readFromPipe(fd);
+    close(fd);
+    int status;
+    waitpid(pid, &status, 0);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0 || in.size() < 1 + sizeof(size_t)) {
+	text = caller + ": worker process terminated abnormally.";
+	return false;
+    }
+    size_t loglen;
+    in.copy((char*) &loglen, sizeof(loglen), 1);
+    cout << in.substr(1 + sizeof(loglen), loglen);
+    text = in.substr(1 + sizeof(loglen) + loglen);
+    return in[0] != 0;
+}
+
+/*
+ * runInProcesses
+ * For work that uses the static members of the state models and therefore cannot run in threads.
+ * Calls operator() of each job in a forked child process, at most numProcs at a time. A child
+ * works on the state of the parent at the time of the fork, so all jobs see the same parameters.
+ * What a job writes to cout is collected and printed by the parent in the order of the jobs.
+ * The results of a job are passed back with job.write(ostream&) in the child and job.read(istream&)
+ * in the parent. With numProcs <= 1 the jobs are called one after the other in this process,
+ * which gives the same output, unless alwaysFork is set. Set it for jobs that leave behind
+ * state that the next job must not see, e.g. training.
+ */
+template <class Job>
+void runInProcesses(vector<Job> &jobs, int numProcs, bool alwaysFork = false){
+    if (!alwaysFork && (numProcs <= 1 || jobs.size() <= 1)) {
+	for (int i=0; i < jobs.size(); i++)
+	    jobs[i]();
+	return;
+    }
+    if (numProcs < 1)
+	numProcs = 1;
+    vector<pid_t> pids(jobs.size(), 0);
+    vector<int> fds(jobs.size(), -1);
+    string errmsg;
+    int started = 0;
+    for (int i=0; i < jobs.size(); i++) {
+	// start jobs until numProcs are running
+	while (started < jobs.size() && started < i + numProcs) {
+	    int fd[2];
+	    if (pipe(fd) != 0)
+		throw ProjectError("runInProcesses: could not create pipe.");
+	    cout << flush;
+	    pid_t pid = fork();
+	    if (pid < 0)
+		throw ProjectError("runInProcesses: could not fork.");
+	    if (pid == 0) { // child
+		close(fd[0]);
+		ostringstream log, result;
+		streambuf *coutbuf = cout.rdbuf(log.rdbuf());
+		bool ok = true;
+		string message;
+		try {
+		    jobs[started]();
+		    jobs[started].write(result);
+		} catch (ProjectError &e) {
+		    ok = false;
+		    message = e.getMessage();
+		} catch (...) {
+		    ok = false;
+		    message = "unknown error in worker process";
+		}
+		cout.rdbuf(coutbuf);
+		sendJobResult(fd[1], ok, log.str(), ok? result.str() : message);
+	    }
+	    close(fd[1]);
+	    pids[started] = pid;
+	    fds[started] = fd[0];
+	    started++;
+	}
+	// collect job i
+	string text;
+	if (receiveJobResult(fds[i], pids[i], text, "runInProcesses")) {
+	    istringstream result(text);
+	    jobs[i].read(result);
+	} else if (errmsg.empty())
+	    errmsg = text;
+    }
+    if (!errmsg.empty())
+	throw ProjectError(errmsg);
+}
+
+/*
+ * runInProcessesInOrder
+ * For jobs that can do most of their work at the same time, but must write their output in the
+ * order of the jobs, continuing numberings (e.g. gene IDs) where the previous job stopped.
+ * operator()() of each job runs in a forked child process as in runInProcesses. Then the child
+ * waits until all previous jobs are done and calls job.commit(). Before that, it gets the state
+ * the previous jobs left behind: the parent calls job.writeState(ostream&) and the child
+ * job.readState(istream&). After commit() the state goes back the same way to the parent.
+ * commit() may write to files the child inherited from the parent, if it flushes them. The
+ * parent must flush them before and must not write to them until all jobs are done.
+ * What a job writes to cout is printed by the parent in the order of the jobs.
+ * With numProcs <= 1 each job and its commit() are called one after the other in this process.
+ */
+template <class Job>
+void runInProcessesInOrder(vector<Job> &jobs, int numProcs){
+    if (numProcs <= 1 || jobs.size() <= 1) {
+	for (int i=0; i < jobs.size(); i++) {
+	    jobs[i]();
+	    jobs[i].commit();
+	}
+	return;
+    }
+    // a child that terminated abnormally must not terminate the parent when the state is sent to it
+    void (*sigpipeHandler)(int) = signal(SIGPIPE, SIG_IGN);
+    vector<pid_t> pids(jobs.size(), 0);
+    vector<int> resultFds(jobs.size(), -1), stateFds(jobs.size(), -1);
+    string errmsg;
+    int started = 0;
+    for (int i=0; i < jobs.size(); i++) {
+	// start jobs until numProcs are running
+	while (started < jobs.size() && started < i + numProcs) {
+	    int rfd[2], sfd[2];
+	    if (pipe(rfd) != 0 || pipe(sfd) != 0) {
+		signal(SIGPIPE, sigpipeHandler);
+		throw ProjectError("runInProcessesInOrder: could not create pipe.");
+	    }
+	    cout << flush;
+	    pid_t pid = fork();
+	    if (pid < 0) {
+		signal(SIGPIPE, sigpipeHandler);
+		throw ProjectError("runInProcessesInOrder: could not fork.");
+	    }
+	    if (pid == 0) { // child
+		close(rfd[0]);
+		close(sfd[1]);
+		// the pipes of the other running jobs, otherwise they would not see the end of their state
+		for (int k=i; k < started; k++) {
+		    close(resultFds[k]);
+		    close(stateFds[k]);
+		}
+		ostringstream log, result;
+		streambuf *coutbuf = cout.rdbuf(log.rdbuf());
+		bool ok = true;
+		string message;
+		try {
+		    jobs[started]();
+		} catch (ProjectError &e) {
+		    ok = false;
+		    message = e.getMessage();
+		} catch (...) {
+		    ok = false;
+		    message = "unknown error in worker process";
+		}
+		// wait until the previous jobs are done
+		istringstream state(readFromPipe(sfd[0]));
+		close(sfd[0]);
+		if (ok) {
+		    try {
+			jobs[started].readState(state);
+			jobs[started].commit();
+			jobs[started].writeState(result);
+		    } catch (ProjectError &e) {
+			ok = false;
+			message = e.getMessage();
+		    } catch (...) {
+			ok = false;
+			message = "unknown error in worker process";
+		    }
+		}
+		cout.rdbuf(coutbuf);
+		sendJobResult(rfd[1], ok, log.str(), ok? result.str() : message);
+	    }
+	    close(rfd[1]);
+	    close(sfd[0]);
+	    pids[started] = pid;
+	    resultFds[started] = rfd[0];
+	    stateFds[started] = sfd[1];
+	    started++;
+	}
+	// let job i commit and collect it
+	ostringstream state;
+	jobs[i].writeState(state);
+	writeToPipe(stateFds[i], state.str()); // fails only if the child has already terminated
+	close(stateFds[i]);
+	string text;
+	if (receiveJobResult(resultFds[i], pids[i], text, "runInProcessesInOrder")) {
+	    istringstream result(text);
+	    jobs[i].readState(result);
+	} else if (errmsg.empty())
+	    errmsg = text;
+    }
+    signal(SIGPIPE, sigpipeHandler);
+    if (!errmsg.empty())
+	throw ProjectError(errmsg);
+}
+
+#endif  // _PARALLEL_HH
@@ -119,6 +119,12 @@ public:
      */
     double pruningAlgor(std::string labelpattern, Evo *evo, int u=0);
     double pruningAlgor(std::vector<int> &tuple, Evo *evo, int u=0);
+    /*
+     * the same for many tuples at once, loglik[t] is the log likelihood of tuples[t]
+     * The recursion tables of all tuples are stored in one array [node][state][tuple], so that
+     * the inner loops run over the tuples and can be vectorized.
+     */
+    void pruningAlgor(const std::vector<std::vector<int> > &tuples, Evo *evo, std::vector<double> &loglik, int u=0);
     void printRecursionTable() const;
 
     /*
@@ -130,9 +136,23 @@ public:
      */
     double MAP(std::vector<int> &labels, std::vector<double> &weights, Evo *evo, double k=1.0, bool fixLeafLabels=false);
     void MAPbacktrack(std::vector<int> &labels, Treenode* root, int bestAssign, bool fixLeafLabels);
+    /*
+     * the same for many label tuples at once, weights[t] are the weights of labels[t]
+     * scores[t] is the score of the MAP assignment of labels[t]
+     * Tuples in which the same species are missing share one copy of the tree without them.
+     */
+    void MAP(std::vector<std::vector<int> > &labels, const std::vector<std::vector<double> > &weights, Evo *evo,
+	     std::vector<double> &scores, double k=1.0, bool fixLeafLabels=false);
 
     // calculate diversity (sum of branch lengths) of the subtree induced by a HECT
     double sumBranches(OrthoExon &oe);
+
+private:
+    // the nodes in the order of 'treenodes' and for each node the indices of its children
+    void getNodeArray(std::vector<Treenode*> &nodes, std::vector<std::vector<int> > &children) const;
+    // batch MAP inference on the tuples with the indices in 'group', none of their leaves is missing
+    void MAP(const std::vector<int> &group, std::vector<std::vector<int> > &labels, const std::vector<std::vector<double> > &weights,
+	     Evo *evo, std::vector<double> &scores, double k, bool fixLeafLabels);
 };
 
 #endif
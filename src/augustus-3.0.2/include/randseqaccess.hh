@@ -14,6 +14,7 @@
 #include "gene.hh"
 #include "types.hh"
 #include "extrinsicinfo.hh"
+#include "twobit.hh"
 
 #include <map>
 #include <vector>
@@ -23,6 +24,10 @@
 #include <mysql++.h>
 #endif
 
+namespace boost {
+    class thread;
+}
+
 /*
  * SpeciesCollection holds all extrinsic evidence given for the species.
  * It consists of a set of group specific FeatureCollections and
@@ -47,6 +52,17 @@ private:
     static int groupCount; // number of groups
 };
 
+/*
+ * a segment of a sequence, as requested with getSeq and getFeatures
+ */
+struct SeqWindow {
+    SeqWindow(string species, string chr, int s, int e, Strand str = plusstrand) :
+	speciesname(species), chrName(chr), start(s), end(e), strand(str) {}
+    string speciesname, chrName;
+    int start, end;
+    Strand strand;
+};
+
 /*
  * abstract class for quick access to an arbitrary sequence segment in genomes
  * needed for comparative gene finding
@@ -65,10 +81,16 @@ public:
     AnnoSequence* getSeq(size_t speciesIdx, string chrName, int start, int end, Strand strand) {
 	return getSeq(getSname(speciesIdx), chrName, start, end, strand);
     }
+    // the sequences of several windows, NULL where it failed, by default one after the other
+    virtual void getSeqs(const vector<SeqWindow> &windows, vector<AnnoSequence*> &seqs);
     virtual SequenceFeatureCollection* getFeatures(string speciesname, string chrName, int start, int end, Strand strand) = 0;  
+    // true if getFeatures returns all hints that overlap the window, false if those that end in it
+    virtual bool featuresOverlap() {return false;}
     virtual ~RandSeqAccess() {}
 protected:
     RandSeqAccess() {};
+    void readHints(const vector<string> &completeNames); // completeNames: all sequences as speciesname.seqname
+    SequenceFeatureCollection* getHints(string speciesname, string chrName, int start, int end, Strand strand);
     int numSpecies;
     vector<map<string,int> > chrLen;
     vector<string> speciesNames;
@@ -91,6 +113,113 @@ private:
     map<string,char*> sequences;  //keys: speciesname:chrName values: dna sequence
 };
 
+/*
+ * Random access to genomes in files of the .2bit format, e.g. a single file with all
+ * genomes made by fa2twobit. The files are mapped into memory and only the requested
+ * segments are decoded, so the genomes need not fit into RAM and all processes on a
+ * machine share the file pages. In a file, the sequences are looked up as
+ * speciesname.seqname (as written by fa2twobit) or else as seqname (e.g. UCSC hg19.2bit).
+ */
+class TwoBitSeqAccess : public RandSeqAccess {
+public:
+    TwoBitSeqAccess();
+    ~TwoBitSeqAccess();
+    AnnoSequence* getSeq(string speciesname, string chrName, int start, int end, Strand strand);
+    SequenceFeatureCollection* getFeatures(string speciesname, string chrName, int start, int end, Strand strand);
+    // true if the files in the list (see getFileNames) are .2bit files, false if none is
+    static bool isTwoBitList(string listfile);
+private:
+    string getSeqKey(string speciesname, string chrName, TwoBitFile* &file);
+    map<string,TwoBitFile*> files; // keys: speciesname
+    vector<TwoBitFile*> distinctFiles; // several species may share a file
+};
+
+/*
+ * CachedSeqAccess
+ * Cache in front of another RandSeqAccess (the backend, e.g. a database). Sequences and hints
+ * are fetched from the backend in chunks of CHUNKSIZE bases, aligned to multiples of CHUNKSIZE
+ * on the chromosome, and the least recently used chunks are kept up to a memory budget.
+ * The missing sequence chunks of a request are fetched with a single getSeqs of the backend.
+ * Overlapping windows of consecutive gene ranges are then served from memory.
+ * getFeatures returns the same hints as the backend: those that end in the window (hints file)
+ * or all that overlap it (database, see featuresOverlap). prefetch() fetches the chunks of
+ * windows in a background thread, e.g. those of the next gene range while the current one is
+ * sampled. The next request waits until the prefetch is done, so the backend is never used
+ * by two threads at a time.
+ * The chromosome lengths (setLength) must be known, other windows are passed to the backend.
+ */
+class CachedSeqAccess : public RandSeqAccess {
+public:
+    CachedSeqAccess(RandSeqAccess *backend, size_t maxBytes);
+    ~CachedSeqAccess();
+    AnnoSequence* getSeq(string speciesname, string chrName, int start, int end, Strand strand);
+    void getSeqs(const vector<SeqWindow> &windows, vector<AnnoSequence*> &seqs);
+    SequenceFeatureCollection* getFeatures(string speciesname, string chrName, int start, int end, Strand strand);
+    bool featuresOverlap() {return backend->featuresOverlap();}
+    void prefetch(const vector<SeqWindow> &windows, bool withHints);
+    void waitForPrefetch();
+    void printStatistics();
+    static const int CHUNKSIZE = 65536;
+private:
+    struct ChunkKey {
+	ChunkKey(bool h, int idx, string chr, int c) : hints(h), speciesIdx(idx), chrName(chr), chunk(c) {}
+	bool operator<(const ChunkKey &other) const;
+	bool hints; // otherwise sequence
+	int speciesIdx;
+	string chrName;
+	int chunk;
+    };
+    struct Chunk {
+	Chunk(const ChunkKey &k) : key(k), ok(false), collection(NULL), bytes(0) {}
+	ChunkKey key;
+	bool ok;                       // false if the backend failed on the chunk
+	string dna;
+	vector<list<Feature> > hints;  // of each feature type as the backend returns them for the chunk, sorted
+	FeatureCollection *collection; // of the species
+	size_t bytes;
+    };
+    bool inChunks(string speciesname, string chrName, int start, int end, int &speciesIdx);
+    int chunkEnd(const ChunkKey &key);
+    Chunk *findChunk(const ChunkKey &key); // NULL if not cached
+    Chunk *addChunk(Chunk &chunk);
+    void fetchSeqChunks(const vector<SeqWindow> &windows, bool prefetching);
+    AnnoSequence *assembleSeq(const SeqWindow &w, int speciesIdx);
+    Chunk *getHintChunk(const ChunkKey &key, bool prefetching);
+    void runPrefetch(); // the work of the prefetch thread
+
+    RandSeqAccess *backend;
+    size_t maxBytes, usedBytes;
+    list<Chunk> chunks; // most recently used first
+    map<ChunkKey, list<Chunk>::iterator> chunkIndex;
+    boost::thread *prefetcher;
+    vector<SeqWindow> prefetchWindows;
+    bool prefetchHints;
+    long seqHits, seqMisses, hintHits, hintMisses, numPrefetched, numEvicted;
+};
+
+#ifdef AMYSQL
+/*
+ * DbConnectionPool
+ * the connections to the database given with --dbaccess. Each query grabs a connection
+ * that no other thread uses at the time (mysqlpp::ScopedConnection), so several threads
+ * can query at the same time. A connection is opened when no idle one is left.
+ */
+class DbConnectionPool : public mysqlpp::ConnectionPool {
+public:
+    DbConnectionPool(const vector<string> &db_information) :
+	db_name(db_information[0]), host(db_information[1]), user(db_information[2]), passwd(db_information[3]) {}
+    ~DbConnectionPool() { clear(); }
+protected:
+    mysqlpp::Connection* create() {
+	return new mysqlpp::Connection(db_name.c_str(), host.c_str(), user.c_str(), passwd.c_str());
+    }
+    void destroy(mysqlpp::Connection* con) { delete con; }
+    unsigned int max_idle_time() { return 600; } // seconds, well below the default timeout of the server
+private:
+    string db_name, host, user, passwd;
+};
+#endif // AMYSQL
+
 /*
  * Random access to sequence segments through a database.
  * The sequences must be stored in a database.
@@ -98,12 +227,14 @@ private:
 class DbSeqAccess : public RandSeqAccess {
 public:
     DbSeqAccess();
-    ~DbSeqAccess(){};
+    ~DbSeqAccess();
     AnnoSequence* getSeq(string speciesname, string chrName, int start, int end, Strand strand);
     // the following function is for the BGI-style database
     AnnoSequence* getSeq2(string speciesname, string chrName, int start, int end, Strand strand);
     SequenceFeatureCollection* getFeatures(string speciesname, string chrName, int start, int end, Strand strand);  
+    bool featuresOverlap() {return true;}
 #ifdef AMYSQL
+    void getSeqs(const vector<SeqWindow> &windows, vector<AnnoSequence*> &seqs);
     int split_dbaccess();
     void connect_db(ostream& out=cout);
     template<class T>  
@@ -114,7 +245,8 @@ public:
     int get_region_coord(int seq_region_id, int start, int end, vector<T>& asm_query_region);
     string dbaccess;
 private:
-    mysqlpp::Connection con;
+    DbConnectionPool *getPool();
+    DbConnectionPool *pool; // opened in connect_db
     vector<string> db_information;
 #endif // AMYSQL
 };
@@ -35,10 +35,10 @@ private:
 #endif
     double max_weight; // the max weight of a node/edge in the graph, used as an upper/lower bound
     double ec_score; //temp: until there are real scores for exon candidates
-    ofstream *sampled_exons;        // output file of sampled exons
+    ostream *sampled_exons;         // output of sampled exons
 
 public:
-    SpeciesGraph(list<Status> *states, AnnoSequence *seq, list<ExonCandidate*> &addEx, string name, Strand s, ofstream *se) :
+    SpeciesGraph(list<Status> *states, AnnoSequence *seq, list<ExonCandidate*> &addEx, string name, Strand s, ostream *se) :
 	AugustusGraph(states, seq->sequence),
 	seqRange(seq),
 	additionalExons(addEx),
@@ -73,10 +73,10 @@ public:
     void printGraph(string filename, Node* begin, Node* end, bool only_sampled = false); // prints graph in dot-format
     void printGraph(string filename){printGraph(filename, head, tail, true);}
     /*
-     * @getKey(): if the node is a neutral node, then key = PosBegin:n_type
-     * else key = PosBegin:PosEnd:StateType
+     * @getKey(): if the node is a neutral node, then key = (PosBegin, -1, n_type)
+     * else key = (PosBegin, PosEnd, StateType)
      */
-    string getKey(Node *n);
+    NodeKey getKey(Node *n);
     double setScore(Status *st);
     Node* addExon(Status *exon, vector< vector<Node*> > &neutralLines);        // adds a sampled exon to the graph
     void addExon(ExonCandidate *exon, vector< vector<Node*> > &neutralLines);  // adds an exon, which is not sampled
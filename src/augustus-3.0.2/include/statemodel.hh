@@ -62,9 +62,10 @@ struct Ancestor{
  */
 class StateModel {
 protected:
-    StateModel() {}  // do not create StateModel object
+    StateModel() : ancestor(NULL), GCancestor(NULL) {}  // do not create StateModel object
 public:
     void initPredecessors(Matrix<Double>&, int self);
+    void usePredecessors() {ancestor = &GCancestor[gcIdx];}
 
     // virtual methods to be implemented by the specialised classes
     virtual void registerPars(Parameters* parameters) {}
@@ -75,7 +76,10 @@ public:
 					   AlgorithmVariant, OptionListItem&) const = 0;
     virtual Double emiProbUnderModel(int , int) const = 0;
     virtual void initAlgorithms(Matrix<Double>&, int) = 0;
-    virtual ~StateModel() {} // nothing to do here since class is purely abstract
+    virtual void useGCPars() = 0;
+    virtual ~StateModel() {
+	delete [] GCancestor;
+    }
 
     // class functions
     static void init();
@@ -89,6 +93,7 @@ public:
     static void resetPars();
     static void readAllParameters();
     static void storeGCPars(int);
+    static void makeEmiTables();
     static void resetModelCounts();
     static bool isPossibleDSS(int pos) {
 	return pos >= 1 && pos <= dnalen-2 &&
@@ -121,9 +126,18 @@ public:
     static void setGCIdx(int idx) {gcIdx = idx;}
     static void setContentStairs(ContentStairs *stairs) {cs = stairs;}
     static int getGCIdx(int at){if (cs) return cs->idx[at]; else return -1;}
+    /*
+     * beam pruning (option --beam): predecessors whose Viterbi variable is more than
+     * 'beam' (natural log) below the best Viterbi variable of their column are not considered
+     */
+    static bool hasBeam() {return beamFactor > 0.0;}
+    static void setBeamActive(bool active) {beamActive = active && hasBeam();}
+    static bool isBeamActive() {return beamActive;}
+    static void setColumnBest(int base, Double best) {colBest[base] = best;}
 protected:
     // variable unique to each model
-    vector<Ancestor>  ancestor;    // predecessor in the state transition graph
+    vector<Ancestor>  *ancestor;   // predecessors in the state transition graph, points into GCancestor
+    vector<Ancestor>  *GCancestor; // array with the predecessors for each GC content class
 
     // class variables shared by all models
     static const vector<StateType>* stateMap;  // needed in exonmodel 
@@ -136,6 +150,9 @@ protected:
     static int activeWinLen;         // states ending before the active window will be deleted if they are not yet used
     static int gcIdx; // GC content class index for all states
     static ContentStairs *cs;
+    static Double beamFactor;        // exp(-beam), 0 if there is no beam pruning
+    static bool beamActive;          // whether the current Viterbi run prunes
+    static vector<Double> colBest;   // best Viterbi variable of each column, only used with beam pruning
 }; // class StateModel
 
 
@@ -207,5 +224,46 @@ private:
     Double getElemSeqProb(int base, int len);
 };
 
+/*
+ * FloatEmiTable
+ * read-only single precision copy of the Markov chain emission probabilities of all
+ * GC content classes, stored contiguously by [GC content class][frame][pattern].
+ * The Viterbi and forward loops look up these, training and output use the Double tables.
+ */
+class FloatEmiTable {
+public:
+    FloatEmiTable() : probs(NULL), numGC(0), numFrames(0), size(0) {}
+    ~FloatEmiTable() { delete [] probs; }
+    void init(int numGC, int numFrames, int size);
+    void set(int gcIdx, int frame, const vector<Double> &p);
+    // probabilities of GC content class gcIdx, the index is frame * getSize() + pattern
+    const float* get(int gcIdx) const { return probs + gcIdx * numFrames * size; }
+    int getSize() const { return size; }
+private:
+    float *probs;
+    int numGC, numFrames, size;
+};
+
+/*
+ * MotifTrack
+ * probabilities of a signal (splice site, translation initiation) at every position of a
+ * sequence on both strands, computed in one pass with prob(pos, forwardStrand).
+ * The algorithms then only read the arrays.
+ */
+class MotifTrack {
+public:
+    MotifTrack(Double (*prob)(int, bool), const char *dna, int n);
+    // true if position pos of the sequence dna of length n is stored
+    bool covers(const char *dna, int n, int pos) const {
+	return dna == seq && n == len && pos >= 0 && pos < len;
+    }
+    Double get(int pos, bool forwardStrand) const {
+	return probs[forwardStrand? 0 : 1][pos];
+    }
+private:
+    const char *seq;
+    int len;
+    vector<Double> probs[2]; // forward (0) and reverse (1) strand
+};
 
 #endif  //  _STATEMODEL_HH
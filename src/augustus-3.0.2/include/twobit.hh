@@ -0,0 +1,88 @@
+/**********************************************************************
+ * file:    twobit.hh
+ * licence: Artistic Licence, see file LICENCE.TXT or
+ *          http://www.opensource.org/licenses/artistic-license.php
+ * descr.:  genomes packed with 2 bits per base in a file of the UCSC .2bit format
+ *
+ **********************************************************************/
+
+#ifndef _TWOBIT_HH
+#define _TWOBIT_HH
+
+// project includes
+#include "types.hh"
+
+// standard C/C++ includes
+#include <string>
+#include <vector>
+#include <map>
+#include <fstream>
+#include <stdint.h>
+
+/*
+ * TwoBitFile
+ * Read access to a file in the .2bit format of UCSC (see faToTwoBit, twoBitToFa).
+ * The bases are packed with 2 bits each (t=0, c=1, a=2, g=3), runs of unknown bases
+ * are stored as N-blocks. The file is mapped into memory, so all processes that read it
+ * share the pages in the page cache and only the pages of the requested ranges are read.
+ * Soft-masking is not used: like the FASTA input, the sequences are returned in lower case.
+ * Versions 0 (32 bit offsets) and 1 (64 bit offsets, for files > 4GB) are supported.
+ */
+class TwoBitFile {
+public:
+    TwoBitFile(string filename);
+    ~TwoBitFile();
+    bool hasSeq(string seqname) const { return records.find(seqname) != records.end(); }
+    int getSeqLen(string seqname) const; // -1 if there is no such sequence
+    void getSeqNames(vector<string> &seqnames) const;
+    /*
+     * decodes bases start..end (0-based, end included) of sequence seqname
+     * into dna, which must have space for end-start+2 characters (including the final '\0')
+     * false if there is no such sequence or the range is not within it
+     */
+    bool getSeq(string seqname, int start, int end, char *dna) const;
+    string getFilename() const { return filename; }
+    static bool isTwoBit(string filename); // true if the file starts with the .2bit signature
+
+    static const uint32_t SIGNATURE = 0x1A412743;
+private:
+    struct Record {
+	int dnaSize;
+	vector<int> nStarts, nSizes;  // N-blocks, sorted by start
+	const unsigned char *packed;  // 4 bases per byte, first base in the high bits
+    };
+    const unsigned char *readRecord(const unsigned char *p, Record &rec) const;
+    void checkRange(const unsigned char *p, size_t len) const;
+
+    string filename;
+    unsigned char *data; // the mapped file
+    size_t size;
+    map<string, Record> records;
+};
+
+/*
+ * TwoBitWriter
+ * writes sequences to a .2bit file, one after the other, e.g. all genomes of a comparative
+ * gene prediction to one file with names species.seqname (see fa2twobit).
+ * Letters other than a, c, g, t (in any case) are stored as N.
+ * Version 1 (64 bit offsets) is written only if the file would be larger than 4GB.
+ */
+class TwoBitWriter {
+public:
+    TwoBitWriter(string filename);
+    ~TwoBitWriter();
+    void addSeq(string seqname, const char *dna, int len);
+    void close(); // writes the index and the sequences
+    uint64_t getNumBases() const { return numBases; }
+    int getNumSeqs() const { return names.size(); }
+private:
+    string filename;
+    string tmpname; // the packed sequence records, until close()
+    ofstream tmp;
+    vector<string> names;
+    vector<uint64_t> recordSizes;
+    uint64_t numBases;
+    bool closed;
+};
+
+#endif  // _TWOBIT_HH
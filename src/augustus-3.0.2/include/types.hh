@@ -188,6 +188,11 @@ parameters:\n\
   A and B define the range of the sequence for which predictions should be found.\n\
 --UTR=on/off\n\
   predict the untranslated regions in addition to the coding sequence. This currently works only for a subset of species.\n\
+--beam=x\n\
+  fast approximate prediction: ignore predecessors whose Viterbi score is more than x (natural log) below the best\n\
+  score at their position. Only used without sampling (sample=0). Default: no pruning\n\
+--exoncand=true/false\n\
+  fast approximate prediction: consider only exons with sufficiently likely splice sites. Default: false\n\
 --noInFrameStop=true/false\n\
   Do not report transcripts with in-frame stop codons. Otherwise, intron-spanning stop codons could occur. Default: false\n\
 --noprediction=true/false\n\
@@ -205,7 +210,12 @@ SPECIES is a name for your species.\n\
 \n\
 parameters:\n\
 --/genbank/verbosity=n\n\
-  Choose one of 0,1,2 or 3. The larger the verbosity, the more (error) messages you get.\n"
+  Choose one of 0,1,2 or 3. The larger the verbosity, the more (error) messages you get.\n\
+--threads=n\n\
+  Count the sequence patterns of the training genes in n threads. With --CRF=1 also compute\n\
+  the Viterbi paths of the training genes in n processes. Default: 1\n\
+--cv=k\n\
+  Do not train but do a k-fold cross-validation in memory and print the prediction accuracy.\n"
 
 
 #define POWER4TOTHE(x) ((int) (pow((double) 4,(double) (x)) + 0.1))
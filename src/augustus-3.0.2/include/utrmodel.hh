@@ -16,6 +16,24 @@
 
 #include "statemodel.hh"
 
+/*
+ * sequence dependent quantities of the UTR model that are kept
+ * separately for each GC content class of the current sequence
+ */
+class UtrGCCache {
+public:
+    UtrGCCache() : initSnippetProbs5(NULL), snippetProbs5(NULL), rInitSnippetProbs5(NULL),
+		   rSnippetProbs5(NULL), rSnippetProbs3(NULL), intronSnippetProbs(NULL) {}
+    ~UtrGCCache() { clear(); }
+    void clear();
+    bool empty() const { return initSnippetProbs5 == NULL; }
+    SnippetProbs   *initSnippetProbs5, *snippetProbs5, *rInitSnippetProbs5, *rSnippetProbs5, *rSnippetProbs3, *intronSnippetProbs;
+    vector<Double> tssProbsPlus, tssProbsMinus;   // -1 if not yet computed
+    vector<Double> ttsProbPlus, ttsProbMinus;
+    vector<Double> cumEmiProbs[3][2];             // prefix products of the emission probs of the 3 UTR
+                                                  // content models on the forward (0) and reverse (1) strand
+};
+
 
 /**
  * The utr model class.
@@ -60,6 +78,7 @@ public:
      */
     void printProbabilities   ( int zusNumber, BaseCount *bc, const char* suffix = NULL );
     void initAlgorithms       ( Matrix<Double>&, int);
+    void useGCPars            ( );
     void viterbiForwardAndSampling(ViterbiMatrixType&, ViterbiMatrixType&, int, int, 
 				   AlgorithmVariant, OptionListItem&) const;
     Double emiProbUnderModel  (int begin, int end) const;
@@ -75,8 +94,9 @@ public:
 	    return;
 	if (!haveSnippetProbs)
 	    initSnippetProbs();
-	initAlgorithmsCalled = false;
+	haveGCPars = false;
     }
+    static void clearSnippetProbs() { haveSnippetProbs = false; } // at the start of a new sequence
     static void readProbabilities(int zusNumber);
     static void readAllParameters();
     static void storeGCPars(int idx);
@@ -85,6 +105,7 @@ public:
     
 private:
   Double seqProb            ( int left, int right, bool reverse, int type) const;
+  static void computeCumEmiProbs(UtrGCCache &c);
   void computeLengthDistributions( );
   static void fillTailsOfLengthDistributions( );
   void process5InitSequence( const char* start, const char* end);
@@ -151,8 +172,8 @@ private:
   static vector<Double>  lenDist3Internal;      // Length distribution of internal exons
   static vector<Double>  lenDist3Terminal;      // Length distribution of terminal exons
   static vector<Double>  tailLenDist3Single;    // Tail probabilities of the length distribution of single exons
-  static vector<Double>  tssProbsPlus;          // to store tss probabilities
-  static vector<Double>  tssProbsMinus;         // to store tss probabilities
+  static Double          *tssProbsPlus;         // to store tss probabilities, points into GCcache
+  static Double          *tssProbsMinus;        // to store tss probabilities, points into GCcache
   static Integer         num5Single, num5Initial, num5Internal, num5Terminal, num5Introns;
   static Integer         numHuge5Single, numHuge5Initial, numHuge5Internal, numHuge5Terminal; 
   static Integer         num3Single, num3Initial, num3Internal, num3Terminal, num3Introns;
@@ -184,7 +205,10 @@ private:
   //static vector<Double>  intron_emiprobs;
   //static Integer         intron_k;            // order of the markov chain
   static SnippetProbs    *initSnippetProbs5, *snippetProbs5, *rInitSnippetProbs5, *rSnippetProbs5, *rSnippetProbs3, *intronSnippetProbs;
-  static bool            initAlgorithmsCalled, haveSnippetProbs;
+  static UtrGCCache      *GCcache;            // one for each GC content class
+  static const PatMMGroup *curUtr5init_emiprobs, *curUtr5_emiprobs, *curUtr3_emiprobs;
+  static const vector<Double> *curTssup_emiprobs;
+  static bool            haveGCPars, haveSnippetProbs;
   static vector<Integer> aataaa_count;
   static vector<Double>  aataaa_probs;
   static int             aataaa_boxlen;
@@ -195,6 +219,7 @@ private:
   static int             tts_motif_memory;
   static double pUtr5Intron, pUtr3Intron, prUtr5Intron, prUtr3Intron;
   static Double          *ttsProbPlus, *ttsProbMinus;
+  static const Double    *cumEmiProbs[3][2];     // point into GCcache
   static vector<Integer> distCountTata;
   static int             lastParIndex;
   static int             verbosity;
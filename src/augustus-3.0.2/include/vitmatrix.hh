@@ -736,7 +736,7 @@ public:
     Double probability;
 };
 
-inline bool operator< (OptionListItem& first, OptionListItem& second) {
+inline bool operator< (const OptionListItem& first, const OptionListItem& second) {
     // the largest probability comes first
     return (first.probability > second.probability);
 }
@@ -746,25 +746,30 @@ public:
     OptionsList(){
 	cumprob = 0.0;
     }
-    ~OptionsList(){
-	while (!options.empty())
-	    options.pop_front();
-    }
     void add(int state, int base, Double probability, int predEnd = -INT_MAX) {
+	if (options.empty())
+	    options.reserve(16); // enough for most positions, avoids repeated reallocation
 	options.push_back(OptionListItem(state, base, 
 					 (predEnd == -INT_MAX)? base : predEnd,
 					 probability));
 	cumprob += probability;
     }
     void prepareSampling() {
-	options.sort();
+	// stable insertion sort, the lists are short and this needs no temporary buffer
+	for (int i=1; i < options.size(); i++) {
+	    OptionListItem item = options[i];
+	    int j = i;
+	    for (; j > 0 && item < options[j-1]; j--)
+		options[j] = options[j-1];
+	    options[j] = item;
+	}
     }
     int size(){
 	return options.size();
     }
     void print(ostream& out) {
 	out << "options: " << cumprob << " | "; 
-	for (list<OptionListItem>::iterator it = options.begin(); it != options.end(); ++it){
+	for (vector<OptionListItem>::iterator it = options.begin(); it != options.end(); ++it){
 	    out << it->state << " " << it->base << " " << (it->probability/cumprob) << ", ";
 	}
 	out << endl;
@@ -772,7 +777,7 @@ public:
     OptionListItem sample();
 
 private:
-    list<OptionListItem> options;
+    vector<OptionListItem> options;
     Double cumprob;
 };
 
@@ -0,0 +1,88 @@
+#!/bin/bash
+# test and benchmark the database access of the comparative gene prediction (--dbaccess)
+# on the data set in examples/cgp
+#
+# usage: cgpDbTest.sh dbname,host,user,passwd [workDir]
+#
+# The database must exist and be empty, see README-cgp.txt, section 5. The genomes and
+# hints of examples/cgp are loaded with load2db, then AUGUSTUS runs
+#   - with flat files (the reference),
+#   - with database access,
+#   - with database access and a sequence cache (--/CompPred/seqCacheSize),
+# each without and with hints. The predictions of the runs without hints must be the same
+# for all three, those with hints must be the same with and without the cache.
+# The run times are printed.
+
+dbaccess=$1
+workDir=${2:-cgpDbTest}
+
+if [ -z "${dbaccess}" ]
+then
+	echo "usage: cgpDbTest.sh dbname,host,user,passwd [workDir]"
+	exit 1
+fi
+
+augDir=$(cd $(dirname $0)/.. && pwd)
+exDir=${augDir}/examples/cgp
+bin=${augDir}/bin
+export AUGUSTUS_CONFIG_PATH=${AUGUSTUS_CONFIG_PATH:-${augDir}/config}
+
+mkdir -p ${workDir} || exit 1
+cd ${workDir}
+
+# load genomes and hints, with the species identifiers of genomes.tbl
+rm -f genomes.tbl
+while read species file || [ -n "${species}" ]
+do
+	printf "%s\t%s\n" ${species} ${exDir}/${file} >> genomes.tbl
+	${bin}/load2db --species=${species} --dbaccess=${dbaccess} ${exDir}/${file} > load2db.${species}.log 2>&1 || { echo "load2db failed on ${file}"; exit 1; }
+done < ${exDir}/genomes.tbl
+${bin}/load2db --species=hg19 --dbaccess=${dbaccess} ${exDir}/human.hints.gff > load2db.hg19.hints.log 2>&1 || { echo "load2db failed on human.hints.gff"; exit 1; }
+${bin}/load2db --species=mm9 --dbaccess=${dbaccess} ${exDir}/mouse.hints.gff > load2db.mm9.hints.log 2>&1 || { echo "load2db failed on mouse.hints.gff"; exit 1; }
+
+# the hints in a single file for the flat-file run
+perl -pe 's/^/hg19./' ${exDir}/human.hints.gff > hints.gff
+perl -pe 's/^/mm9./' ${exDir}/mouse.hints.gff >> hints.gff
+
+hintopts="--extrinsicCfgFile=${exDir}/cgp.extrinsic.cfg"
+TIMEFORMAT="%R s"
+
+# run name options
+run(){
+	name=$1
+	shift
+	rm -rf ${name}
+	mkdir ${name}
+	echo -n "${name}: "
+	time ${bin}/augustus --species=human --treefile=${exDir}/tree.nwk --alnfile=${exDir}/aln.maf \
+		--/CompPred/outdir=${name}/ "$@" > ${name}.log 2> ${name}.err || { echo "augustus failed, see ${workDir}/${name}.err"; exit 1; }
+}
+
+# same name1 name2
+same(){
+	for f in $1/*.gff
+	do
+		if ! diff -q -I '^#' ${f} $2/$(basename ${f}) > /dev/null
+		then
+			echo "FAILED: ${f} and $2/$(basename ${f}) differ"
+			failed=1
+		fi
+	done
+}
+
+run file --speciesfilenames=genomes.tbl
+run db --dbaccess=${dbaccess}
+run dbCache --dbaccess=${dbaccess} --/CompPred/seqCacheSize=500
+run fileHints --speciesfilenames=genomes.tbl --hintsfile=hints.gff ${hintopts}
+run dbHints --dbaccess=${dbaccess} --dbhints=true ${hintopts}
+run dbHintsCache --dbaccess=${dbaccess} --dbhints=true ${hintopts} --/CompPred/seqCacheSize=500
+
+failed=0
+same file db
+same file dbCache
+same dbHints dbHintsCache
+if [ ${failed} -eq 0 ]
+then
+	echo "passed"
+fi
+exit ${failed}
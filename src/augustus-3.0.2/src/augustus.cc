@@ -216,6 +216,7 @@ int main( int argc, char* argv[] ){
 	  } else {
 	    throw ProjectError("File format of " + filename + " not recognized.");
 	  }
+	  namgene.printBeamCheck();
 	} // single species mode
 	//	if (verbosity>2)
 	cout << "# command line:" << endl << "# " << commandline << endl;
@@ -15,6 +15,7 @@
 // project includes
 #include "projectio.hh"
 #include "statemodel.hh"
+#include "parallel.hh"
 
 // standard C/C++ includes
 #include <iomanip>
@@ -254,70 +255,133 @@ void  BaumWelch::classifyTrainingData(){
 
 
 /*
- * BaumWelch::reestimate()
- * make one step in the Baum-Welch parameter reestimation
- * return the likelihood of the observation under the old model
- * P(s_1) * P(s_2) * ... * P(s_n)
+ * EStepWorker
+ * expectation step of the reestimation on the training sequences first..last-1:
+ * the expected pattern and model type counts under the current models, in buffers of its own.
+ * The posterior probabilities of the model types are between 0 and 1, so the counts
+ * are accumulated in double. Only the sequence probabilities need the range of Double.
  */
-
-Double BaumWelch::reestimate(Double patpseudocount){
-    int i;
+class BaumWelch::EStepWorker {
+public:
+    EStepWorker(const vector<ContentModel> *models, const vector<Double> *modelTypeProbs, int k, int numFrames,
+		const vector<TrainingData*> *seqs, int first, int last) :
+	models(models), modelTypeProbs(modelTypeProbs), k(k), numFrames(numFrames), seqs(seqs),
+	first(first), last(last), odds(1.0), impossible(false) {}
+    void operator()();
+    // index of the count of pattern pn in frame f of model type t in patCounts
+    int index(int t, int f, int pn) const {
+	return (t * numFrames + f) * POWER4TOTHE(k+1) + pn;
+    }
+private:
+    const vector<ContentModel> *models;
+    const vector<Double> *modelTypeProbs;
+    int k, numFrames;
+    const vector<TrainingData*> *seqs;
+    int first, last;
+public:
+    vector<double> patCounts;  // expected pattern counts
+    vector<double> typeCounts; // expected number of sequences of each model type
+    Double odds;               // probability of the sequences
+    bool impossible;           // a sequence has probability 0 under all models
+};
+
+void BaumWelch::EStepWorker::operator()(){
+    int modelTypes = models->size();
     Seq2Int s2i(k+1);
-    Double odds = 1.0;    // probability of the observation
     vector<Double> p_s_given_m(modelTypes);
-    vector<Double> p_m_given_s(modelTypes);
-    Double p_s;           // probability of a certain sequence
-    vector<Matrix<Double> > newpatprobs(modelTypes, Matrix<Double>(numFrames, POWER4TOTHE(k+1)));;
-    vector<Double> newmodelTypeProbs;
-
-    TrainingData *td = inputSeqs;
-    while (td) {
-	//cout << "---------- j=" << j << endl;
+    vector<double> weightedPost(modelTypes); // weight * P(model type | sequence)
+    patCounts.assign(modelTypes * numFrames * POWER4TOTHE(k+1), 0.0);
+    typeCounts.assign(modelTypes, 0.0);
+    for (int j = first; j < last; j++) {
+	TrainingData *td = (*seqs)[j];
 	// determine the probability of the j-th training data under each model i
-	for (i=0; i<modelTypes; i++) {
+	// and the overall probability of the j-th training data
+	Double p_s = 0.0;
+	for (int i=0; i<modelTypes; i++) {
 	    p_s_given_m[i] = (*models)[i].seqProbUnderModel(td->seq, td->seqLen, td->frame);
-	    //cout << "p_s_given_m[" << i << "]=" << p_s_given_m[i] << ", ";
-	}
-	//cout << endl;
-	// determine the overall probability of the j-th training data
-	p_s = 0.0;
-	for (i=0; i<modelTypes; i++) {
 	    p_s += (*modelTypeProbs)[i] * p_s_given_m[i];
 	}
-	//cout << "p_s = " << p_s << endl;
 	if (!(p_s>0.0)) {
-	    cerr << "Couldn't reestimate: Emission was impossible under model" << endl;
-	    return 0.0;
-	} 
+	    impossible = true;
+	    return;
+	}
 	// determine the probability of model i under the j-th training data
 	// using Bayes formula
-	for (i=0; i<modelTypes; i++) {
-	    p_m_given_s[i] = (*modelTypeProbs)[i] * p_s_given_m[i] / p_s;
-	    //cout << p_m_given_s[i] << "  ";
-	}
-	//cout << endl;
-	
+	for (int i=0; i<modelTypes; i++)
+	    weightedPost[i] = td->weight * ((*modelTypeProbs)[i] * p_s_given_m[i] / p_s).doubleValue();
 
 	/*
-	 * count the expected number of patterns using the p_m_given_s[i]
-	 */	
-	for (i=0; i<modelTypes; i++) {
-	    for (int a=0; a < td->seqLen - k; a++) {
-		try{
-		    newpatprobs[i][modm(td->frame+a+k, numFrames)][s2i(td->seq + a)] += 
-			td->weight * p_m_given_s[i];
-		} catch (InvalidNucleotideError e) {}
+	 * count the expected number of patterns and starts using the posterior probabilities
+	 */
+	for (int a=0; a < td->seqLen - k; a++) {
+	    int pn;
+	    try {
+		pn = s2i(td->seq + a);
+	    } catch (InvalidNucleotideError e) {
+		continue;
 	    }
+	    int f = modm(td->frame+a+k, numFrames);
+	    for (int i=0; i<modelTypes; i++)
+		if (weightedPost[i] > 0.0)
+		    patCounts[index(i, f, pn)] += weightedPost[i];
 	}
+	for (int i=0; i<modelTypes; i++)
+	    typeCounts[i] += weightedPost[i];
+	odds *= p_s;
+    }
+}
 
-	/*
-	 * count the expected number of starts using the p_m_given_s[i]
-	 */
-	for (i=0; i<modelTypes; i++) {
-	    newmodelTypeProbs[i] += td->weight * p_m_given_s[i];
+/*
+ * BaumWelch::reestimate()
+ * make one step in the Baum-Welch parameter reestimation
+ * return the likelihood of the observation under the old model
+ * P(s_1) * P(s_2) * ... * P(s_n)
+ * The expected counts are computed in parallel (option threads), each thread
+ * takes a part of the training sequences.
+ */
+
+Double BaumWelch::reestimate(Double patpseudocount){
+    int i;
+    Seq2Int s2i(k+1);
+    Double odds = 1.0;    // probability of the observation
+    int numPatterns = POWER4TOTHE(k+1);
+    vector<Matrix<Double> > newpatprobs(modelTypes);
+    vector<Double> newmodelTypeProbs(modelTypes, 0.0);
+
+    vector<TrainingData*> seqs;
+    for (TrainingData *td = inputSeqs; td; td = td->next)
+	seqs.push_back(td);
+    int numThreads = getNumThreads();
+    if (numThreads > seqs.size())
+	numThreads = seqs.size();
+    if (numThreads < 1)
+	numThreads = 1;
+    vector<EStepWorker> workers;
+    for (int t=0; t < numThreads; t++)
+	workers.push_back(EStepWorker(models, modelTypeProbs, k, numFrames, &seqs,
+				      (long) seqs.size() * t / numThreads, (long) seqs.size() * (t+1) / numThreads));
+    runInThreads(workers);
+
+    // add up the counts of the threads
+    for (int t=0; t < numThreads; t++) {
+	if (workers[t].impossible) {
+	    cerr << "Couldn't reestimate: Emission was impossible under model" << endl;
+	    return 0.0;
 	}
-	odds *= p_s;
-	td = td->next;
+	odds *= workers[t].odds;
+	if (t > 0) {
+	    for (int c=0; c < workers[0].patCounts.size(); c++)
+		workers[0].patCounts[c] += workers[t].patCounts[c];
+	    for (i=0; i<modelTypes; i++)
+		workers[0].typeCounts[i] += workers[t].typeCounts[i];
+	}
+    }
+    for (i=0; i<modelTypes; i++) {
+	newpatprobs[i].assign(numFrames, numPatterns);
+	for (int f=0; f < numFrames; f++)
+	    for (int pn=0; pn < numPatterns; pn++)
+		newpatprobs[i][f][pn] = workers[0].patCounts[workers[0].index(i, f, pn)];
+	newmodelTypeProbs[i] = workers[0].typeCounts[i];
     }
 
     /*
@@ -8,8 +8,11 @@
  **********************************************************************/
 
 #include "commontrain.hh"
+#include "geneticcode.hh"
+#include "parallel.hh"
 
 #include <iostream>
+#include <map>
 
 
 void scaleDblVector(vector<Double>& v, Double sum) {
@@ -25,6 +28,87 @@ void scaleDblVector(vector<Double>& v, Double sum) {
     }
 }
 
+/*--- PatternCounter methods -----------------------------------------*/
+
+/*
+ * counts one segment into the given count vectors and base counts,
+ * which correspond to seg.counts[0..numFrames-1] and seg.basecount[0..numFrames-1]
+ */
+void PatternCounter::countSegment(const Segment &seg, vector<Integer> *counts, Integer *basecount){
+    Seq2Int s2i(seg.k+1);
+    int f = seg.frame;
+    for (const char *pos = seg.begin; pos <= seg.end; pos++){
+	try {
+	    counts[f][s2i(pos - seg.k)] += seg.weight;
+	    if (seg.withRC) {
+		counts[f][s2i.rc(pos - seg.k)] += seg.weight;
+		basecount[f] += 2*seg.weight;
+	    } else 
+		basecount[f] += seg.weight;
+	} catch (InvalidNucleotideError &) {}
+	if (++f == seg.numFrames)
+	    f = 0;
+    }
+}
+
+/*
+ * Worker
+ * counts the segments first..last-1 into count vectors of its own
+ */
+class PatternCounter::Worker {
+public:
+    Worker(const vector<Segment> *segs, int first, int last) : segments(segs), first(first), last(last) {}
+    void operator()(){
+	for (int i = first; i < last; i++) {
+	    const Segment &seg = (*segments)[i];
+	    vector<vector<Integer> > &counts = localCounts[seg.counts];
+	    vector<Integer> &basecount = localBasecount[seg.basecount];
+	    if (counts.empty()) {
+		counts.resize(seg.numFrames);
+		for (int f=0; f < seg.numFrames; f++)
+		    counts[f].assign(seg.counts[f].size(), 0);
+	    }
+	    if (basecount.empty()) // may be shared by several count vectors
+		basecount.assign(seg.numFrames, 0);
+	    countSegment(seg, &counts[0], &basecount[0]);
+	}
+    }
+    // add the own counts to the counts of the models
+    void addTo(){
+	for (map<vector<Integer>*, vector<vector<Integer> > >::iterator it = localCounts.begin(); it != localCounts.end(); ++it)
+	    for (int f=0; f < it->second.size(); f++)
+		for (int j=0; j < it->second[f].size(); j++)
+		    it->first[f][j] += it->second[f][j];
+	for (map<Integer*, vector<Integer> >::iterator it = localBasecount.begin(); it != localBasecount.end(); ++it)
+	    for (int f=0; f < it->second.size(); f++)
+		it->first[f] += it->second[f];
+    }
+private:
+    const vector<Segment> *segments;
+    int first, last;
+    map<vector<Integer>*, vector<vector<Integer> > > localCounts;
+    map<Integer*, vector<Integer> > localBasecount;
+};
+
+void PatternCounter::count(){
+    int numThreads = getNumThreads();
+    if (numThreads > segments.size())
+	numThreads = segments.size();
+    if (numThreads <= 1) {
+	for (int i=0; i < segments.size(); i++)
+	    countSegment(segments[i], segments[i].counts, segments[i].basecount);
+    } else {
+	vector<Worker> workers;
+	for (int t=0; t < numThreads; t++)
+	    workers.push_back(Worker(&segments, (long) segments.size() * t / numThreads,
+				     (long) segments.size() * (t+1) / numThreads));
+	runInThreads(workers);
+	for (int t=0; t < numThreads; t++)
+	    workers[t].addTo();
+    }
+    segments.clear();
+}
+
 /*--- Smooth methods -------------------------------------------------*/
 
 void Smooth::smoothCounts(const vector<Integer> &counts, vector<Double> &result, int resultSize){
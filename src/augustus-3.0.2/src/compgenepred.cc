@@ -20,19 +20,478 @@
 #include "geneMSA.hh"
 #include "orthoexon.hh"
 #include "namgene.hh"
+#include "parallel.hh"
 
 #include "contTimeMC.hh"
 #include <gsl/gsl_matrix.h>
 #include <ctime>
+#include <cstdlib>
 
 CompGenePred::CompGenePred(){
     if (Constant::Constant::dbaccess.empty()) { // give priority to database in case both exist
-        rsa = new MemSeqAccess();
+	if (TwoBitSeqAccess::isTwoBitList(Constant::speciesfilenames))
+	    rsa = new TwoBitSeqAccess();
+	else
+	    rsa = new MemSeqAccess();
     } else {
         rsa = new DbSeqAccess();
     }
 }
 
+/*
+ * CGPRun
+ * what all gene ranges of a run share: models, options, output files and gene numbering
+ */
+struct CGPRun {
+    RandSeqAccess *rsa;
+    CachedSeqAccess *seqCache; // the same as rsa if sequences and hints are cached, otherwise NULL
+    NAMGene *namgene;
+    ExonEvo *evo;
+    vector<string> speciesNames;
+    Boolean noprediction;
+    bool dualdecomp;
+    int maxIterations;
+    double dd_factor;
+    int speciesProcs; // number of processes that sample the species of a gene range
+    bool omega; // estimate the omega (dN/dS) of each ortho exon
+    int omegaThreads; // number of threads per gene range for the omega estimation
+    vector<ofstream*> baseGenes, initGenes, optGenes, sampledExons;
+    vector<int> base_geneid, init_geneid, opt_geneid;
+    void flushOutputFiles() {
+	::flushOutputFiles(baseGenes);
+	::flushOutputFiles(initGenes);
+	::flushOutputFiles(optGenes);
+	::flushOutputFiles(sampledExons);
+	GeneMSA::flushOutputFiles();
+    }
+};
+
+static void writeIDs(ostream &out, const vector<int> &ids){
+    out << ids.size();
+    for (int i=0; i < ids.size(); i++)
+	out << " " << ids[i];
+    out << endl;
+}
+
+static void readIDs(istream &in, vector<int> &ids){
+    size_t n;
+    in >> n;
+    ids.resize(n);
+    for (int i=0; i < n; i++)
+	in >> ids[i];
+}
+
+template <class T>
+static void writeValue(ostream &out, const T &value){
+    out.write((const char*) &value, sizeof(value));
+}
+
+template <class T>
+static void readValue(istream &in, T &value){
+    in.read((char*) &value, sizeof(value));
+}
+
+static void writeString(ostream &out, const string &str){
+    writeValue(out, str.size());
+    out.write(str.data(), str.size());
+}
+
+static string readString(istream &in){
+    size_t n;
+    readValue(in, n);
+    string str(n, ' ');
+    if (n > 0)
+	in.read(&str[0], n);
+    return str;
+}
+
+static void writeEvidence(ostream &out, const Evidence &evidence){
+    writeValue(out, evidence.withNames);
+    writeValue(out, evidence.numEvidence);
+    writeValue(out, evidence.sourceEvidence.size());
+    for (list<SrcEvidence>::const_iterator it = evidence.sourceEvidence.begin(); it != evidence.sourceEvidence.end(); ++it) {
+	writeString(out, it->srcname);
+	writeValue(out, it->freq);
+	writeValue(out, it->groupnames.size());
+	for (list<string>::const_iterator git = it->groupnames.begin(); git != it->groupnames.end(); ++git)
+	    writeString(out, *git);
+    }
+}
+
+static Evidence *readEvidence(istream &in){
+    bool withNames;
+    readValue(in, withNames);
+    Evidence *evidence = new Evidence(withNames);
+    readValue(in, evidence->numEvidence);
+    size_t numSources, numGroups;
+    readValue(in, numSources);
+    for (size_t i=0; i < numSources; i++) {
+	evidence->sourceEvidence.push_back(SrcEvidence(readString(in)));
+	SrcEvidence &src = evidence->sourceEvidence.back();
+	readValue(in, src.freq);
+	readValue(in, numGroups);
+	for (size_t j=0; j < numGroups; j++)
+	    src.groupnames.push_back(readString(in));
+    }
+    return evidence;
+}
+
+/*
+ * a chain of states, as a worker process passes it to the parent
+ */
+static void writeStates(ostream &out, State *first){
+    int n = 0;
+    for (State *st = first; st; st = st->next)
+	n++;
+    writeValue(out, n);
+    for (State *st = first; st; st = st->next) {
+	writeValue(out, st->begin);
+	writeValue(out, st->end);
+	writeValue(out, st->type);
+	writeValue(out, st->prob);
+	writeValue(out, st->hasScore);
+	writeValue(out, st->apostprob);
+	writeValue(out, st->sampleCount);
+	writeValue(out, st->truncated);
+	writeValue(out, st->framemod);
+	writeValue(out, st->evidence != NULL);
+	if (st->evidence)
+	    writeEvidence(out, *st->evidence);
+    }
+}
+
+static State *readStates(istream &in){
+    int n;
+    readValue(in, n);
+    State *first = NULL, *last = NULL;
+    for (int i=0; i < n; i++) {
+	State *st = new State();
+	readValue(in, st->begin);
+	readValue(in, st->end);
+	readValue(in, st->type);
+	readValue(in, st->prob);
+	readValue(in, st->hasScore);
+	readValue(in, st->apostprob);
+	readValue(in, st->sampleCount);
+	readValue(in, st->truncated);
+	readValue(in, st->framemod);
+	bool hasEvidence;
+	readValue(in, hasEvidence);
+	if (hasEvidence)
+	    st->evidence = readEvidence(in);
+	if (last)
+	    last->next = st;
+	else
+	    first = st;
+	last = st;
+    }
+    return first;
+}
+
+/*
+ * SpeciesSampling
+ * samples the genes in the sequence of one species of a gene range. The species of a gene range
+ * are sampled at the same time in worker processes (see runInProcesses). Of the sampled
+ * transcripts, a worker passes back the coding exons and introns, which is all that the species
+ * graph is built from (see buildStatusList).
+ */
+class SpeciesSampling {
+public:
+    SpeciesSampling(NAMGene *ng, AnnoSequence *seq, SequenceFeatureCollection *psfc, int s, unsigned int rseed) :
+	namgene(ng), as(seq), sfc(psfc), seed(rseed), speciesIdx(s), transcripts(NULL) {}
+    void operator()() {
+	srand(seed); // the samples do not depend on which process works on the species
+	namgene->doViterbiPiecewise(*sfc, as, bothstrands);
+	transcripts = namgene->getAllTranscripts();
+    }
+    void write(ostream &out) const {
+	writeValue(out, transcripts != NULL);
+	if (!transcripts)
+	    return;
+	writeValue(out, transcripts->size());
+	for (list<Gene>::const_iterator it = transcripts->begin(); it != transcripts->end(); ++it) {
+	    writeStates(out, it->exons);
+	    writeStates(out, it->introns);
+	}
+    }
+    void read(istream &in) {
+	bool sampled;
+	readValue(in, sampled);
+	if (!sampled)
+	    return;
+	size_t n;
+	readValue(in, n);
+	transcripts = new list<Gene>;
+	for (size_t i=0; i < n; i++) {
+	    transcripts->push_back(Gene());
+	    transcripts->back().exons = readStates(in);
+	    transcripts->back().introns = readStates(in);
+	}
+    }
+private:
+    NAMGene *namgene;
+    AnnoSequence *as;
+    SequenceFeatureCollection *sfc;
+    unsigned int seed;
+public:
+    int speciesIdx;
+    list<Gene> *transcripts;
+};
+
+/*
+ * GeneRangeJob
+ * the prediction on one gene range: operator() samples the genes in each species and builds
+ * the species graphs, commit() does the rest and writes the output of the gene range.
+ * Several gene ranges are sampled at the same time, the commits are in the order of the
+ * gene ranges (see runInProcessesInOrder). The state passed from one gene range to the next
+ * are the counters of the IDs in the output files and the label pattern cache statistics.
+ */
+class GeneRangeJob {
+public:
+    GeneRangeJob(CGPRun *r, GeneMSA *range, int idx) :
+	run(r), index(idx), orthograph(NULL), geneRange(range), nextRange(NULL) {}
+    void operator()();
+    void commit();
+    void writeState(ostream &out) const {
+	out << GeneMSA::geneRangeID << " " << GeneMSA::orthoExonID << endl;
+	writeIDs(out, GeneMSA::exonCandID);
+	writeIDs(out, run->base_geneid);
+	writeIDs(out, run->init_geneid);
+	writeIDs(out, run->opt_geneid);
+	long hits, misses, evictions;
+	cache::getStatistics(hits, misses, evictions);
+	out << hits << " " << misses << " " << evictions << endl;
+    }
+    void readState(istream &in) {
+	in >> GeneMSA::geneRangeID >> GeneMSA::orthoExonID;
+	readIDs(in, GeneMSA::exonCandID);
+	readIDs(in, run->base_geneid);
+	readIDs(in, run->init_geneid);
+	readIDs(in, run->opt_geneid);
+	long hits, misses, evictions;
+	in >> hits >> misses >> evictions;
+	cache::setStatistics(hits, misses, evictions);
+    }
+private:
+    CGPRun *run;
+    int index;
+    OrthoGraph *orthograph;
+    vector<AnnoSequence> seqRanges;
+    vector<ostringstream*> sampledExons; // until commit()
+public:
+    GeneMSA *geneRange; // deleted by commit()
+    GeneMSA *nextRange; // its sequences are prefetched while this gene range is sampled, NULL if none
+};
+
+void GeneRangeJob::operator()(){
+    vector<string> &speciesNames = run->speciesNames;
+    NAMGene &namgene = *run->namgene;
+    RandSeqAccess *rsa = run->rsa;
+
+    cout << "processing next gene range:" << endl;
+    geneRange->printStats();
+    orthograph = new OrthoGraph();
+    seqRanges.resize(speciesNames.size());
+    vector<AnnoSequence*> seqs(speciesNames.size(), NULL);
+    vector<SpeciesSampling> samplings;
+    for (int s = 0; s < speciesNames.size(); s++)
+	sampledExons.push_back(new ostringstream());
+    // the sequences of all species at once, a database answers them with a single query
+    vector<SeqWindow> windows;
+    for (int s = 0; s < speciesNames.size(); s++)
+	if (!geneRange->getSeqID(s).empty()) // start, end refer to plus strand
+	    windows.push_back(SeqWindow(speciesNames[s], geneRange->getSeqID(s), geneRange->getStart(s),
+					geneRange->getEnd(s), geneRange->getStrand(s)));
+    vector<AnnoSequence*> fetched;
+    rsa->getSeqs(windows, fetched);
+    // the exon candidates do not use hints, but the splice site tracks computed for them look them up
+    SequenceFeatureCollection noHints(NULL);
+    StateModel::setSFC(&noHints);
+    for (int s = 0, w = 0; s < speciesNames.size(); s++) {
+	string seqID = geneRange->getSeqID(s);
+	if (!seqID.empty()) {
+	    int start = geneRange->getStart(s);
+	    int end = geneRange->getEnd(s);
+	    AnnoSequence *as = fetched[w++];
+	    if (!as) {
+		cerr << "random sequence access failed on " << speciesNames[s] << ", " << seqID << ", " 
+		     << start << ", " << end << ", " << endl;
+		while (w < fetched.size())
+		    delete fetched[w++];
+		break;
+	    } else {
+		seqs[s] = as;
+		seqRanges[s] = *as; // DNA seqs will be reused when omega is computed AND gene lists are processed for output  
+		   
+		// this is needed for IntronModel::dssProb in GenomicMSA::createExonCands
+		namgene.getPrepareModels(as->sequence, as->length); 
+		    
+		// identifies exon candidates in the sequence for species s
+		geneRange->createExonCands(s, as->sequence, namgene);
+
+		if (!run->noprediction){
+		    SequenceFeatureCollection* sfc = rsa->getFeatures(speciesNames[s],seqID,start,end,geneRange->getStrand(s));
+		    sfc->prepare(as, true);
+		    orthograph->sfcs[s] = sfc;
+		    samplings.push_back(SpeciesSampling(&namgene, as, sfc, s, index * speciesNames.size() + s + 1));
+		}
+	    }
+	}
+    }
+
+    if (nextRange) {
+	vector<SeqWindow> nextWindows;
+	for (int s = 0; s < speciesNames.size(); s++)
+	    if (!nextRange->getSeqID(s).empty())
+		nextWindows.push_back(SeqWindow(speciesNames[s], nextRange->getSeqID(s), nextRange->getStart(s),
+					    nextRange->getEnd(s), nextRange->getStrand(s)));
+	run->seqCache->prefetch(nextWindows, !run->noprediction);
+    }
+
+    // sampling, the species at the same time
+    runInProcesses(samplings, run->speciesProcs);
+
+    for (int k = 0; k < samplings.size(); k++) {
+	int s = samplings[k].speciesIdx;
+	list<Gene> *alltranscripts = samplings[k].transcripts;
+	if (alltranscripts){
+	    cout << "building Graph for " << speciesNames[s] << endl;
+	    list<ExonCandidate*> additionalExons = *(geneRange->getExonCands(s));
+	    // build datastructure for graph representation
+	    // @stlist : list of all sampled states
+	    list<Status> stlist;
+	    if(!alltranscripts->empty()){
+		buildStatusList(alltranscripts, false, stlist);
+	    }
+	    // build graph
+	    orthograph->graphs[s] = new SpeciesGraph(&stlist, seqs[s], additionalExons, speciesNames[s], 
+						     geneRange->getStrand(s), sampledExons[s]);
+	    orthograph->graphs[s]->buildGraph();
+		
+	    //save pointers to transcripts and delete them after gene list is build
+	    orthograph->ptrs_to_alltranscripts[s] = alltranscripts;
+	}
+    }
+}
+
+void GeneRangeJob::commit(){
+    for (int s = 0; s < sampledExons.size(); s++) {
+	*run->sampledExons[s] << sampledExons[s]->str();
+	delete sampledExons[s];
+    }
+    sampledExons.clear();
+
+    geneRange->printGeneRanges();
+    if (Constant::exoncands) // by default, ECs are not printed
+	geneRange->printExonCands();
+    geneRange->createOrthoExons();
+    if (run->omega)
+	geneRange->computeOmegas(seqRanges, run->omegaThreads); // omega and number of substitutions is stored as OrthoExon attribute
+    geneRange->printConsScore(seqRanges);
+
+    if (!run->noprediction){
+	list<OrthoExon> hects = geneRange->getOrthoExons();
+	orthograph->linkToOEs(hects); // link ECs in HECTs to nodes in orthograph
+
+	orthograph->outputGenes(run->baseGenes, run->base_geneid);
+	//add score for selective pressure of orthoexons
+	orthograph->addScoreSelectivePressure();
+	//determine initial path
+	orthograph->globalPathSearch();
+	orthograph->outputGenes(run->initGenes, run->init_geneid);
+	    
+	if(!orthograph->all_orthoex.empty()){
+	    if (run->dualdecomp){ // optimization via dual decomposition
+		vector< list<Gene> *> genelist(OrthoGraph::numSpecies);
+		orthograph->dualdecomp(*run->evo, genelist, GeneMSA::geneRangeID-1, run->maxIterations, run->dd_factor);
+		orthograph->filterGeneList(genelist, run->optGenes, run->opt_geneid);
+	    } else { // optimization by making small changes (moves)
+		orthograph->pruningAlgor(*run->evo);
+		orthograph->printCache();
+		orthograph->optimize(*run->evo);
+		// transfer max weight paths to genes + filter + ouput
+		orthograph->outputGenes(run->optGenes, run->opt_geneid);
+	    }
+	}
+	//geneRange->printOrthoExons(rsa); //TODO: two copies of list<OrthoExon> (class geneRange and class OrthoGraph) -> replace one copy by a pointer to the other 
+	for(list<OrthoExon>::iterator it=orthograph->all_orthoex.begin(); it != orthograph->all_orthoex.end(); it++){
+	    geneRange->printSingleOrthoExon(*it,true);
+	}
+    }
+    seqRanges.clear(); // delete sequences
+    delete geneRange;
+    geneRange = NULL;
+    delete orthograph;
+    orthograph = NULL;
+    // the next gene range may be committed by another process
+    run->flushOutputFiles();
+}
+
+/*
+ * parses the value of /CompPred/mafRegion: seqname or seqname:start-end, 1-based with end included
+ */
+static MafRegion parseMafRegion(string str){
+    string::size_type colon = str.rfind(':');
+    if (colon == string::npos)
+	return MafRegion(str);
+    int start, end;
+    char dash;
+    istringstream range(str.substr(colon + 1));
+    if (!(range >> start >> dash >> end) || dash != '-' || start < 1 || end < start)
+	throw ProjectError("/CompPred/mafRegion: expected seqname or seqname:start-end, e.g. hg19.chr21:9000000-9500000, but got " + str + ".");
+    return MafRegion(str.substr(0, colon), start - 1, end);
+}
+
+/*
+ * the parts of the alignment that are read and predicted on one after the other
+ * none if the whole alignment is read at once
+ */
+static vector<MafRegion> getMafRegions(GenomicMSA &msa){
+    vector<MafRegion> regions;
+    const char *regionstr = NULL;
+    try {
+	regionstr = Properties::getProperty("/CompPred/mafRegion");
+    } catch (...) {}
+    bool bySeq = false;
+    try {
+	bySeq = Properties::getBoolProperty("/CompPred/mafBySeq");
+    } catch (...) {}
+    if (regionstr && *regionstr)
+	regions.push_back(parseMafRegion(regionstr));
+    else if (bySeq) {
+	vector<string> seqnames = msa.getMafSeqNames(Constant::alnfile);
+	for (int i=0; i < seqnames.size(); i++)
+	    regions.push_back(MafRegion(seqnames[i]));
+    }
+    return regions;
+}
+
+/*
+ * finds the gene ranges in the alignment msa has read and predicts genes on them
+ * numGeneRanges counts the gene ranges of all calls, it continues the random seeds
+ */
+static void predictOnGeneRanges(GenomicMSA &msa, CGPRun &run, int numProcs, int &numGeneRanges){
+    msa.compactify(); // trivial mergers of neighboring alignments
+    msa.findGeneRanges(); // nontrivial summary of alignments
+    //msa.printAlignment("");
+    //exit(0);
+
+    vector<GeneRangeJob> jobs;
+    while (GeneMSA *geneRange = msa.getNextGene())
+	jobs.push_back(GeneRangeJob(&run, geneRange, numGeneRanges++));
+    // prefetching only pays off if the jobs run one after the other in this process
+    // and it must not run while the species samplings are forked
+    if (run.seqCache && numProcs <= 1 && run.speciesProcs <= 1)
+	for (int i=0; i+1 < jobs.size(); i++)
+	    jobs[i].nextRange = jobs[i+1].geneRange;
+    run.flushOutputFiles(); // the worker processes write to the same files
+    runInProcessesInOrder(jobs, numProcs);
+    if (run.seqCache)
+	run.seqCache->waitForPrefetch(); // before the next region is read
+    for (int i=0; i < jobs.size(); i++)
+	delete jobs[i].geneRange; // left over if committed in a worker process
+}
+
 void CompGenePred::start(){
 
     // read in alignment, determine orthologous sequence fragments
@@ -50,6 +509,13 @@ void CompGenePred::start(){
     GeneMSA::setTree(&tree);
     OrthoGraph::numSpecies = OrthoGraph::tree->numSpecies();
     Boolean noprediction = false;
+    int labelCacheSize; // maximal number of label patterns whose score is cached
+    try {
+	labelCacheSize = Properties::getIntProperty("/CompPred/labelCacheSize");
+    } catch (...) {
+	labelCacheSize = 1000000;
+    }
+    cache::init(OrthoGraph::numSpecies, labelCacheSize);
 
 #ifdef DEBUG
     cout << "-------------------------------\nparameters phylogenetic model\n-------------------------------" << endl;
@@ -90,13 +556,14 @@ void CompGenePred::start(){
     }
 
     //initialize output files of initial gene prediction and optimized gene prediction
-    vector<ofstream*> baseGenes = initOutputFiles(".base"); // equivalent to MEA prediction
-    vector<int> base_geneid(OrthoGraph::numSpecies, 1); // gene numbering
-    vector<ofstream*> initGenes = initOutputFiles(".init"); // score added to all orthologous exons and penalty added to all non orthologous exons, then global path search repeated
-    vector<int> init_geneid(OrthoGraph::numSpecies, 1);
-    vector<ofstream*> optGenes = initOutputFiles();  //optimized gene prediction by applying majority rule move
-    vector<int> opt_geneid(OrthoGraph::numSpecies, 1);
-    vector<ofstream*> sampledExons = initOutputFiles(".sampled_ECs");
+    CGPRun run;
+    run.baseGenes = initOutputFiles(".base"); // equivalent to MEA prediction
+    run.base_geneid.resize(OrthoGraph::numSpecies, 1); // gene numbering
+    run.initGenes = initOutputFiles(".init"); // score added to all orthologous exons and penalty added to all non orthologous exons, then global path search repeated
+    run.init_geneid.resize(OrthoGraph::numSpecies, 1);
+    run.optGenes = initOutputFiles();  //optimized gene prediction by applying majority rule move
+    run.opt_geneid.resize(OrthoGraph::numSpecies, 1);
+    run.sampledExons = initOutputFiles(".sampled_ECs");
 
     BaseCount::init();
     PP::initConstants();
@@ -123,6 +590,40 @@ void CompGenePred::start(){
     // printCodonMatrix(P);
     GeneMSA::setCodonEvo(&codonevo);
   
+    int numProcs = getNumThreads();
+    try {
+	run.speciesProcs = Properties::getIntProperty("/CompPred/speciesThreads");
+    } catch (...) {
+	run.speciesProcs = 1;
+    }
+    if ((numProcs > 1 || run.speciesProcs > 1) && !Constant::dbaccess.empty()) {
+	cerr << "Warning: with database access the gene ranges and species are processed in a single process." << endl;
+	numProcs = run.speciesProcs = 1;
+    }
+    try {
+	run.omega = Properties::getBoolProperty("/CompPred/omega");
+    } catch (...) {
+	run.omega = false;
+    }
+    try {
+	run.omegaThreads = Properties::getIntProperty("/CompPred/omegaThreads");
+    } catch (...) {
+	run.omegaThreads = 1;
+    }
+    int seqCacheSize; // memory budget in MB for cached sequences and hints
+    try {
+	seqCacheSize = Properties::getIntProperty("/CompPred/seqCacheSize");
+    } catch (...) {
+	seqCacheSize = 0;
+    }
+    run.seqCache = NULL;
+    if (seqCacheSize > 0) {
+	if (numProcs > 1) // the gene ranges are processed in child processes, which do not share a cache
+	    cerr << "Warning: /CompPred/seqCacheSize is only used with --threads=1. Turned the sequence cache off." << endl;
+	else
+	    rsa = run.seqCache = new CachedSeqAccess(rsa, (size_t) seqCacheSize * 1048576);
+    }
+
     vector<string> speciesNames;
     OrthoGraph::tree->getSpeciesNames(speciesNames);
     rsa->setSpeciesNames(speciesNames);
@@ -141,112 +642,43 @@ void CompGenePred::start(){
 	cout << "omega= " << omega << " subst= " << subst << endl;
 	exit(1);
     }
-    GenomicMSA msa(rsa);
-    msa.readAlignment(Constant::alnfile);  // reads the alignment
-    // rsa->printStats();
-    msa.compactify(); // trivial mergers of neighboring alignments
-    msa.findGeneRanges(); // nontrivial summary of alignments
-  
-    //msa.printAlignment("");
-    //exit(0);
+    run.rsa = rsa;
+    run.namgene = &namgene;
+    run.evo = &evo;
+    run.speciesNames = speciesNames;
+    run.noprediction = noprediction;
+    run.dualdecomp = dualdecomp;
+    run.maxIterations = maxIterations;
+    run.dd_factor = dd_factor;
 
     GeneMSA::openOutputFiles();
-    while (GeneMSA *geneRange = msa.getNextGene()) {
-	cout << "processing next gene range:" << endl;
-	geneRange->printStats();
-        OrthoGraph orthograph;
-	vector<AnnoSequence> seqRanges(speciesNames.size());
-        for (int s = 0; s < speciesNames.size(); s++) {
-            string seqID = geneRange->getSeqID(s);
-            if (!seqID.empty()) {
-		int start = geneRange->getStart(s); // start, end refer to plus strand
-		int end = geneRange->getEnd(s);
-		AnnoSequence *as = rsa->getSeq(speciesNames[s], seqID, start, end, geneRange->getStrand(s));
-                if (!as) {
-                    cerr << "random sequence access failed on " << speciesNames[s] << ", " << seqID << ", " 
-			 << start << ", " << end << ", " << endl;
-                    break;
-                } else {
-		    seqRanges[s] = *as; // DNA seqs will be reused when omega is computed AND gene lists are processed for output  
-		   
-		    // this is needed for IntronModel::dssProb in GenomicMSA::createExonCands
-                    namgene.getPrepareModels(as->sequence, as->length); 
-		    
-		    // identifies exon candidates in the sequence for species s
-                    geneRange->createExonCands(s, as->sequence);
-		    list<ExonCandidate*> additionalExons = *(geneRange->getExonCands(s));
-		    list<Gene> *alltranscripts = NULL;
-
-		    if (!noprediction){
-			SequenceFeatureCollection* sfc = rsa->getFeatures(speciesNames[s],seqID,start,end,geneRange->getStrand(s));
-			sfc->prepare(as, true);
-			namgene.doViterbiPiecewise(*sfc, as, bothstrands); // sampling
-			alltranscripts = namgene.getAllTranscripts();
-			orthograph.sfcs[s] = sfc;
-		    }
-		     if (alltranscripts){
-                        cout << "building Graph for " << speciesNames[s] << endl;
-			// build datastructure for graph representation
-			// @stlist : list of all sampled states
-			list<Status> stlist;
-			if(!alltranscripts->empty()){
-                            buildStatusList(alltranscripts, false, stlist);
-                        }
-                        // build graph
-                        orthograph.graphs[s] = new SpeciesGraph(&stlist, as, additionalExons, speciesNames[s], 
-								geneRange->getStrand(s), sampledExons[s]);
-                        orthograph.graphs[s]->buildGraph();
-			
-			//save pointers to transcripts and delete them after gene list is build
-                        orthograph.ptrs_to_alltranscripts[s] = alltranscripts;
-		    }
-                }
-            }
-        }
-	geneRange->printGeneRanges();
-	if (Constant::exoncands) // by default, ECs are not printed
-	    geneRange->printExonCands();
-	geneRange->createOrthoExons();
-	//geneRange->computeOmegas(seqRanges); // omega and number of substitutions is stored as OrthoExon attribute
-	geneRange->printConsScore(seqRanges);
-
-	if (!noprediction){
-	    list<OrthoExon> hects = geneRange->getOrthoExons();
-	    orthograph.linkToOEs(hects); // link ECs in HECTs to nodes in orthograph
-
-	    orthograph.outputGenes(baseGenes,base_geneid);
-	    //add score for selective pressure of orthoexons
-	    orthograph.addScoreSelectivePressure();
-	    //determine initial path
-	    orthograph.globalPathSearch();
-	    orthograph.outputGenes(initGenes,init_geneid);
-	    
-	    if(!orthograph.all_orthoex.empty()){
-		if (dualdecomp){ // optimization via dual decomposition
-		    vector< list<Gene> *> genelist(OrthoGraph::numSpecies);
-		    orthograph.dualdecomp(evo,genelist,GeneMSA::geneRangeID-1,maxIterations, dd_factor);
-		    orthograph.filterGeneList(genelist,optGenes,opt_geneid);
-		} else { // optimization by making small changes (moves)
-		    orthograph.pruningAlgor(evo);
-		    orthograph.printCache();
-		    orthograph.optimize(evo);
-		    // transfer max weight paths to genes + filter + ouput
-		    orthograph.outputGenes(optGenes, opt_geneid);
-		}
-	    }
-	    //geneRange->printOrthoExons(rsa); //TODO: two copies of list<OrthoExon> (class geneRange and class OrthoGraph) -> replace one copy by a pointer to the other 
-	    for(list<OrthoExon>::iterator it=orthograph.all_orthoex.begin(); it != orthograph.all_orthoex.end(); it++){
-		geneRange->printSingleOrthoExon(*it,true);
-	    }
+    GenomicMSA msa(rsa);
+    vector<MafRegion> regions = getMafRegions(msa);
+    int numGeneRanges = 0;
+    if (regions.empty()) {
+	msa.readAlignment(Constant::alnfile);  // reads the alignment
+	// rsa->printStats();
+	predictOnGeneRanges(msa, run, numProcs, numGeneRanges);
+    } else {
+	// only the alignment of one region is in memory at a time
+	for (int r=0; r < regions.size(); r++) {
+	    cout << "reading alignment region " << regions[r].seqname;
+	    if (regions[r].start > 0 || regions[r].end < INT_MAX)
+		cout << ":" << regions[r].start + 1 << "-" << regions[r].end;
+	    cout << endl;
+	    msa.readAlignment(Constant::alnfile, regions[r]);
+	    predictOnGeneRanges(msa, run, numProcs, numGeneRanges);
 	}
-	seqRanges.clear(); // delete sequences
-	delete geneRange;
     }
+    cache::printStatistics();
+    if (run.seqCache)
+	run.seqCache->printStatistics();
 
     GeneMSA::closeOutputFiles();
 
-    closeOutputFiles(initGenes);
-    closeOutputFiles(baseGenes);
-    closeOutputFiles(optGenes);
+    closeOutputFiles(run.initGenes);
+    closeOutputFiles(run.baseGenes);
+    closeOutputFiles(run.optGenes);
+    closeOutputFiles(run.sampledExons);
 
 }
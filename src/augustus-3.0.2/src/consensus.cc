@@ -7,12 +7,110 @@
  **********************************************************************/
 
 #include "consensus.hh"
+#include "parallel.hh"
 
 const int max_line_len=100;
 const int nRep=20;
 
 using namespace std;
 
+/*
+ * number of mismatches between two patterns of the same length given as integers
+ * (2 bits per base as in Seq2Int): the bits of each differing base are folded into one
+ * and counted
+ */
+static inline int count_mismatches(int a, int b){
+  unsigned int x = a ^ b;
+  return __builtin_popcount((x | (x >> 1)) & 0x55555555u);
+}
+
+/*
+ * stores in codes the integers of all patterns of length size in s, like Seq2Int
+ * with the first base in the highest bits, and -1 for the patterns with a character
+ * other than ACGT. The integer is updated from the previous position.
+ */
+static void pattern_codes(const string &s, int size, vector<int> &codes){
+  int n = (int) s.length() - size + 1;
+  codes.assign(n > 0 ? n : 0, -1);
+  unsigned int mask = (size < 16) ? (1u << (2*size)) - 1 : ~0u;
+  unsigned int code = 0;
+  int valid = 0; // number of ACGT characters ending at the current position
+  for (int j=0; j<s.length(); j++){
+    int b;
+    switch (s[j]){
+    case 'a': case 'A': b=0; break;
+    case 'c': case 'C': b=1; break;
+    case 'g': case 'G': b=2; break;
+    case 't': case 'T': b=3; break;
+    default: b=-1;
+    }
+    if (b < 0){
+      valid = 0;
+      continue;
+    }
+    code = ((code << 2) | b) & mask;
+    if (++valid >= size)
+      codes[j-size+1] = code;
+  }
+}
+
+/*
+ * counts for the input sequences begin,...,end-1 in how many of them each pattern occurs
+ */
+class FrequencyCounter {
+public:
+  FrequencyCounter(const vector<sequence> *v, int b, int e, int size) : var(v), begin(b), end(e), pattern_size(size) {}
+  void operator()(){
+    int n = 1 << (2*pattern_size);
+    f_values.assign(n, 0);
+    vector<int> last_seq(n, -1); // last sequence in which the pattern was seen
+    vector<int> codes;
+    for (int i=begin; i<end; i++){
+      if ((*var)[i].seq.length() < pattern_size)
+	continue;
+      pattern_codes((*var)[i].seq, pattern_size, codes);
+      for (int j=0; j<codes.size(); j++)
+	if (codes[j] >= 0 && last_seq[codes[j]] != i){
+	  last_seq[codes[j]] = i;
+	  f_values[codes[j]]++;
+	}
+    }
+  }
+  vector<int> f_values;
+private:
+  const vector<sequence> *var;
+  int begin, end, pattern_size;
+};
+
+/*
+ * counts for the input sequences begin,...,end-1 the occurrences of the given patterns at each position
+ */
+class OccurrenceCounter {
+public:
+  OccurrenceCounter(const vector<sequence> *v, int b, int e, int size, const vector<int> *p, int len) :
+    var(v), begin(b), end(e), pattern_size(size), patterns(p), max_length(len) {}
+  void operator()(){
+    counts.assign(patterns->size(), vector<int>(max_length, 0));
+    vector<int> codes;
+    for (int i=begin; i<end; i++){
+      if ((*var)[i].seq.length() < pattern_size)
+	continue;
+      pattern_codes((*var)[i].seq, pattern_size, codes);
+      for (int j=0; j<codes.size(); j++)
+	if (codes[j] >= 0)
+	  for (int k=0; k<patterns->size(); k++)
+	    if ((*patterns)[k] == codes[j])
+	      counts[k][j]++;
+    }
+  }
+  vector<vector<int> > counts;
+private:
+  const vector<sequence> *var;
+  int begin, end, pattern_size;
+  const vector<int> *patterns;
+  int max_length;
+};
+
 consensus::consensus(int starting1,int ending1){
   //gives default value to the paramters
   pattern_size=6;
@@ -23,11 +121,11 @@ consensus::consensus(int starting1,int ending1){
   starting=starting1;
   ending=ending1;
   analyse_pattern="none";
+  num_threads=1;
   
   //clears all the vectors used 
   var.clear();
   powers.clear();
-  t_values.clear();
   f_values.clear();
   r_values.clear();
   mean_values.clear();
@@ -44,7 +142,6 @@ consensus::consensus(int starting1,int ending1){
 
   //initialises the mean value, significance value, relevant value vectors
   for(i=0;i<pow((double)4,(double)pattern_size);i++){
-    t_values.push_back(0);
     f_values.push_back(0);
     r_values.push_back(0);
     mean_values.push_back(0);
@@ -64,12 +161,15 @@ void consensus::set_values(int pattern_size1,float p_value1, float delta1, int m
     powers.push_back(pow((double)4,(double)i));
 
   for(i=0;i<pow((double)4,(double)pattern_size);i++){
-    t_values.push_back(0);
     f_values.push_back(0);
     r_values.push_back(0);
     mean_values.push_back(0);
   }
 }
+void consensus::set_threads(int n){
+  num_threads = (n < 1)? 1 : n;
+}
+
 void consensus::set_file_name(string filename){
   //reading the file and storing the strings
   string fileline,fileline1;
@@ -94,7 +194,6 @@ void consensus::set_file_name(string filename){
 	temp_starting=starting;
 	temp_ending=ending;
       }
-      char *buf=new char[fileline.length()];//stores the required length of string
       if ((starting>=0 && fileline.length()>temp_starting) || (starting<0 && temp_ending>0)){//if the length of string is less than start then ignore it
 	if( (starting>=0 && (ending==0||ending>fileline.length()))|| (starting<0 && temp_starting<0)){//if end is not defined or it is shorter then take the available string
 	  if(starting >=0){
@@ -112,7 +211,7 @@ void consensus::set_file_name(string filename){
 	    len1=ending-starting+1;
 	  }
 	}	  
-	temp.seq=buf;//string is copied to the structure
+	temp.seq=fileline.substr(temp_starting>0? temp_starting : 0);//the window is copied to the structure
 	temp.seq.erase(len1-1);//extra length is erased
 	temp.length=len1;
 	var.push_back(temp);
@@ -133,7 +232,6 @@ void consensus::set_file_name(string filename){
     temp_starting=starting;
     temp_ending=ending;
   }
-  char *buf=new char[fileline.length()];//stores the required length of string
   if ((starting>=0 && fileline.length()>temp_starting) || (starting<0 && temp_ending>0)){//if the length of string is less than start then ignore it
     if( (starting>=0 && (ending==0||ending>fileline.length()))|| (starting<0 && temp_starting<0)){//if end is not defined or it is shorter then take the available string
       if(starting >=0){
@@ -151,7 +249,7 @@ void consensus::set_file_name(string filename){
 	len1=ending-starting+1;
       }
     }
-    temp.seq=buf;
+    temp.seq=fileline.substr(temp_starting>0? temp_starting : 0);
     temp.seq.erase(len1-1);
     temp.length=len1;
     var.push_back(temp);
@@ -177,7 +275,6 @@ void consensus::add_string(string fileline){
     temp_starting=starting;
     temp_ending=ending;
   }
-  char *buf=new char[fileline.length()];//stores the required length of string
   if ((starting>=0 && fileline.length()>temp_starting) || (starting<0 && temp_ending>0)){//if the length of string is less than start then ignore it
     if( (starting>=0 && (ending==0||ending>fileline.length()))|| (starting<0 && temp_starting<0)){//if end is not defined or it is shorter then take the available string
       if(starting >=0){
@@ -195,7 +292,7 @@ void consensus::add_string(string fileline){
 	len1=ending-starting+1;
       }
     }
-    temp.seq=buf;
+    temp.seq=fileline.substr(temp_starting>0? temp_starting : 0);
     temp.seq.erase(len1-1);
     temp.length=len1;
     var.push_back(temp);
@@ -246,7 +343,7 @@ double consensus::poisInv(double a,double b,float p,int n,int i){
 
 
 void consensus::start(){
-  int i,j,k,m,sum,sum1,number;
+  int i,j,k,m,sum;
   float L[30];//stores the poison thresholds for calculating the significance values
   for(i=0;i<30;i++)
     L[i]=poisThresh(i+1,p_value);//calls the function to calculate the threshold values
@@ -286,25 +383,7 @@ void consensus::start(){
       tpm[i][j]=tpm[i][j]/sum;	
   }
   //calculating the f values
-  for(i=0;i<number_seq;i++){ 
-    if(var[i].seq.length()<pattern_size) 
-      continue;
-    for(k=0;k<pow((double)4,(double)pattern_size);k++)
-      t_values[k]=0;
-    for( j=0;j<var[i].seq.length()- pattern_size + 1;j++){ 
-      try{	  
-	number = s2i(var[i].seq.c_str()+j);
-	if(t_values[number]==0)
-	  {
-	    f_values[number]++;
-	    t_values[number]=1;
-	  } 
-      }
-      catch(exception& e ){
-	//ignoring the exception
-      }
-    }
-  }
+  count_frequencies();
   cout << " calculated the frequencies " << endl;
   //calculating the mean value and storing the significance patterns
   sum=0;
@@ -329,7 +408,7 @@ void consensus::start(){
       if(z<p_value)
 	significant_strings.push_back(i);
     }
-    else{//use the poisson distribution
+    else if(f_values[i]>0){//use the poisson distribution
       if(L[f_values[i]-1]>mean_values[i])
 	 significant_strings.push_back(i);
     }
@@ -345,8 +424,13 @@ void consensus::start(){
   sum=0;
 
   int max=0,max_index=0,counter=0;
-  vector<int> prev_neighbours,new_neighbours;
+  vector<int> prev_neighbours;
   vector<int> neighbours_index;    
+  vector<int> sum_mismatch(max_allowed_mismatch+1);
+  vector<int> significant_index(f_values.size(), -1); // position of a pattern in significant_strings
+  int neighbourhood_size=0;
+  for(j=0;j<=max_allowed_mismatch && j<=pattern_size;j++)
+    neighbourhood_size+=(int)pow((double)3,(double)j)*nCr(pattern_size,j);
   //greedy method to calculate the cumulative neighbourhood significance values
   cout << "Calculating the greedy way " << endl;
   while(relevant_strings.size()>0){    
@@ -354,37 +438,48 @@ void consensus::start(){
     if(counter>no_iterations)
       break;
     max=0;
+    for(k=0;k<significant_strings.size();k++)
+      significant_index[significant_strings[k]]=k;
     for(i=0;i<relevant_strings.size();i++){
-      sum=0;//initialize the sum value
-      new_neighbours.clear();
-      
       //adds the cumulative f values for all the k neighbours
-      for(j=0;j<=max_allowed_mismatch;j++){
-	sum1=0;
-
-	neighbours_index.clear();//clears the previous neighbour values
-	//find all the neighbours with j mismatches
-	neighbours_index=find_neighbours(relevant_strings[i],j,pattern_size);
-	//store the neighbours for adding the values and erasing from the lists
-	for(m=0;m<neighbours_index.size();m++)
-	  for(k=0;k<significant_strings.size();k++){
-	    if(neighbours_index[m]==significant_strings[k]){
-	      sum1+=f_values[neighbours_index[m]];
-	      new_neighbours.push_back(k);
-	      break;
-	    }
-	  }
-	sum=sum+sum1/(int)(pow((double)3,(double)j)*nCr(pattern_size,j));
+      sum_mismatch.assign(max_allowed_mismatch+1, 0);
+      if(neighbourhood_size<significant_strings.size()){
+	//look up the neighbours with j mismatches in the significant strings
+	for(j=0;j<=max_allowed_mismatch;j++){
+	  neighbours_index=find_neighbours(relevant_strings[i],j,pattern_size);
+	  for(m=0;m<neighbours_index.size();m++)
+	    if(significant_index[neighbours_index[m]]>=0)
+	      sum_mismatch[j]+=f_values[neighbours_index[m]];
+	}
+      } else {
+	//count the mismatches of all significant strings bitwise
+	for(k=0;k<significant_strings.size();k++){
+	  int d=count_mismatches(relevant_strings[i],significant_strings[k]);
+	  if(d<=max_allowed_mismatch)
+	    sum_mismatch[d]+=f_values[significant_strings[k]];
+	}
       }
+      sum=0;//initialize the sum value
+      for(j=0;j<=max_allowed_mismatch && j<=pattern_size;j++)
+	sum=sum+sum_mismatch[j]/(int)(pow((double)3,(double)j)*nCr(pattern_size,j));
 
       if(sum>=max){
 	max=sum;
 	max_index=i;
-	prev_neighbours.clear();
-	prev_neighbours=new_neighbours;
-	new_neighbours.clear();
       }
     }
+    //store the neighbours of the consensus pattern for erasing from the lists, with j mismatches
+    //in the order of find_neighbours
+    prev_neighbours.clear();
+    for(j=0;j<=max_allowed_mismatch;j++){
+      neighbours_index=find_neighbours(relevant_strings[max_index],j,pattern_size);
+      for(m=0;m<neighbours_index.size();m++)
+	if(significant_index[neighbours_index[m]]>=0)
+	  prev_neighbours.push_back(significant_index[neighbours_index[m]]);
+    }
+    for(k=0;k<significant_strings.size();k++)
+      significant_index[significant_strings[k]]=-1;
+
     //storing details of the consensus pattern
     consensus_data.push_back(relevant_strings[max_index]);
     histogram_data temp1;
@@ -467,34 +562,13 @@ void consensus::start(){
   cout<<" calculated the first "<< no_iterations << " consensus patterns."  << endl; 
 
   //storing the histogram data in a structure
-  max_freq=0;
-  for(k=0;k<final_list.size();k++){
+  for(k=0;k<final_list.size();k++)
     cout << " storing histogram for sequence " << final_list[k].consensus_pattern<<endl;
-    for(i=0;i<max_string_length;i++)
-      final_list[k].position_of_occurence.push_back(0);
-    for(i=0;i<number_seq;i++){      
-      if(var[i].seq.length()<pattern_size) 
-	continue;
-      //for(k=0;k<pow((double)4,(double)pattern_size);k++)
-      //t_values[k]=0;
-      for( j=0;j<var[i].seq.length()- pattern_size +1;j++){ 
-	try{
-	  if(consensus_data[k] == s2i(var[i].seq.c_str()+j)){
-	    final_list[k].position_of_occurence[j]++;
-	    if(final_list[k].position_of_occurence[j]>max_freq)
-	      max_freq=final_list[k].position_of_occurence[j];
-	  }
-	}
-	catch(exception& e ){
-	  //ignoring the exception
-	}
-      }
-    }
-  }
+  count_occurences(consensus_data);
 }
 
 void consensus::analyse(string pattern1,float p_value1,float delta1,int max_allowed_mismatch1){
-  int i,j,k,sum,number,number1,flag;
+  int i,j,sum,number,number1,flag;
   histogram_data data1;
   analyse_pattern=pattern1;
   pattern_size=analyse_pattern.length();
@@ -510,7 +584,6 @@ void consensus::analyse(string pattern1,float p_value1,float delta1,int max_allo
   neighbours_list=find_neighbours(number,max_allowed_mismatch,pattern_size);
 
   for(i=0;i<pow((double)4,(double)pattern_size);i++){
-    t_values.push_back(0);
     f_values.push_back(0);
     r_values.push_back(0);
     mean_values.push_back(0);
@@ -553,25 +626,7 @@ void consensus::analyse(string pattern1,float p_value1,float delta1,int max_allo
   }
 
   //calculating the f values
-  for(i=0;i<number_seq;i++){ 
-    if(var[i].seq.length()<pattern_size) 
-      continue;
-    for(k=0;k<pow((double)4,(double)pattern_size);k++)
-      t_values[k]=0;
-    for( j=0;j<var[i].seq.length()- pattern_size + 1;j++){ 
-      try{	  
-	number1 = s2i(var[i].seq.c_str()+j);
-	if(t_values[number]==0)
-	  {
-	    f_values[number1]++;
-	    t_values[number1]=1;
-	  } 
-      }
-      catch(exception& e ){
-	//ignoring the exception
-      }
-    }
-  }
+  count_frequencies();
 
   cout << " calculated the frequenecy values" << endl;
   data1.consensus_pattern=analyse_pattern;
@@ -601,7 +656,7 @@ void consensus::analyse(string pattern1,float p_value1,float delta1,int max_allo
       if(z<p_value)
 	flag=1;
     }
-    else{//use the poisson distribution
+    else if(f_values[number1]>0){//use the poisson distribution
       if(L[f_values[number1]-1]>mean_values[number1])
 	flag=1;
     }
@@ -616,27 +671,43 @@ void consensus::analyse(string pattern1,float p_value1,float delta1,int max_allo
   data1.mean_value=mean_values[number];
   final_list.push_back(data1);
   //storing the histogram
+  cout << " storing histogram for sequence " << data1.consensus_pattern<<endl;
+  count_occurences(vector<int>(1,number));
+}
+
+/*
+ * the input sequences are split into num_threads parts, which are counted in parallel
+ */
+void consensus::count_frequencies(){
+  vector<FrequencyCounter> counters;
+  int parts = (num_threads < number_seq)? num_threads : number_seq;
+  for(int t=0;t<parts;t++)
+    counters.push_back(FrequencyCounter(&var, t*number_seq/parts, (t+1)*number_seq/parts, pattern_size));
+  f_values.assign(1 << (2*pattern_size), 0);
+  if(parts==0)
+    return;
+  runInThreads(counters);
+  for(int t=0;t<parts;t++)
+    for(int i=0;i<f_values.size();i++)
+      f_values[i]+=counters[t].f_values[i];
+}
+
+void consensus::count_occurences(const vector<int> &patterns){
+  vector<OccurrenceCounter> counters;
+  int parts = (num_threads < number_seq)? num_threads : number_seq;
+  for(int t=0;t<parts;t++)
+    counters.push_back(OccurrenceCounter(&var, t*number_seq/parts, (t+1)*number_seq/parts, pattern_size, &patterns, max_string_length));
+  if(parts>0)
+    runInThreads(counters);
   max_freq=0;
-  for(k=0;k<final_list.size();k++){
-    cout << " storing histogram for sequence " << final_list[k].consensus_pattern<<endl;
-    for(i=0;i<max_string_length;i++)
-      final_list[k].position_of_occurence.push_back(0);
-    for(i=0;i<number_seq;i++){      
-      if(var[i].seq.length()<pattern_size) 
-	continue;
-      for( j=0;j<var[i].seq.length()- pattern_size +1;j++){ 
-	try{
-	  if(number == s2i(var[i].seq.c_str()+j)){
-	    final_list[k].position_of_occurence[j]++;
-	    if(final_list[k].position_of_occurence[j]>max_freq)
-	      max_freq=final_list[k].position_of_occurence[j];
-	  }
-	}
-	catch(exception& e ){
-	  //ignoring the exception
-	}
-      }
-    }
+  for(int k=0;k<patterns.size();k++){
+    final_list[k].position_of_occurence.assign(max_string_length,0);
+    for(int t=0;t<parts;t++)
+      for(int j=0;j<max_string_length;j++)
+	final_list[k].position_of_occurence[j]+=counters[t].counts[k][j];
+    for(int j=0;j<max_string_length;j++)
+      if(final_list[k].position_of_occurence[j]>max_freq)
+	max_freq=final_list[k].position_of_occurence[j];
   }
 }
 
@@ -731,7 +802,7 @@ char consensus::num2char(int a){
 }
 
 //k mismatch function starts here
-void consensus::k_mismatch(int new_m, int old_m, int k, int length,Seq2Int s2i,vector<int> &neighbours_index){
+void consensus::k_mismatch(int new_m, int old_m, int k, int length,vector<int> &neighbours_index){
   int i,temp_length,temp_k;
   //return if number of mismatches to do is more than the available length
   if(k> length){
@@ -745,48 +816,22 @@ void consensus::k_mismatch(int new_m, int old_m, int k, int length,Seq2Int s2i,v
 
   //without changing the last element
   temp_length=length-1;
-  k_mismatch(new_m,old_m,k,temp_length,s2i,neighbours_index);
-  //change the last element
+  k_mismatch(new_m,old_m,k,temp_length,neighbours_index);
+  //change the last element, which has 2 bits at position pattern_size-length from the right
   temp_k=k-1;
+  int shift=2*(pattern_size-length);
+  int current_int=(new_m>>shift)&3;
   for(i=0;i<4;i++){
-    int current_int=char2num(s2i.inv(new_m)[length-1]);
     if(current_int==i)
       continue;
-    k_mismatch((int)(new_m+(i-current_int)*powers[length-1]),old_m,temp_k,temp_length,s2i,neighbours_index);
+    k_mismatch(new_m+((i-current_int)<<shift),old_m,temp_k,temp_length,neighbours_index);
   }
     
 }
 
 vector<int> consensus::find_neighbours(int m,int k, int length){
   vector<int> neighbours_index;
-  static Seq2Int s2i(length);
-  neighbours_index.clear();
-  k_mismatch(m,m,k,length,s2i,neighbours_index);
+  k_mismatch(m,m,k,length,neighbours_index);
   return neighbours_index;
 }
 //mismatch function ends here
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
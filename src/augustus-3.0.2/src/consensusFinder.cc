@@ -18,7 +18,7 @@ void print_consensus(vector<histogram_data> final_list){
 }
 
 void usage(){
-  cout<<"Usage:\n ./consensusFinder input fasta file [options] \n -l:pattern length\n -p:p value for finding the significant strings \n -d:delta to find the relevant strings\n -s:starting position\n -e:ending position\n -m:no. of mismatches to consider while finding neighbours\n -c:string to consider for analysis\n -n:to specify the number of consensus patterns to store\n -t:to print the histogram\n -h:help\n"; 
+  cout<<"Usage:\n ./consensusFinder input fasta file [options] \n -l:pattern length\n -p:p value for finding the significant strings \n -d:delta to find the relevant strings\n -s:starting position\n -e:ending position\n -m:no. of mismatches to consider while finding neighbours\n -c:string to consider for analysis\n -n:to specify the number of consensus patterns to store\n -t:to print the histogram\n -T:number of threads to count the patterns\n -h:help\n"; 
 
 }
 int main(int argc, char** argv){
@@ -27,7 +27,7 @@ int main(int argc, char** argv){
   int pattern_size=6,no_iterations=10;
   float p_value=.01;
   float delta=2;
-  int max_allowed_mismatch=1,start=0,end=0,plot_hist=0;
+  int max_allowed_mismatch=1,start=0,end=0,plot_hist=0,threads=1;
   string pattern="none";
   int c,index,longIndex;
   static const struct option longOpts[]={
@@ -40,11 +40,12 @@ int main(int argc, char** argv){
     {"no_consensus",required_argument,NULL,'n'},
     {"print_hist",no_argument,NULL,'t'},
     {"string_to_analyse",required_argument,NULL,'c'},
+    {"threads",required_argument,NULL,'T'},
     {"help",no_argument,NULL,'h'},
     { NULL, no_argument, NULL, 0 }
     };
   opterr = 0;  
-  while ((c = getopt_long (argc, argv, ":thl:p:d:m:s:n:e:c:",longOpts, &longIndex)) != -1){
+  while ((c = getopt_long (argc, argv, ":thl:p:d:m:s:n:e:c:T:",longOpts, &longIndex)) != -1){
     switch (c)
       {
       case 'l':
@@ -74,6 +75,9 @@ int main(int argc, char** argv){
       case 'c':
 	pattern=optarg;
 	break;
+      case 'T':
+	threads = atoi(optarg);
+	break;
       case 'h':    
 	usage();
 	exit(0);
@@ -97,6 +101,7 @@ int main(int argc, char** argv){
     filename=argv[index];
 
   consensus consensus1(start,end);
+  consensus1.set_threads(threads);
   consensus1.set_file_name(filename);
 
   if(pattern=="none"){
@@ -18,30 +18,127 @@
 #include "geneticcode.hh"
 #include "properties.hh"
 #include "phylotree.hh"
+#include "parallel.hh"
 
 // standard C/C++ includes
 #include <iostream>
 #include <iomanip>
 #include <vector> 
 #include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdint.h>
+#include <unistd.h>
 
 
 // destructor
 Evo::~Evo(){
     times.clear();
-    for (int i=0; i < allPs.getColSize(); i++)
-	for (int j=0; j< allPs.getRowSize(); j++){
-	    gsl_matrix_free(allPs[i][j]);
-	}
     allPs.assign(0, 0, NULL);
-    for (int i=0; i < allLogPs.getColSize(); i++)
-    	for (int j=0; j< allLogPs.getRowSize(); j++){
-    	    gsl_matrix_free(allLogPs[i][j]);
-    	}
     allLogPs.assign(0, 0, NULL);
+    free(matrixData);
     delete[] pi;
 }
 
+void Evo::allocMatrices(int rows, int cols){
+    size_t size = states * states;
+    double *data = NULL;
+    if (rows > 0 && cols > 0 && posix_memalign((void**) &data, 64, 2 * rows * cols * size * sizeof(double)))
+	throw ProjectError("Evo::allocMatrices: could not allocate memory for the substitution matrices.");
+    // matrices that are not computed (e.g. all but allLogPs[0][0] in Parsimony) are zero
+    if (data)
+	memset(data, 0, 2 * rows * cols * size * sizeof(double));
+    // keep the matrices that are still in range
+    for (int u=0; u < rows && u < matrixRows; u++)
+	for (int v=0; v < cols && v < matrixCols; v++)
+	    for (int l=0; l < 2; l++)
+		memcpy(data + ((l * rows + u) * cols + v) * size,
+		       matrixData + ((l * matrixRows + u) * matrixCols + v) * size, size * sizeof(double));
+    free(matrixData);
+    matrixData = data;
+    matrixRows = rows;
+    matrixCols = cols;
+    matrixViews.resize(2 * rows * cols);
+    allPs.assign(rows, cols, NULL);
+    allLogPs.assign(rows, cols, NULL);
+    for (int i=0; i < matrixViews.size(); i++)
+	matrixViews[i] = gsl_matrix_view_array(matrixData + i * size, states, states).matrix;
+    for (int u=0; u < rows; u++)
+	for (int v=0; v < cols; v++){
+	    allPs[u][v] = &matrixViews[u * cols + v];
+	    allLogPs[u][v] = &matrixViews[(rows + u) * cols + v];
+	}
+}
+
+void Evo::setMatrices(int u, int v, gsl_matrix *P, gsl_matrix *logP){
+    if (P)
+	gsl_matrix_memcpy(allPs[u][v], P);
+    if (logP)
+	gsl_matrix_memcpy(allLogPs[u][v], logP);
+}
+
+/*
+ * The file name contains a hash of the parameters, the file itself all parameters,
+ * so that a hash collision or a file of an older version is not taken for a match.
+ */
+string Evo::getMatrixCacheFile(string dir, string name, const vector<double> &params){
+    uint64_t hash = 14695981039346656037ULL; // FNV-1a
+    const unsigned char *bytes = (const unsigned char*) &params[0];
+    for (size_t i=0; i < params.size() * sizeof(double); i++){
+	hash ^= bytes[i];
+	hash *= 1099511628211ULL;
+    }
+    ostringstream file;
+    if (!dir.empty() && dir[dir.size()-1] != '/')
+	dir += "/";
+    file << dir << name << "_" << states << "_" << matrixRows << "x" << matrixCols << "_"
+	 << hex << setw(16) << setfill('0') << hash << ".bin";
+    return file.str();
+}
+
+bool Evo::readMatrixCache(string dir, string name, const vector<double> &params){
+    ifstream in(getMatrixCacheFile(dir, name, params).c_str(), ios::binary);
+    if (!in)
+	return false;
+    int fileStates, rows, cols;
+    size_t numParams;
+    in.read((char*) &fileStates, sizeof(fileStates));
+    in.read((char*) &rows, sizeof(rows));
+    in.read((char*) &cols, sizeof(cols));
+    in.read((char*) &numParams, sizeof(numParams));
+    if (!in || fileStates != states || rows != matrixRows || cols != matrixCols || numParams != params.size())
+	return false;
+    vector<double> fileParams(numParams);
+    in.read((char*) &fileParams[0], numParams * sizeof(double));
+    if (!in || fileParams != params)
+	return false;
+    in.read((char*) matrixData, matrixViews.size() * states * states * sizeof(double));
+    return (bool) in;
+}
+
+void Evo::writeMatrixCache(string dir, string name, const vector<double> &params){
+    string filename = getMatrixCacheFile(dir, name, params);
+    // write to a temporary file first, other processes may read the file at the same time
+    ostringstream tmpname;
+    tmpname << filename << ".tmp" << getpid();
+    ofstream out(tmpname.str().c_str(), ios::binary);
+    size_t numParams = params.size();
+    out.write((const char*) &states, sizeof(states));
+    out.write((const char*) &matrixRows, sizeof(matrixRows));
+    out.write((const char*) &matrixCols, sizeof(matrixCols));
+    out.write((const char*) &numParams, sizeof(numParams));
+    out.write((const char*) &params[0], numParams * sizeof(double));
+    out.write((const char*) matrixData, matrixViews.size() * states * states * sizeof(double));
+    out.close();
+    if (!out || rename(tmpname.str().c_str(), filename.c_str()) != 0){
+	cerr << "Warning: could not write substitution matrices to " << filename << endl;
+	remove(tmpname.str().c_str());
+    }
+}
+
 /* Determine the branch lengths for which matrices P should be stored, at most m.
  * For trees with few species, say <10, this could be all branch lengths b occuring
  * in the tree. A value of m=-1 means to store all lengths in b. For large trees, memory 
@@ -168,15 +265,29 @@ void CodonEvo::printOmegas(){
 /* 
  * Precompute and store the array of matrices.
  * Takes approximate k * m * 0.015 seconds on greif1: Time for eigendecompose is small compared to time for expQt.
+ * With the option /CompPred/matrixCacheDir the matrices are read from a file in this directory
+ * if they were computed before for the same kappa, codon usage, omegas and times.
  */
 void CodonEvo::computeLogPmatrices(){
     double omega;
     double t;
-    gsl_matrix *Q, *U, *Uinv, *P;
+    gsl_matrix *Q, *U, *Uinv, *P, *logP;
     gsl_vector *lambda;
     int status;
-    allPs.assign(k, m, NULL); // omegas index the rows, times index the columns
-    allLogPs.assign(k, m, NULL);
+    allocMatrices(k, m); // omegas index the rows, times index the columns
+
+    string cacheDir;
+    try {
+	cacheDir = expandHome(Properties::getProperty("/CompPred/matrixCacheDir"));
+    } catch (...) {}
+    vector<double> params;
+    params.push_back(kappa);
+    params.insert(params.end(), pi, pi + states);
+    params.insert(params.end(), omegas.begin(), omegas.end());
+    params.insert(params.end(), times.begin(), times.end());
+    if (!cacheDir.empty() && readMatrixCache(cacheDir, "codonevo", params))
+	return;
+
     for (int u=0; u<k; u++){
 	omega = omegas[u];
 	// compute decomposition of Q, which does not require t yet
@@ -190,9 +301,11 @@ void CodonEvo::computeLogPmatrices(){
 	for (int v=0; v<m; v++){
 	    t = times[v]; // time
 	    P = expQt(t, lambda, U, Uinv);
+	    logP = log(P,states);
 	    // store P
-	    allPs[u][v] = P;
-	    allLogPs[u][v] = log(P,states);
+	    setMatrices(u, v, P, logP);
+	    gsl_matrix_free(P);
+	    gsl_matrix_free(logP);
 	    //#ifdef DEBUG
 	    // cout << "codon rate matrix log P(t=" << t << ", omega=" << omega << ")" << endl;
 	    // printCodonMatrix(allLogPs[u][v]);
@@ -203,6 +316,8 @@ void CodonEvo::computeLogPmatrices(){
 	gsl_matrix_free(Q);
 	gsl_vector_free(lambda);
     }
+    if (!cacheDir.empty())
+	writeMatrixCache(cacheDir, "codonevo", params);
 }
 
 /*
@@ -520,13 +635,14 @@ void ExonEvo::setPhyloFactor(){
 }
 void ExonEvo::computeLogPmatrices(){
 
-    allPs.assign(1, m, NULL);
-    allLogPs.assign(1, m, NULL);
+    allocMatrices(1, m);
     for (int v=0; v<m; v++){
 	double t = times[v]; // time
 	gsl_matrix *P = computeP(t);
-        allPs[0][v]=P;
-	allLogPs[0][v]=log(P,states); 
+	gsl_matrix *LogP = log(P,states);
+	setMatrices(0, v, P, LogP);
+	gsl_matrix_free(P);
+	gsl_matrix_free(LogP);
     }
 }
 
@@ -550,20 +666,12 @@ void ExonEvo::addBranchLength(double b){
     }
     if(!isIncluded){ // add branch length
 	times.push_back(b);
+	allocMatrices(1, times.size());
 	gsl_matrix *P=computeP(b);
-	vector<gsl_matrix*> row = allPs.getRow(0);
-	row.push_back(P);
-	allPs.assign(1, row.size(), NULL);
-	for (int v=0; v<row.size(); v++){
-	    allPs[0][v]=row[v];	
-	}
 	gsl_matrix *LogP=log(P,states);
-	row = allLogPs.getRow(0);
-	row.push_back(LogP);
-	allLogPs.assign(1, row.size(), NULL);
-	for (int v=0; v<row.size(); v++){
-	    allLogPs[0][v]=row[v];	
-	}
+	setMatrices(0, times.size()-1, P, LogP);
+	gsl_matrix_free(P);
+	gsl_matrix_free(LogP);
     }
 }
 
@@ -576,45 +684,58 @@ gsl_matrix *ExonEvo::computeP(double t){
     return P;
 }
 
+void CodonEvo::getCodonTuples(vector<string> &seqtuple, PhyloTree *tree, vector<vector<int> > &tuples){
+    if (seqtuple.size() != tree->numSpecies())
+	throw ProjectError("CodonEvo::estOmegaOnSeqTuple: inconsistent number of species.");
+    for(int i=1; i<seqtuple.size();i++){
+	if(seqtuple[0].length() != seqtuple[i].length()){
+	    throw ProjectError("CodonEvo::estOmegaOnSeqTuple: wrong exon lengths");
+	}
+    }
+
+    int n = seqtuple[0].length()/3; // number of nucleotide triples
+    Seq2Int s2i(3);
+    tuples.clear();
+    for (int i=0; i<n; i++){
+	vector<int> codontuple(tree->numSpecies(), 64); // 64 = missing codon
+	int numCodons = 0;
+	for(size_t s=0; s < tree->numSpecies(); s++){
+	    if (seqtuple[s].size()>0)
+		try {
+		    codontuple[s] = s2i(seqtuple[s].c_str() + 3*i);
+		    numCodons++;
+		} catch(...){} // gap or n character
+	}
+	if (numCodons >= 2)
+	    tuples.push_back(codontuple);
+    }
+}
+
+double CodonEvo::logLikOnCodonTuples(const vector<vector<int> > &tuples, PhyloTree *tree, int u){
+    vector<double> logliks;
+    tree->pruningAlgor(tuples, this, logliks, u);
+    double loglik = 0.0;
+    for (int i=0; i<logliks.size(); i++)
+	loglik += logliks[i];
+    return loglik;
+}
+
 /* 
  * Estimate omega on a sequence of codon tuples.
  * only for testing, may need adjustments
  * TODO:
- * - change data structure for codon tuples to vectors of integers, more efficient
  * - save log-likelihood of codon tuples in a cache, so that calculation has to be done only once.
  * - scale branch lengths
  */
 double CodonEvo::estOmegaOnSeqTuple(vector<string> &seqtuple, PhyloTree *tree,
 				    int &subst){ //output variables
-    if (seqtuple.size() != tree->numSpecies())
-	throw ProjectError("CodonEvo::estOmegaOnSeqTuple: inconsistent number of species.");
-    for(int i=1; i<seqtuple.size();i++){
-	if(seqtuple[0].length() != seqtuple[i].length()){
-	    throw ProjectError("CodonEvo::estOmegaOnSeqTuple: wrong exon lengths");
-	}
-    }
+    vector<vector<int> > tuples;
+    getCodonTuples(seqtuple, tree, tuples);
 
-    int n = seqtuple[0].length()/3; // number of nucleotide triples
     int maxU = 0; // index to omegas
     double ML = -numeric_limits<double>::max();
-    Evo* evo = this;
     for (int u=0; u < k; u++){ // loop over omegas
-	Seq2Int s2i(3);
-	double loglik = 0.0;
-	for (int i=0; i<n; i++){
-	    vector<int> codontuple(tree->numSpecies(), 64); // 64 = missing codon
-	    int numCodons = 0;
-	    for(size_t s=0; s < tree->numSpecies(); s++){
-		if (seqtuple[s].size()>0)
-		    try {
-			codontuple[s] = s2i(seqtuple[s].c_str() + 3*i);
-			numCodons++;
-		    } catch(...){} // gap or n character
-	    }
-	    if (numCodons >= 2){
-		loglik += tree->pruningAlgor(codontuple, evo, u);
-	    }
-	}
+	double loglik = logLikOnCodonTuples(tuples, tree, u);
 	//	cout << "loglikelihood(omega=" << omegas[u] << ")= " << setPrecision(4) << loglik << endl;
 	if (loglik > ML){
 	    ML = loglik;
@@ -623,65 +744,32 @@ double CodonEvo::estOmegaOnSeqTuple(vector<string> &seqtuple, PhyloTree *tree,
     }
     // count number of substitutions
     subst = 0;
-    Seq2Int s2i(3);
 
     // settings to reduce MAP algorithm to Fitch Algorithm
-    vector<double> weights(tree->numSpecies(),0);
+    vector<vector<double> > weights(tuples.size(), vector<double>(tree->numSpecies(),0));
     Parsimony parsi;
     parsi.computeLogPmatrices();
     Evo *parsi_base = &parsi;
     
-    for (int i=0; i<n; i++){
-	vector<int> codontuple(tree->numSpecies(),64);
-	int numCodons=0;
-	for(size_t s=0; s < tree->numSpecies(); s++){
-	    if (seqtuple[s].size() > 0)
-		try {
-		    codontuple[s] = s2i(seqtuple[s].c_str() + 3*i);
-		    numCodons++;
-		} catch(...){} // gap or n character
-	}
-	if(numCodons >= 2){
-	    PhyloTree temp(*tree); // only use a copy of the tree !!!
-	    subst += -temp.MAP(codontuple, weights, parsi_base, 1, true); // Fitch Algorithm 
-	}
-    }
+    vector<double> scores;
+    tree->MAP(tuples, weights, parsi_base, scores, 1, true); // Fitch Algorithm 
+    for (int i=0; i<scores.size(); i++)
+	subst += -scores[i];
     return omegas[maxU];
 }
 
 double CodonEvo::graphOmegaOnCodonAli(vector<string> &seqtuple, PhyloTree *tree){
-    if (seqtuple.size() != tree->numSpecies())
-	throw ProjectError("CodonEvo::estOmegaOnSeqTuple: inconsistent number of species.");
-    for(int i=1; i<seqtuple.size();i++){
-	if(seqtuple[0].length() != seqtuple[i].length()){
-	    throw ProjectError("CodonEvo::estOmegaOnSeqTuple: wrong exon lengths");
-	}
-    }
-
-    int n = seqtuple[0].length()/3; // number of nucleotide triples
-    int numCodons;
-    double Eomega, loglik, sum;
-    Seq2Int s2i(3);
+    vector<vector<int> > tuples;
+    getCodonTuples(seqtuple, tree, tuples);
     vector<double> logliks(k, 0.0);
+    for (int u=0; u < k; u++) // loop over omegas
+	logliks[u] = logLikOnCodonTuples(tuples, tree, u);
+    return posteriorMeanOmega(logliks);
+}
+
+double CodonEvo::posteriorMeanOmega(const vector<double> &logliks){
+    double Eomega, sum;
     vector<double> postprobs(k, 0.0);
-    for (int i=0; i<n; i++){
-	Eomega = sum = 0.0;
-	for (int u=0; u < k; u++){ // loop over omegas
-	    vector<int> codontuple(tree->numSpecies(), 64); // 64 = missing codon
-	    numCodons = 0;
-	    for(size_t s=0; s < tree->numSpecies(); s++){
-		if (seqtuple[s].size()>0)
-		    try {
-			codontuple[s] = s2i(seqtuple[s].c_str() + 3*i);
-			numCodons++;
-		    } catch(...){} // gap or n character
-	    }
-	    if (numCodons >= 2){
-		loglik = tree->pruningAlgor(codontuple, this, u);
-		logliks[u] += loglik;
-	    }
-	}
-    }
     // posterior mean estimate of omega
     double meanloglik(0.0);
     for (int u=0; u < k; u++)
@@ -700,37 +788,54 @@ double CodonEvo::graphOmegaOnCodonAli(vector<string> &seqtuple, PhyloTree *tree)
 	Eomega += postprobs[u] * omegas[u];
     }
     //    cout << "Eomega=" << Eomega << endl;
-    // count number of substitutions
-    //int subst;
- 
-    // settings to reduce MAP algorithm to Fitch Algorithm
-    //    vector<double> weights(tree->numSpecies(),0);
-    //Parsimony parsi;
-    //parsi.computeLogPmatrices();
-    //Evo *parsi_base = &parsi;
-    /*    cout << "graph substitutions" << endl;
-    for (int i=0; i<n; i++){
-	vector<int> codontuple(tree->numSpecies(), 64);
-	numCodons=0;
-	for(size_t s=0; s < tree->numSpecies(); s++){
-	    if (seqtuple[s].size() > 0)
-		try {
-		    codontuple[s] = s2i(seqtuple[s].c_str() + 3*i);
-		    numCodons++;
-		} catch(...){} // gap or n character
-	}
-	if(numCodons >= 2){
-	    PhyloTree temp(*tree); // only use a copy of the tree !!!
-	    subst = -temp.MAP(codontuple, weights, parsi_base, 1, true); // Fitch Algorithm 
-	    //cout << i << "\t" << subst << endl; 
-	}
-	}*/
     return Eomega;
 }
 
+/*
+ * OmegaWorker
+ * computes the log likelihoods of the pairs (alignment, omega) with the indices
+ * first, first + step, first + 2*step, ... One worker runs in each thread.
+ */
+class OmegaWorker {
+public:
+    OmegaWorker(CodonEvo *ce, PhyloTree *t, const vector<vector<vector<int> > > *ct,
+		vector<vector<double> > *ll, int f, int st) :
+	codonevo(ce), tree(t), codontuples(ct), logliks(ll), first(f), step(st) {}
+    void operator()() {
+	int k = codonevo->getK();
+	for (int i = first; i < codontuples->size() * k; i += step)
+	    (*logliks)[i / k][i % k] = codonevo->logLikOnCodonTuples((*codontuples)[i / k], tree, i % k);
+    }
+private:
+    CodonEvo *codonevo;
+    PhyloTree *tree;
+    const vector<vector<vector<int> > > *codontuples;
+    vector<vector<double> > *logliks;
+    int first, step;
+};
+
+void CodonEvo::graphOmegaOnCodonAlis(vector<vector<string> > &seqtuples, PhyloTree *tree,
+				     vector<double> &Eomegas, int numThreads){
+    vector<vector<vector<int> > > codontuples(seqtuples.size());
+    for (int a=0; a < seqtuples.size(); a++)
+	getCodonTuples(seqtuples[a], tree, codontuples[a]);
+    vector<vector<double> > logliks(seqtuples.size(), vector<double>(k, 0.0));
+    if (numThreads > seqtuples.size() * k)
+	numThreads = seqtuples.size() * k;
+    if (numThreads < 1)
+	numThreads = 1;
+    vector<OmegaWorker> workers;
+    for (int w=0; w < numThreads; w++)
+	workers.push_back(OmegaWorker(this, tree, &codontuples, &logliks, w, numThreads));
+    runInThreads(workers);
+    Eomegas.resize(seqtuples.size());
+    for (int a=0; a < seqtuples.size(); a++)
+	Eomegas[a] = posteriorMeanOmega(logliks[a]);
+}
+
 void Parsimony::computeLogPmatrices(){
 
-    allLogPs.assign(1, m, NULL);
+    allocMatrices(1, m);
     gsl_matrix* P = gsl_matrix_calloc(states, states);
     for (int i=0; i<states; i++){
 	for (int j=0; j<states; j++){
@@ -742,5 +847,6 @@ void Parsimony::computeLogPmatrices(){
 	    }
 	}
     }
-    allLogPs[0][0]=P;
+    setMatrices(0, 0, NULL, P);
+    gsl_matrix_free(P);
 }
@@ -15,6 +15,8 @@
 #include "genbank.hh"
 #include "statemodel.hh"
 #include "merkmal.hh"
+#include "evaluation.hh"
+#include "parallel.hh"
 
 
 typedef ProjectError EHMMTrainingError;
@@ -30,7 +32,8 @@ public:
     ~EHMMTraining( );
     void HMMbuildParameters(int gcIdx, AnnoSequence* AnnoSeqList, 
 			 FeatureCollection &extrinsicFeatures, BaseCount *bc = NULL);
-    void CRFbuildParameters(AnnoSequence* AnnoSeqList, FeatureCollection &extrinsicFeatures);
+    void CRFbuildParameters(AnnoSequence* AnnoSeqList, FeatureCollection &extrinsicFeatures, bool saveIntermediate = true);
+    void crossValidate(int k, AnnoSequence* AnnoSeqList, FeatureCollection &extrinsicFeatures);
     void deleteModelParameterFiles(const char* suffix = NULL);
     void printParameters(const char* suffix = NULL);
     void saveConfig(const char* file = 0);
@@ -101,6 +104,13 @@ int main( int argc, char* argv[] ){
 	}
 	//AnnoSequence::deleteSequence(trainannoseq); // for some reason this causes a "double free or corruption" error
 
+	// k-fold cross-validation: only evaluate, no parameter files are written
+	if (Properties::hasProperty("cv")) {
+	    FeatureCollection extrinsicFeatures;
+	    train.crossValidate(Properties::getIntProperty("cv"), trainannoseq, extrinsicFeatures);
+	    return 0;
+	}
+
  	train.deleteModelParameterFiles();
 	
 	// TODO: read in the hints for training
@@ -212,7 +222,7 @@ void EHMMTraining::HMMbuildParameters(int gcIdx, AnnoSequence* AnnoSeqList,
  * CRFbuildParameters
  * Starting from the HMM parameters use CRF training to iteratively (re)estimate some parameters.
  */
-void EHMMTraining::CRFbuildParameters(AnnoSequence* AnnoSeqList, FeatureCollection &extrinsicFeatures) {
+void EHMMTraining::CRFbuildParameters(AnnoSequence* AnnoSeqList, FeatureCollection &extrinsicFeatures, bool saveIntermediate) {
   Parameters* parameters = new Parameters(); // holds the parameters that are trained by the CRF
 
   // make vector from linked list of training genes
@@ -244,7 +254,8 @@ void EHMMTraining::CRFbuildParameters(AnnoSequence* AnnoSeqList, FeatureCollecti
   vector<double> startWeights = parameters->getWeights();
   cout << "Parameters before CRF training" << endl;
   parameters->print(-1, false);
-  CRF::setPrintPars(statecount, states);
+  if (saveIntermediate)
+    CRF::setPrintPars(statecount, states);
   CRF::train(parameters, AnnoSeqVec, extrinsicFeatures);
   cout << "Parameters after CRF training" << endl;
   parameters->print(-1, false);
@@ -253,6 +264,117 @@ void EHMMTraining::CRFbuildParameters(AnnoSequence* AnnoSeqList, FeatureCollecti
 }
 
 
+/*
+ * CVFold
+ * one fold of the cross-validation: train on the genes of all other folds
+ * and predict and evaluate on the sequences of this fold
+ */
+class CVFold {
+public:
+    CVFold(EHMMTraining *tr, vector<AnnoSequence*> *singleseqs, vector<AnnoSequence*> *seqs, int f, int numFolds,
+	   FeatureCollection *ef) :
+	train(tr), singleGeneSeqs(singleseqs), annoseqs(seqs), fold(f), k(numFolds), extrinsicFeatures(ef), eval(NULL) {}
+    void operator()();
+    void write(ostream &out) { eval->write(out); }
+    void read(istream &in) {
+	eval = new Evaluation();
+	eval->read(in);
+    }
+private:
+    EHMMTraining *train;
+    vector<AnnoSequence*> *singleGeneSeqs; // single gene sequences of each annotated sequence
+    vector<AnnoSequence*> *annoseqs;
+    int fold, k;
+    FeatureCollection *extrinsicFeatures;
+public:
+    Evaluation *eval;                      // the caller deletes it
+};
+
+void CVFold::operator()(){
+    // chain the single gene sequences of the training folds to one list
+    AnnoSequence *trainseqs = NULL, *tail = NULL;
+    vector<AnnoSequence*> linked; // the ends of the lists that were linked to the next list
+    vector<AnnoSequence*> testseqs;
+    for (int i=0; i < annoseqs->size(); i++) {
+	if (i % k == fold) {
+	    testseqs.push_back((*annoseqs)[i]);
+	    continue;
+	}
+	AnnoSequence *head = (*singleGeneSeqs)[i];
+	if (!head)
+	    continue;
+	if (tail) {
+	    tail->next = head;
+	    linked.push_back(tail);
+	} else
+	    trainseqs = head;
+	for (tail = head; tail->next; tail = tail->next);
+    }
+    cout << "# cross-validation fold " << fold+1 << " of " << k << ": " << testseqs.size() << " test sequences" << endl;
+    if (!trainseqs)
+	throw ProjectError("cv: no training genes outside fold " + itoa(fold+1) + ".");
+
+    ContentDecomposition cd;
+    BaseCount bc;
+    for (int idx=0; idx < cd.n; idx++) {
+	bc = cd.getBaseCount(idx);
+	train->HMMbuildParameters(idx, trainseqs, *extrinsicFeatures, &bc);
+    }
+    if (Constant::useCRFtraining)
+	train->CRFbuildParameters(trainseqs, *extrinsicFeatures, false);
+    StateModel::makeEmiTables();
+    eval = predictAndEvaluate(testseqs, *extrinsicFeatures);
+
+    // separate the lists again, the next fold chains them differently
+    for (int i=0; i < linked.size(); i++)
+	linked[i]->next = NULL;
+}
+
+/*
+ * crossValidate
+ * k-fold cross-validation of the meta parameters in memory: the annotated sequences are
+ * divided into k folds, each fold is predicted with the parameters trained on the other folds.
+ * Each fold is trained in a worker process of its own, starting from the untrained models,
+ * and the folds are processed in parallel (option threads). Prints the accuracy on all folds together.
+ */
+void EHMMTraining::crossValidate(int k, AnnoSequence* AnnoSeqList, FeatureCollection &extrinsicFeatures){
+    vector<AnnoSequence*> annoseqs, singleGeneSeqs;
+    for (AnnoSequence *as = AnnoSeqList; as; as = as->next)
+	annoseqs.push_back(as);
+    if (k < 2 || k > annoseqs.size())
+	throw ProjectError("cv: the number of folds must be between 2 and the number of sequences (" + itoa(annoseqs.size()) + ").");
+    // split each sequence separately, so the training set of a fold can be chained from the pieces
+    for (int i=0; i < annoseqs.size(); i++) {
+	AnnoSequence *next = annoseqs[i]->next;
+	annoseqs[i]->next = NULL;
+	singleGeneSeqs.push_back(split2SingleGeneSeqs(annoseqs[i]));
+	annoseqs[i]->next = next;
+    }
+
+    vector<CVFold> folds;
+    for (int f=0; f < k; f++)
+	folds.push_back(CVFold(this, &singleGeneSeqs, &annoseqs, f, k, &extrinsicFeatures));
+    runInProcesses(folds, getNumThreads(), true); // the training of a fold changes the models
+
+    Evaluation total;
+    for (int f=0; f < k; f++) {
+	cout << "# accuracy of fold " << f+1 << ": nucleotide sens/spec " << folds[f].eval->nukSens << "/" << folds[f].eval->nukSpec
+	     << ", exon sens/spec " << folds[f].eval->exonSens << "/" << folds[f].eval->exonSpec
+	     << ", gene sens/spec " << folds[f].eval->geneSens << "/" << folds[f].eval->geneSpec << endl;
+	total.add(*folds[f].eval);
+	delete folds[f].eval;
+    }
+    total.finishEvaluation();
+    cout << "# " << k << "-fold cross-validation on " << annoseqs.size() << " sequences" << endl;
+    total.print();
+    double target = (3*total.nukSens + 2*total.nukSpec + 4*total.exonSens + 3*total.exonSpec
+		     + 2*total.geneSens + 1*total.geneSpec)/15;
+    cout << "cross-validation target = " << target << endl;
+
+    for (int i=0; i < singleGeneSeqs.size(); i++)
+	AnnoSequence::deleteSequence(singleGeneSeqs[i]);
+}
+
 void EHMMTraining::deleteModelParameterFiles(const char* suffix){
   BaseCount bc;
   for (int i = 0; i < statecount; i++)
@@ -145,9 +145,16 @@ void Evaluation::addToEvaluation(Gene* predictedGeneList, Gene* annotatedGeneLis
     evaluateOnGeneLevel(predictedGeneList, annotatedGeneList);
     evaluateOnUTRLevel(predictedGeneList, annotatedGeneList);
 
-    /*
-     * update the derived values
-     */ 
+    delete predictedExons;
+    delete annotatedExons;
+    numDataSets++;
+    updateDerivedValues();
+}
+
+/*
+ * update the derived values: sensitivities and specificities
+ */
+void Evaluation::updateDerivedValues(){
     // nucleotide level
     nukSens = (double) nukTP/(nukTP + nukFN);
     nukSpec = (double) nukTP/(nukTP + nukFP);
@@ -168,10 +175,58 @@ void Evaluation::addToEvaluation(Gene* predictedGeneList, Gene* annotatedGeneLis
     UTRexonSpec = (double) UTRexonTP/(UTRexonTP+UTRexonFP);
     nucUSens = (double) nucUTP/(nucUTP + nucUFN);
     nucUSpec = (double) nucUTP/(nucUTP + nucUFP);
+}
 
-    delete predictedExons;
-    delete annotatedExons;
-    numDataSets++;
+/*
+ * all integer counts that the evaluation adds up over the data sets
+ */
+void Evaluation::getCounters(vector<int*> &counters){
+    int* c[] = {&nukTP, &nukFP, &nukFN, &nukFPinside, &nucUTP, &nucUFP, &nucUFN, &nucUFPinside,
+		&numPredExons, &numAnnoExons, &numUniquePredExons, &numUniqueAnnoExons,
+		&exonTP, &exonFP_partial, &exonFP_overlapping, &exonFP_wrong,
+		&exonFN_partial, &exonFN_overlapping, &exonFN_wrong,
+		&geneTP, &geneFN, &numPredGenes, &numAnnoGenes,
+		&numTSS, &numTotalPredTSS, &numTTS, &numTotalPredTTS,
+		&numPredUTRExons, &numAnnoUTRExons, &numUniquePredUTRExons, &numUniqueAnnoUTRExons,
+		&UTRexonTP, &UTRexonFP, &UTRexonFN, &numDataSets};
+    counters.assign(c, c + sizeof(c)/sizeof(int*));
+    for (int i=0; i <= MAXUTRDIST; i++)
+	counters.push_back(tssDist + i);
+    for (int i=0; i <= MAXUTRDIST; i++)
+	counters.push_back(ttsDist + i);
+}
+
+/*
+ * Evaluation::add
+ * After this, the evaluation is the same as if it had been done on the data sets of both evaluations.
+ */
+void Evaluation::add(Evaluation &other){
+    vector<int*> mine, others;
+    getCounters(mine);
+    other.getCounters(others);
+    for (int i=0; i < mine.size(); i++)
+	*mine[i] += *others[i];
+    if (other.longestPredIntronLen > longestPredIntronLen)
+	longestPredIntronLen = other.longestPredIntronLen;
+    quotients.insert(quotients.end(), other.quotients.begin(), other.quotients.end());
+    updateDerivedValues();
+}
+
+void Evaluation::write(ostream &out){
+    vector<int*> counters;
+    getCounters(counters);
+    for (int i=0; i < counters.size(); i++)
+	out.write((const char*) counters[i], sizeof(int));
+}
+
+void Evaluation::read(istream &in){
+    vector<int*> counters;
+    getCounters(counters);
+    for (int i=0; i < counters.size(); i++)
+	in.read((char*) counters[i], sizeof(int));
+    if (!in)
+	throw ProjectError("Evaluation::read: counts incomplete.");
+    updateDerivedValues();
 }
 
 void Evaluation::evaluateQuickOnNucleotideLevel(State* const predictedExon, int curPredBegin, 
@@ -18,6 +18,8 @@
 #include "geneticcode.hh"
 #include "types.hh"
 #include "motif.hh"
+#include <algorithm>
+#include <functional>
 #include <fstream>
 #include <iostream>
 #include <string>
@@ -436,3 +438,46 @@ list<ExonCandidate*> *findExonCands(const char *dna, int minLen, double assmotif
     candidates->sort(compBegin);
     return candidates;
 }
+
+/*
+ * ExonCandIndex constructor
+ * cands may be in any order, they are not changed
+ */
+ExonCandIndex::ExonCandIndex(list<ExonCandidate*> *cands, int len) : n(len) {
+    for (int s=0; s<2; s++){
+	offsets[s].assign(n+1, 0);
+	begins[s].clear();
+    }
+    // count the candidates per right end, then fill in the begins
+    for (list<ExonCandidate*>::iterator it = cands->begin(); it != cands->end(); ++it)
+	if ((*it)->end >= 0 && (*it)->end < n)
+	    offsets[isPlusExon((*it)->type)? 0 : 1][(*it)->end + 1]++;
+    for (int s=0; s<2; s++){
+	for (int e=0; e<n; e++)
+	    offsets[s][e+1] += offsets[s][e];
+	begins[s].resize(offsets[s][n] + 1); // +1: keep &begins[s][0] valid
+    }
+    vector<int> fill[2];
+    fill[0] = offsets[0];
+    fill[1] = offsets[1];
+    for (list<ExonCandidate*>::iterator it = cands->begin(); it != cands->end(); ++it)
+	if ((*it)->end >= 0 && (*it)->end < n) {
+	    int s = isPlusExon((*it)->type)? 0 : 1;
+	    begins[s][fill[s][(*it)->end]++] = (*it)->begin;
+	}
+    // sort descending and remove duplicates, compacting the arrays
+    for (int s=0; s<2; s++){
+	int k = 0, from = 0;
+	for (int e=0; e<n; e++){
+	    int to = offsets[s][e+1];
+	    sort(begins[s].begin() + from, begins[s].begin() + to, greater<int>());
+	    offsets[s][e] = k;
+	    for (int i=from; i<to; i++)
+		if (i == from || begins[s][i] != begins[s][i-1])
+		    begins[s][k++] = begins[s][i];
+	    from = to;
+	}
+	offsets[s][n] = k;
+	begins[s].resize(k+1);
+    }
+}
@@ -30,6 +30,7 @@
 #include "properties.hh"
 #include "projectio.hh"
 #include "extrinsicinfo.hh"
+#include "exoncand.hh"
 
 // standard C/C++ includes
 #include <fstream>
@@ -53,6 +54,12 @@ vector<Double> ExonModel::initemiprobs[3];
 vector<Double> **ExonModel::GCinitemiprobs = NULL;
 vector<Double> ExonModel::etemiprobs[3];
 vector<Double> **ExonModel::GCetemiprobs = NULL;
+FloatEmiTable   ExonModel::emiTable;
+FloatEmiTable   ExonModel::initEmiTable;
+FloatEmiTable   ExonModel::etEmiTable;
+const float*    ExonModel::curEmiTable = NULL;
+const float*    ExonModel::curInitEmiTable = NULL;
+const float*    ExonModel::curEtEmiTable = NULL;
 vector<Integer> ExonModel::numExonsOfType;
 vector<Integer> ExonModel::numHugeExonsOfType;  // number of exons exceeding the maximal length 
                                                     // modelled by the length distribution
@@ -68,6 +75,7 @@ Motif*   ExonModel::transInitMotif = NULL;      // weight matrix before the tran
 Motif*   ExonModel::GCtransInitMotif = NULL;    // weight matrix before the translation initiation
 BinnedMMGroup  ExonModel::transInitBinProbs("tis", 1); // CRF-features based on transInitMotif, monotonic increasing
 BinnedMMGroup* ExonModel::GCtransInitBinProbs = NULL;  // for all GC content classes
+const BinnedMMGroup* ExonModel::curTransInitBinProbs = NULL;
 Motif**  ExonModel::etMotif = NULL;             // weight matrices before the donor splice site (3 frames)
 Motif*** ExonModel::GCetMotif = NULL;           // array of above
 Integer  ExonModel::numSingle=0, ExonModel::numInitial=0, ExonModel::numInternal=0, 
@@ -76,6 +84,7 @@ Integer  ExonModel::numHugeSingle=0, ExonModel::numHugeInitial=0,
          ExonModel::numHugeInternal=0, ExonModel::numHugeTerminal=0; 
 Matrix<vector<Double> > ExonModel::Pls;
 Matrix<vector<Double> >* ExonModel::GCPls = NULL;
+const Matrix<vector<Double> >* ExonModel::curPls = NULL;
 Integer ExonModel::exoncount = 0;
 Boolean ExonModel::hasLenDist = false;
 //Boolean ExonModel::hasAAdep = false;      // not in use right now
@@ -99,10 +108,13 @@ Double*         ExonModel::modelStartProbs = NULL;
 //AADependency    ExonModel::aadep = 0;
 int             ExonModel::ilend = 550;
 OpenReadingFrame* ExonModel::orf = NULL;
+ExonCandIndex*  ExonModel::exonCands = NULL;
+MotifTrack*     ExonModel::transInitTrack = NULL;
+MotifTrack**    ExonModel::GCtransInitTracks = NULL;
 int             ExonModel::ochrecount = 0; // frequencies of the stop codons
 int             ExonModel::ambercount = 0;
 int             ExonModel::opalcount  = 0;
-bool            ExonModel::initAlgorithmsCalled = false;
+bool            ExonModel::haveGCPars = false;
 bool            ExonModel::haveORF = false;
 int             ExonModel::lastParIndex = -1; // GC-index of current parameter set
 int             ExonModel::verbosity;
@@ -302,6 +314,17 @@ ExonModel::~ExonModel( ){
 	lastParIndex = -1;
 }
 
+/*
+ * setExonCands
+ * restrict the exons considered in the algorithms to the given candidates
+ * of the current sequence, NULL means no restriction. Takes ownership.
+ */
+void ExonModel::setExonCands(ExonCandIndex *cands){
+    if (exonCands != cands)
+	delete exonCands;
+    exonCands = cands;
+}
+
 /*
  * ===[ ExonModel initialisation of class variables ]======================
  */
@@ -398,6 +421,11 @@ void ExonModel::init() {
 	GCtransInitBinProbs[idx].monotonic = 1; // increasing
       }
     }
+    if (!GCtransInitTracks){
+      GCtransInitTracks = new MotifTrack*[Constant::decomp_num_steps];
+      for (int idx = 0; idx < Constant::decomp_num_steps; idx++)
+	GCtransInitTracks[idx] = NULL;
+    }
     if (!GCetMotif){
       GCetMotif = new Motif**[Constant::decomp_num_steps];
       for (int idx = 0; idx < Constant::decomp_num_steps; idx++){
@@ -881,26 +909,118 @@ void ExonModel::fillTailsOfLengthDistributions( ){
 }
 
 
+/*
+ * ===[ ExonModel::makeEmiTables ]========================================
+ * single precision copies of the emission probabilities of all GC content classes
+ */
+void ExonModel::makeEmiTables() {
+  if (!GCemiprobs)
+    return;
+  int n = Constant::decomp_num_steps;
+  emiTable.init(n, 3, GCemiprobs[0].probs[0].size());
+  initEmiTable.init(n, 3, GCinitemiprobs[0][0].size());
+  etEmiTable.init(n, 3, GCetemiprobs[0][0].size());
+  for (int idx = 0; idx < n; idx++) {
+    for (int f = 0; f < 3; f++) {
+      emiTable.set(idx, f, GCemiprobs[idx].probs[f]);
+      initEmiTable.set(idx, f, GCinitemiprobs[idx][f]);
+      etEmiTable.set(idx, f, GCetemiprobs[idx][f]);
+    }
+  }
+}
+
 /*
  * ===[ ExonModel::initAlgorithms ]=======================================
+ * the exon states make no corrections on the transition matrix
+ */
+void ExonModel::initAlgorithms(Matrix<Double>& trans, int cur) {}
+
+/*
+ * ===[ ExonModel::useGCPars ]============================================
+ * switch to the parameters of the GC content index gcIdx
+ * only pointers are set, the parameters are not copied
  */
-void ExonModel::initAlgorithms(Matrix<Double>& trans, int cur) {
-  if (!initAlgorithmsCalled) {
+void ExonModel::useGCPars() {
+  if (!haveGCPars) {
     // stuff that needs to be called once for all exon states
-    // set these parameters to the one of the GC content index gcIdx    
-    Pls = GCPls[gcIdx];
-    emiprobs = GCemiprobs[gcIdx];
-    initemiprobs[0] =  GCinitemiprobs[gcIdx][0];
-    initemiprobs[1] =  GCinitemiprobs[gcIdx][1];
-    initemiprobs[2] =  GCinitemiprobs[gcIdx][2];
-    etemiprobs[0] =  GCetemiprobs[gcIdx][0];
-    etemiprobs[1] =  GCetemiprobs[gcIdx][1];
-    etemiprobs[2] =  GCetemiprobs[gcIdx][2];
+    curPls = &GCPls[gcIdx];
+    curEmiTable = emiTable.get(gcIdx);
+    curInitEmiTable = initEmiTable.get(gcIdx);
+    curEtEmiTable = etEmiTable.get(gcIdx);
     transInitMotif = &GCtransInitMotif[gcIdx];
-    transInitBinProbs = GCtransInitBinProbs[gcIdx];
+    curTransInitBinProbs = &GCtransInitBinProbs[gcIdx];
     etMotif = GCetMotif[gcIdx];
+    // translation initiation probabilities of all positions, not during CRF training, which counts the features
+    if (!inCRFTraining && GCtransInitTracks && !GCtransInitTracks[gcIdx])
+      GCtransInitTracks[gcIdx] = new MotifTrack(computeTransInitProb, sequence, dnalen);
+    transInitTrack = GCtransInitTracks? GCtransInitTracks[gcIdx] : NULL;
+  }
+  haveGCPars = true;
+}
+
+/*
+ * ExonModel::clearTransInitTracks
+ * at the start of a new sequence
+ */
+void ExonModel::clearTransInitTracks() {
+  if (GCtransInitTracks)
+    for (int idx = 0; idx < Constant::decomp_num_steps; idx++) {
+      delete GCtransInitTracks[idx];
+      GCtransInitTracks[idx] = NULL;
+    }
+  transInitTrack = NULL;
+}
+
+/*
+ * ExonModel::transInitProb
+ * probability of the translation initiation with the start codon at pos on the forward strand
+ * or the reverse start codon at pos on the reverse strand, including the trans init motif.
+ * Looked up in the track of the current sequence if there is one.
+ */
+Double ExonModel::transInitProb(int pos, bool forwardStrand) {
+  if (transInitTrack && !inCRFTraining && transInitTrack->covers(sequence, dnalen, pos))
+    return transInitTrack->get(pos, forwardStrand);
+  return computeTransInitProb(pos, forwardStrand);
+}
+
+Double ExonModel::computeTransInitProb(int pos, bool forwardStrand) {
+  if (pos < 0 || !GeneticCode::isStartcodon(sequence + pos, !forwardStrand))
+    return 0.0;
+  Double p = GeneticCode::startCodonProb(sequence + pos, !forwardStrand);
+  if (p <= 0.0)
+    return p;
+  if (forwardStrand) {
+    // two cases ... . the normal one with enough sequence space before the gene
+    int transInitStart = pos - trans_init_window;
+    if (transInitStart > transInitMotif->k){
+      p *= transInitMotif->seqProb(sequence+transInitStart);
+      if (curTransInitBinProbs->nbins >= 1) {
+	int idx = GCtransInitBinProbs[gcIdx].getIndex(p);// map prob to CRF score
+	if (inCRFTraining && (countEnd < 0 || (transInitStart >= countStart && transInitStart <= countEnd)))
+	  GCtransInitBinProbs[gcIdx].addCount(idx);
+	p = curTransInitBinProbs->avprobs[idx];
+      }
+    } else {
+      /* ... and the case where there is no place for the transInitMotif
+       * take emission probs of 1/4 for the rest up to the beginning of the seq
+       * Need this if the gene starts right after the sequence.
+       */
+      p *= pow(0.25, (double) pos);
+    }
+  } else {
+    if (pos + STARTCODON_LEN + trans_init_window - 1 + tis_motif_memory < dnalen){
+      p *= transInitMotif->seqProb(sequence + pos + STARTCODON_LEN, true, true);// HMM
+      if (curTransInitBinProbs->nbins >= 1) {
+	int idx = GCtransInitBinProbs[gcIdx].getIndex(p);// map prob to CRF score
+	if (inCRFTraining && (countEnd < 0 || (pos >= countStart && pos <= countEnd)))
+	  GCtransInitBinProbs[gcIdx].addCount(idx);
+	p = curTransInitBinProbs->avprobs[idx];
+      }
+    }
+    else
+      p = pow(0.25, (double)(dnalen-(pos + STARTCODON_LEN)));
   }
-  initAlgorithmsCalled = true;
+  return p;
 }
 
 
@@ -931,10 +1051,11 @@ void ExonModel::viterbiForwardAndSampling(ViterbiMatrixType& viterbi, // matrix
 
     Double fwdsum = 0;
     Double maxProb = 0;
+    OptionsList samplingOptions;
     OptionsList *optionslist = NULL;
     PP::ExonScorer* exonScorer = 0;
     if (algovar==doSampling)
-	optionslist = new OptionsList();
+	optionslist = &samplingOptions;
     bool checkSubstates = (profileModel != 0); // && isOnFStrand(etype) && etype != singleG
 
     /*
@@ -1067,13 +1188,47 @@ void ExonModel::viterbiForwardAndSampling(ViterbiMatrixType& viterbi, // matrix
 	if (startMax > base + beginPartLen) // ensure that base>endOfPred
 	    startMax = base + beginPartLen;
     }
+    // beam pruning is done in the Viterbi variants only and not with substates
+    bool pruning = beamActive && !checkSubstates && algovar != doSampling && !needForwardTable(algovar);
+    Double beamCutoff = 0.0;
+    vector<Ancestor>::const_iterator it;
+
+    /*
+     * With exon candidates only the candidate begins (descending) are tried.
+     * Left truncated exons (beginOfStart=0) are always allowed.
+     */
+    const int *cand = NULL, *lastCand = NULL;
+    bool candsOnly = exonCands && startMin < startMax && endOfBioExon < dnalen;
+    if (candsOnly)
+	exonCands->getBegins(endOfBioExon, isOnFStrand(etype), cand, lastCand);
+
     /*
      * loop over the length of the inner sequence
      */
     seqProb(-1,0,0);      // initialize the static variables
     for (int beginOfStart = startMax; beginOfStart >= startMin; beginOfStart--) {
-	// main work done in this funcion call
+	if (candsOnly) {
+	    while (cand != lastCand && *cand + innerPartOffset > beginOfStart)
+		cand++;
+	    if (cand != lastCand)
+		beginOfStart = *cand + innerPartOffset;
+	    else if (startMin == 0)
+		beginOfStart = 0;
+	    else
+		break;
+	    if (beginOfStart < startMin)
+		break;
+	}
 	int endOfPred = beginOfStart - beginPartLen -1;
+	if (pruning && endOfPred < dnalen) {
+	    // skip the emission probability if no predecessor lies within the beam
+	    beamCutoff = colBest[endOfPred >= 0 ? endOfPred : 0] * beamFactor;
+	    const ViterbiColumnType& col = viterbi[endOfPred >= 0 ? endOfPred : 0];
+	    for (it = ancestor->begin(); it != ancestor->end() && col.get(it->pos) < beamCutoff; ++it);
+	    if (it == ancestor->end())
+		continue;
+	}
+	// main work done in this funcion call
 	Double notEndPartProb = notEndPartEmiProb(beginOfStart, right, frameOfRight, extrinsicexons);
 	if (notEndPartProb <= 0.0 || endOfPred >= dnalen) 
 	    continue;
@@ -1088,14 +1243,13 @@ void ExonModel::viterbiForwardAndSampling(ViterbiMatrixType& viterbi, // matrix
 	if (checkSubstates)
 	    exonScorer->newFirstCodon(beginOfBioExon);
 	
-	vector<Ancestor>::const_iterator it;
-	for( it = ancestor.begin(); it != ancestor.end(); ++it ){
+	for( it = ancestor->begin(); it != ancestor->end(); ++it ){
 	    int predState = it->pos;
 	    if (algovar == doSampling) {
 		if (predForw[predState] == 0)
 		    continue;
 	    } else
-		if (predVit.get(predState)==0)
+		if (predVit.get(predState)==0 || (pruning && predVit.get(predState) < beamCutoff))
 		    continue;
 	    StateType predStateType = (*stateMap)[predState];
 	    Double transEmiProb = it->val * endPartProb * notEndPartProb;
@@ -1153,7 +1307,6 @@ void ExonModel::viterbiForwardAndSampling(ViterbiMatrixType& viterbi, // matrix
 		cerr << "Sampling error in exon model. state=" << state << " base=" << base << endl;
 		throw e;
 	    }
-	    delete optionslist;
 	    break;
 	case doViterbiAndForward:
 	    if (fwdsum > 0)
@@ -1222,7 +1375,7 @@ void ExonModel::processOvlpOption(ViterbiMatrixType& viterbi, ViterbiMatrixType&
     ViterbiColumnType& predVit = viterbi[endOfPred2 >= 0 ? endOfPred2 : 0]; 
     
     //cout << "state=" << state << " endOfPred=" << endOfPred << " endOfPred2=" << endOfPred2 << " maxProb=" << maxProb << endl;
-    for (it = ancestor.begin(); it != ancestor.end(); ++it ){
+    for (it = ancestor->begin(); it != ancestor->end(); ++it ){
       int predState = it->pos;
       if (algovar == doSampling) {
 	if (predForw[predState] == 0)
@@ -1283,7 +1436,7 @@ void ExonModel::processOvlpOption(ViterbiMatrixType& viterbi, ViterbiMatrixType&
  */
 
 Double ExonModel::endPartEmiProb(int end) const {
-    static Double endPartProb = 0.0;
+    Double endPartProb = 0.0;
     Feature *feature;
     Double extrinsicEmiQuot = 1.0;
     switch( etype ){
@@ -1326,23 +1479,7 @@ Double ExonModel::endPartEmiProb(int end) const {
 	case rsingleG: case rinitial:
 	{
 	    int startpos = end - trans_init_window - STARTCODON_LEN + 1;
-	    if (startpos >= 0 && GeneticCode::isStartcodon(sequence + startpos, true)) {
-		endPartProb = GeneticCode::startCodonProb(sequence + startpos, true);
-		if (endPartProb > 0.0){
-		    if (startpos + STARTCODON_LEN + trans_init_window - 1 + tis_motif_memory < dnalen){
-			endPartProb *= transInitMotif->seqProb(sequence + startpos + STARTCODON_LEN, true, true);// HMM
-			if (transInitBinProbs.nbins >= 1) {
-			    int idx = GCtransInitBinProbs[gcIdx].getIndex(endPartProb);// map prob to CRF score
-			    if (inCRFTraining && (countEnd < 0 || (startpos >= countStart && startpos <= countEnd)))
-				GCtransInitBinProbs[gcIdx].addCount(idx);
-			    endPartProb = transInitBinProbs.avprobs[idx];
-			}
-		    }
-		    else
-			endPartProb = pow(0.25, (double)(dnalen-(startpos + STARTCODON_LEN)));
-		}
-	    } else 
-		endPartProb = 0.0;
+	    endPartProb = transInitProb(startpos, false);
 	    // check if we have extrinsic information about a reverse start codon
 	    feature = seqFeatColl->getFeatureListOvlpingRange(startF, startpos, startpos + STARTCODON_LEN - 1 , minusstrand); 
 	    if (feature) {
@@ -1439,39 +1576,18 @@ Double ExonModel::notEndPartEmiProb(int beginOfStart, int right, int frameOfRigh
     switch( etype ){
 	case singleG: case initial0: case initial1: case initial2:
 	    // start codon at the beginning?
-	    if ((beginOfBioExon >= 0) && GeneticCode::isStartcodon(sequence + beginOfBioExon)){
-		beginPartProb = GeneticCode::startCodonProb(sequence + beginOfStart - STARTCODON_LEN);
-		if (beginPartProb > 0.0){
-		    // two cases ... . the normal one with enough sequence space before the gene
-		    int transInitStart = beginOfBioExon - trans_init_window;
-		    if (transInitStart > transInitMotif->k){
-			beginPartProb *= transInitMotif->seqProb(sequence+transInitStart);
-			if (transInitBinProbs.nbins >= 1) {
-			    int idx = GCtransInitBinProbs[gcIdx].getIndex(beginPartProb);// map prob to CRF score
-			    if (inCRFTraining && (countEnd < 0 || (transInitStart >= countStart && transInitStart <= countEnd)))
-				GCtransInitBinProbs[gcIdx].addCount(idx);
-			    beginPartProb = transInitBinProbs.avprobs[idx];
-			}
-		    } else {
-			/* ... and the case where there is no place for the transInitMotif
-			 * take emission probs of 1/4 for the rest up to the beginning of the seq
-			 * endOfPred is negative in this case!
-			 * Need this if the gene starts right after the sequence.
-			 */
-			beginPartProb *= pow(0.25, (double)(beginOfStart - STARTCODON_LEN));
+	    beginPartProb = transInitProb(beginOfBioExon, true);
+	    if (beginPartProb > 0.0){
+		feature = seqFeatColl->getFeatureListOvlpingRange(startF, beginOfStart-3, beginOfStart-1 , plusstrand); 
+		if (feature) {
+		    while (feature) {
+			if (feature->start <= beginOfStart-3 && feature->end >= beginOfStart-1)
+			    extrinsicQuot *= feature->distance_faded_bonus(beginOfStart-2);
+			feature = feature->next;
 		    }
-		    feature = seqFeatColl->getFeatureListOvlpingRange(startF, beginOfStart-3, beginOfStart-1 , plusstrand); 
-		    if (feature) {
-			while (feature) {
-			    if (feature->start <= beginOfStart-3 && feature->end >= beginOfStart-1)
-				extrinsicQuot *= feature->distance_faded_bonus(beginOfStart-2);
-			    feature = feature->next;
-			}
-		    } else if (seqFeatColl->collection->hasHintsFile)
-			extrinsicQuot = seqFeatColl->collection->malus(startF);
-		}
-	    } else 
-		beginPartProb = 0.0; 
+		} else if (seqFeatColl->collection->hasHintsFile)
+		    extrinsicQuot = seqFeatColl->collection->malus(startF);
+	    }
 	    break;
 	case terminal: case internal0: case internal1: case internal2:
 	    if (beginOfStart > 0) {
@@ -1576,9 +1692,9 @@ Double ExonModel::notEndPartEmiProb(int beginOfStart, int right, int frameOfRigh
 	Seq2Int s2i(right-beginOfStart+1);
 	try {
 	    if (isOnFStrand(etype))
-		restSeqProb = Pls[right-beginOfStart][frameOfRight][s2i(sequence + beginOfStart)];
+		restSeqProb = (*curPls)[right-beginOfStart][frameOfRight][s2i(sequence + beginOfStart)];
 	    else
-		restSeqProb = Pls[right-beginOfStart][mod3(frameOfRight + right - beginOfStart)]
+		restSeqProb = (*curPls)[right-beginOfStart][mod3(frameOfRight + right - beginOfStart)]
 		    [s2i.rc(sequence + beginOfStart)];		
 	} catch (InvalidNucleotideError e) {
 	    // we dont assume anything in this case, take iid uniform distribution on {a,c,g,t}
@@ -1606,9 +1722,9 @@ Double ExonModel::notEndPartEmiProb(int beginOfStart, int right, int frameOfRigh
 		restSeqProb = 1;
 	    else
 		if (isOnFStrand(etype)) // init pattern at left side
-		    restSeqProb = Pls[k-1][mod3(frameOfRight-right+endOfStart)][Seq2Int(k)(sequence + beginOfStart)];
+		    restSeqProb = (*curPls)[k-1][mod3(frameOfRight-right+endOfStart)][Seq2Int(k)(sequence + beginOfStart)];
 		else                  // init pattern at right side
-		    restSeqProb = Pls[k-1][mod3(frameOfRight+right-beginOfInitP)]
+		    restSeqProb = (*curPls)[k-1][mod3(frameOfRight+right-beginOfInitP)]
 			[Seq2Int(k).rc(sequence + beginOfInitP)];
 	} catch (InvalidNucleotideError e) {
 	    restSeqProb = pow(Constant::probNinCoding, (int) k ); // 0.25
@@ -1954,7 +2070,7 @@ Double ExonModel::seqProb(int left, int right, int frameOfRight) const {
             try {
 		int f = reverse? mod3(frameOfRight+right-curpos) : mod3(frameOfRight-right+curpos);
 		int pn = reverse? s2i.rc(sequence+curpos) : s2i(sequence+curpos-k);
-		seqProb *= emiprobs.probs[f][pn];
+		seqProb *= curEmiTable[f * emiTable.getSize() + pn];
             } catch (InvalidNucleotideError e) {
                 seqProb *= Constant::probNinCoding; //  0.25, 1/4
             }
@@ -1969,7 +2085,7 @@ Double ExonModel::seqProb(int left, int right, int frameOfRight) const {
 	try {
 	    int f = reverse? mod3(frameOfRight+right-curpos) : mod3(frameOfRight-right+curpos);
 	    int pn = reverse? s2i.rc(sequence+curpos) : s2i(sequence+curpos-k);
-	    seqProb  *= emiprobs.probs[f][pn];
+	    seqProb  *= curEmiTable[f * emiTable.getSize() + pn];
 	    if (inCRFTraining && (countEnd < 0 || (curpos >= countStart && curpos <= countEnd)))
 		GCemiprobs[gcIdx].addCount(GCemiprobs[gcIdx].getIndex(f,pn));
 	} catch (InvalidNucleotideError e) {
@@ -2009,7 +2125,7 @@ Double ExonModel::eTermSeqProb(int left, int right, int frameOfRight) const {
 	    try {
 		int f = reverse? mod3(frameOfRight+right-curpos) : mod3(frameOfRight-right+curpos);
 		int pn = reverse? s2i.rc(sequence+curpos) : s2i(sequence+curpos-k);
-		seqProb *= etemiprobs[f][pn];
+		seqProb *= curEtEmiTable[f * etEmiTable.getSize() + pn];
 	    } catch (InvalidNucleotideError e) {
 		seqProb *= Constant::probNinCoding; // 0.25, 1/4
 	    }
@@ -2036,7 +2152,7 @@ Double ExonModel::initialSeqProb(int left, int right, int frameOfRight) const {
 	try {
 	    int f = reverse? mod3(frameOfRight+right-curpos) : mod3(frameOfRight-right+curpos);
 	    int pn = reverse? s2i.rc(sequence+curpos) : s2i(sequence+curpos-k);
-	    seqProb *= initemiprobs[f][pn];
+	    seqProb *= curInitEmiTable[f * initEmiTable.getSize() + pn];
 	} catch (InvalidNucleotideError e) {
 	    seqProb *= Constant::probNinCoding; // 0.25, 1/4
 	}
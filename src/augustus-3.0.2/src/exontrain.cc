@@ -23,6 +23,9 @@
 #include <fstream>
 #include <sstream>
 
+// registers the coding sequences for counting the patterns, see PatternCounter
+static PatternCounter patternCounter;
+
 
 /*
  * ===[ ExonModel::buildModel ]===========================================
@@ -105,6 +108,7 @@ void ExonModel::buildModel( const AnnoSequence* annoseq, int parIndex){
     }
 */
 
+    patternCounter.count();
     buildProbabilities( );
     delete tiswins; // free memory
     lastParIndex = parIndex;
@@ -894,26 +898,27 @@ void ExonModel::processTerminalExon( const State* exon){
 void ExonModel::processInnerSequence(const char *begin, const char* end, int modeltype){
     if (begin > end)
 	return;
-    Seq2Int s2i(k+1);
+    vector<Integer> *counts;
+    if (modeltype == 0)
+	counts = patterncount;
+    else if (modeltype == 2 ) // initial part of the coding region
+	counts = initpatterncount;
+    else if (modeltype == 3 ) // terminal part of an internal exon
+	counts = etpatterncount;
+    else 
+	throw ProjectError("ExonModel::processInnerSequence: invalid model type");
+    // the patterns are counted later by patternCounter.count(), here only check for stop codons
+    const char *first = begin;
+    int firstwin = curwin % 3;
     for( ; begin <= end; begin++){
 	curwin %= 3;
 	if (curwin==0 && end-begin>=STOPCODON_LEN && GeneticCode::isStopcodon(begin)){
+	    patternCounter.add(counts, gesbasen, first, begin-1, k, gweight, 3, firstwin);
 	    throw ExonModelError("in-frame stop codon");
 	}
-	try {
-	    int pn = s2i(begin-k);
-	    if (modeltype == 0)
-		patterncount[ curwin ][pn] += gweight;
-	    else if (modeltype == 2 ) // initial part of the coding region
-		initpatterncount[ curwin ][pn] += gweight;
-	    else if (modeltype == 3 ) // terminal part of an internal exon
-		etpatterncount[ curwin ][pn] += gweight;
-	    else 
-		throw ProjectError("ExonModel::processInnerSequence: invalid model type");
-	    gesbasen[curwin] += gweight;
-	} catch (InvalidNucleotideError e) {}
 	curwin++;
     }
+    patternCounter.add(counts, gesbasen, first, end, k, gweight, 3, firstwin);
 }
 
 
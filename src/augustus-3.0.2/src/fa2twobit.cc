@@ -0,0 +1,170 @@
+/**********************************************************************
+ * Pack genomes from flat files in fasta format into a single file in .2bit format.
+ * file:    fa2twobit.cc
+ * licence: Artistic Licence, see file LICENCE.TXT or
+ *          http://www.opensource.org/licenses/artistic-license.php
+ *
+ **********************************************************************/
+
+// Project includes
+#include "fasta.hh"
+#include "twobit.hh"
+#include "randseqaccess.hh"
+
+// standard C/C++ includes
+#include <string>
+#include <iostream>
+#include <fstream>
+#include <getopt.h>     /* for getopt_long; standard getopt is in unistd.h */
+#include <stdlib.h>     /* for exit() */
+
+#include <boost/iostreams/filtering_stream.hpp>
+#include <boost/iostreams/filter/gzip.hpp>
+
+using namespace std;
+using boost::iostreams::filtering_istream;
+using boost::iostreams::gzip_decompressor;
+
+void printUsage();
+void openInput(string filename, ifstream &ifstrm, filtering_istream &zin);
+bool isFasta(string filename);
+void addFastaFile(TwoBitWriter &writer, string filename, string species);
+
+/*
+ * main
+ */
+int main( int argc, char* argv[] ){
+    int c;
+    int help = 0;
+    string species;
+    static struct option long_options[] = {
+        {"species", 1, 0, 's'},
+        {"help", 0, 0, 'h'},
+        {NULL, 0, NULL, 0}
+    };
+    int option_index = 0;
+    while ((c = getopt_long(argc, argv, "s:h", long_options, &option_index)) != -1) {
+        switch (c) {
+        case 's':
+	    species = optarg;
+            break;
+        case 'h':
+            help = 1;
+            break;
+        default:
+            break;
+        }
+    }
+    if (help) {
+	printUsage();
+	exit(1);
+    }
+    if (optind != argc-2) {
+	cerr << "Expected an input file name and an output file name." << endl;
+	printUsage();
+	exit(1);
+    }
+    string infilename = argv[optind];
+    string outfilename = argv[optind+1];
+
+    try {
+	TwoBitWriter writer(outfilename);
+	if (isFasta(infilename)) {
+	    addFastaFile(writer, infilename, species);
+	} else {
+	    if (!species.empty())
+		throw ProjectError("--species is only used with a FASTA file. " + infilename + " does not look like one.");
+	    map<string,string> filenames = getFileNames(infilename);
+	    for (map<string,string>::iterator it = filenames.begin(); it != filenames.end(); ++it)
+		addFastaFile(writer, it->second, it->first);
+	}
+	if (writer.getNumSeqs() == 0)
+	    throw ProjectError("No sequences found.");
+	writer.close();
+	cout << "Wrote " << writer.getNumSeqs() << " sequences (total length " << writer.getNumBases()
+	     << " bp) to " << outfilename << "." << endl;
+    } catch( ProjectError &err ){
+        cerr << "\n" <<  argv[0] << ": ERROR\n\t" << err.getMessage() << "\n\n";
+	exit(1);
+    }
+}
+
+/*
+ * reads from a gzip file through the decompressor, from other files directly
+ */
+void openInput(string filename, ifstream &ifstrm, filtering_istream &zin){
+    ifstrm.open(filename.c_str());
+    if (!ifstrm)
+	throw ProjectError("Could not open input file \"" + filename + "\"!");
+    try {
+	zin.push(gzip_decompressor());
+	zin.push(ifstrm);
+	zin.peek();
+	if (!zin)
+	    throw ProjectError("Could not read first character assuming gzip format.");
+    } catch (...) { // boost::iostreams::gzip_error&
+	// not a gzip file or ill-formatted
+	zin.reset();
+	ifstrm.clear();
+	ifstrm.seekg(0);
+	zin.push(ifstrm);
+    }
+}
+
+/*
+ * true if the first character other than white space is '>'
+ */
+bool isFasta(string filename){
+    ifstream ifstrm;
+    filtering_istream zin;
+    openInput(filename, ifstrm, zin);
+    zin >> ws;
+    return zin && zin.peek() == '>';
+}
+
+/*
+ * adds all sequences of a FASTA file, possibly gzipped, with names species.seqname
+ * or just seqname if no species is given
+ */
+void addFastaFile(TwoBitWriter &writer, string filename, string species){
+    ifstream ifstrm;
+    filtering_istream zin;
+    openInput(filename, ifstrm, zin);
+    char *sequence = NULL, *name = NULL;
+    int length, seqCount = 0;
+    readOneFastaSeq(zin, sequence, name, length);
+    while (sequence){
+	writer.addSeq(species.empty()? string(name) : species + "." + name, sequence, length);
+	seqCount++;
+	delete [] sequence;
+	delete [] name;
+	sequence = name = NULL;
+	readOneFastaSeq(zin, sequence, name, length);
+    }
+    delete [] name;
+    cout << filename << ": " << seqCount << " sequences" << endl;
+}
+
+void printUsage(){
+    cout << "usage:\n\
+fa2twobit [parameters] inputfilename outputfilename\n\
+\n\
+inputfilename refers to a genome file in FASTA format (may be gzipped) or to a list of genomes\n\
+in the format of the --speciesfilenames parameter of augustus:\n\
+hg19 <TAB> /dir/to/genome/human.fa\n\
+mm9 <TAB> /dir/to/genome/mouse.fa\n\
+All sequences are written to a single file outputfilename in the .2bit format of UCSC.\n\
+The sequences of the species in a list are named SPECIES.seqname, e.g. hg19.chr21.\n\
+Letters other than a, c, g, t are stored as N, upper and lower case are not distinguished.\n\
+\n\
+parameters:\n\
+--help        print this usage info\n\
+--species     only with a FASTA file: the sequences are named SPECIES.seqname\n\
+\n\
+example:\n\
+     fa2twobit genomes.tbl genomes.2bit\n\
+     augustus --species=human --treefile=tree.nwk --alnfile=aln.maf --speciesfilenames=genomes2bit.tbl\n\
+where genomes2bit.tbl lists genomes.2bit as the file of each species:\n\
+hg19 <TAB> genomes.2bit\n\
+mm9 <TAB> genomes.2bit\n";
+}
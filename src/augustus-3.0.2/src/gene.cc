@@ -1026,18 +1026,20 @@ char* Gene::getCodingSequence(AnnoSequence *annoseq) const{
 
 bool Gene::hasInFrameStop(AnnoSequence *annoseq) const{
     Seq2Int s2i(3);
-    const char * codingSeq = getCodingSequence(annoseq);
-    codingSeq += mod3(-frame); // if gene is incomplete, frame is the position of the first base
-    while (strlen(codingSeq)>3){
+    char *codingSeqStart = getCodingSequence(annoseq);
+    const char *codingSeq = codingSeqStart + mod3(-frame); // if gene is incomplete, frame is the position of the first base
+    bool found = false;
+    while (!found && strlen(codingSeq)>3){
 	try {
 	    if (GeneticCode::map[s2i(codingSeq)] < 0){
 		//in-frame stop codon. Can happen when stop codon is parted by splice site, hopefully rare.
-		return true;
+		found = true;
 	    }
 	} catch (...) {}// because of masking
 	codingSeq += 3;
     }
-    return false;
+    delete [] codingSeqStart;
+    return found;
 }
 
 // void Gene::computeBC(char *seq){
@@ -2271,11 +2273,11 @@ void Gene::init() {
 list<Gene> *Gene::filterGenePrediction(list<Gene> *gl, const char *seq, Strand strand, bool noInFrameStop, double minmeanexonintronprob, double minexonintronprob){
     State *s;
     list<Gene> *filteredTranscripts = new list<Gene>;
-    AnnoSequence *annoseq = new AnnoSequence();
-    annoseq->sequence = newstrcpy(seq);
-    annoseq->offset = 0;
+    AnnoSequence annoseq; // only a view on seq, which is not copied
+    annoseq.sequence = const_cast<char*>(seq);
+    annoseq.offset = 0;
 
-    for(list<Gene>::iterator git = gl->begin();git != gl->end();git++){
+    for(list<Gene>::iterator git = gl->begin();git != gl->end();){
 	bool keep = true;
 	// delete gene if the combined CDS is too short, unless a CDS exon is truncated
 	if (git->clength < Constant::min_coding_len && git->completeCDS())
@@ -2285,7 +2287,7 @@ list<Gene> *Gene::filterGenePrediction(list<Gene> *gl, const char *seq, Strand s
 	if (keep && git->throwaway)
 	    keep = false;
     
-	if (keep && git->hasInFrameStop(annoseq) && noInFrameStop){
+	if (keep && noInFrameStop && git->hasInFrameStop(&annoseq)){
 	    keep = false;
 	}
 	if (keep && git->hasProbs) {
@@ -2316,14 +2318,17 @@ list<Gene> *Gene::filterGenePrediction(list<Gene> *gl, const char *seq, Strand s
 	}
 
 	if (keep) {
-	    filteredTranscripts->push_back(*git);
+	    // move the gene over instead of copying its states
+	    list<Gene>::iterator kept = git++;
+	    filteredTranscripts->splice(filteredTranscripts->end(), *gl, kept);
 	} else {
 #ifdef DEBUG
 	    // cerr << "Gene deleted! (clength " << git->id << ")" << endl;
 #endif
+	    git++;
 	}
     }
-    delete annoseq;
+    annoseq.sequence = NULL;
     return filteredTranscripts;
 }
 
@@ -2910,9 +2915,10 @@ list<Gene> *reverseGeneList(list<Gene> *geneList, int endpos){
  * Sort genes by increasing transcription start
  */
 
-list<Gene*>* sortGenePtrList(list<Gene*> glist){
+list<Gene*>* sortGenePtrList(const list<Gene*> &glist){
   list<Gene*> *returnlist = new list<Gene*>;
-  list<Gene*>::iterator git1, git2;
+  list<Gene*>::const_iterator git1;
+  list<Gene*>::iterator git2;
   // insertion sort, quick if glist already sorted
   for (git1 = glist.begin(); git1 != glist.end(); git1++){
     git2 = returnlist->begin();
@@ -3107,44 +3113,44 @@ void reverseGeneSequence(Gene* &seq, int endpos){
  * postprocess predicted genes
  * currently only truncate hard-masked regions at ends of UTR
  */
-void postProcessGenes(list<AltGene> *genes, AnnoSequence *annoseq){
-    if (!genes || !annoseq)
+void postProcessGenes(list<AltGene> *genes, const char *dna){
+    if (!genes || !dna)
 	return;
     try {
 	if (Properties::getBoolProperty("truncateMaskedUTRs")){
 	    for (list<AltGene>::iterator agit = genes->begin(); agit != genes->end(); ++agit){
 		for (list<Gene*>::iterator git = agit->transcripts.begin(); git != agit->transcripts.end(); ++git){
-		    (*git)->truncateMaskedUTR(annoseq);
+		    (*git)->truncateMaskedUTR(dna);
 		}
 	    }
 	}
     } catch(...){}
 }
 
-void Gene::truncateMaskedUTR(AnnoSequence *annoseq){
+void Gene::truncateMaskedUTR(const char *dna){
     if (utr5exons && strand == plusstrand && complete5utr){
-	while (utr5exons->begin <= utr5exons->end && !isNuc(annoseq->sequence + utr5exons->begin)){
+	while (utr5exons->begin <= utr5exons->end && !isNuc(dna + utr5exons->begin)){
 	    utr5exons->begin++;
 	    transstart = utr5exons->begin;
 	    complete5utr = false;
 	}
     }
     if (utr3exons && strand == minusstrand && complete3utr){
-	while (utr3exons->begin <= utr3exons->end && !isNuc(annoseq->sequence + utr3exons->begin)){
+	while (utr3exons->begin <= utr3exons->end && !isNuc(dna + utr3exons->begin)){
 	    utr3exons->begin++;
 	    transstart = utr3exons->begin;
 	    complete3utr = false;
 	}
     }
     if (utr5exons && strand == minusstrand && complete5utr){
-	while (utr5exons->end >= utr5exons->begin && !isNuc(annoseq->sequence + utr5exons->end)){
+	while (utr5exons->end >= utr5exons->begin && !isNuc(dna + utr5exons->end)){
 	    utr5exons->end--;
 	    transend = utr5exons->end;
 	    complete5utr = false;
 	}
     }
     if (utr3exons && strand == plusstrand && complete3utr){
-	while (utr3exons->end >= utr3exons->begin && !isNuc(annoseq->sequence + utr3exons->end)){
+	while (utr3exons->end >= utr3exons->begin && !isNuc(dna + utr3exons->end)){
 	    utr3exons->end--;
 	    transend = utr3exons->end;
 	    complete3utr = false;
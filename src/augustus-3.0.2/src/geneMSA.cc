@@ -145,7 +145,7 @@ map<string,ExonCandidate*>* GeneMSA::getECHash(list<ExonCandidate*> *ec) {
 }
 
 // computes and sets the exon candidates for species s
-void GeneMSA::createExonCands(int s, const char *dna){
+void GeneMSA::createExonCands(int s, const char *dna, NAMGene &namgene){
     double assmotifqthresh = 0.15;
     double assqthresh = 0.3;
     double dssqthresh = 0.7;
@@ -155,7 +155,7 @@ void GeneMSA::createExonCands(int s, const char *dna){
     Properties::assignProperty("/CompPred/dssqthresh", dssqthresh);
     // TODO Properties::assignProperty("/CompPred/minExonCandLen", minEClen);
 
-    exoncands[s] = findExonCands(dna, minEClen, assmotifqthresh, assqthresh, dssqthresh); 
+    exoncands[s] = namgene.getExonCands(dna, minEClen, assmotifqthresh, assqthresh, dssqthresh);
     cout << "Found " << exoncands[s]->size() << " ECs on species " << rsa->getSname(s) << endl; 
 }
 
@@ -630,7 +630,8 @@ vector<string> GeneMSA::getCodonAlignment(OrthoExon const &oe, vector<AnnoSequen
 
 
 // computes and sets the Omega = dN/dS attribute to all OrthoExons
-void GeneMSA::computeOmegas(vector<AnnoSequence> const &seqRanges) {
+// The codon alignments of all OrthoExons are built first and their omegas estimated together in numThreads threads.
+void GeneMSA::computeOmegas(vector<AnnoSequence> const &seqRanges, int numThreads) {
     // int subst = 0;
     // Initialize for each species the first fragment froms[s] that 
     // is not completely left of the current OrthoExon.
@@ -640,6 +641,7 @@ void GeneMSA::computeOmegas(vector<AnnoSequence> const &seqRanges) {
     for (size_t s=0; s < numSpecies(); s++)
 	if (alignment->rows[s])
 	    froms[s] = alignment->rows[s]->frags.begin();
+    vector<vector<string> > codonAlis;
     for (list<OrthoExon>::iterator oe = orthoExonsList.begin(); oe != orthoExonsList.end(); ++oe){
 	// move fragment iterators to start of exon candidates
 	for (size_t s=0; s < numSpecies(); s++)
@@ -648,8 +650,7 @@ void GeneMSA::computeOmegas(vector<AnnoSequence> const &seqRanges) {
 		      && froms[s]->chrPos + froms[s]->len - 1 < offsets[s] + oe->orthoex[s]->getStart())
 		    ++froms[s];
 		
-	vector<string> rowstrings = getCodonAlignment(*oe, seqRanges, froms);
-	double omega;
+	codonAlis.push_back(getCodonAlignment(*oe, seqRanges, froms));
 	// TODO: scale branch lengths to one substitution per codon per time unit
 	// cout << "OE" << endl;
 	//	printSingleOrthoExon(*oe, false);
@@ -657,9 +658,12 @@ void GeneMSA::computeOmegas(vector<AnnoSequence> const &seqRanges) {
 	// omega = codonevo->estOmegaOnSeqTuple(rowstrings, tree, subst);
 	//	cout << "omega=" << omega << endl;
 	// oe->setSubst(subst);
-	omega = codonevo->graphOmegaOnCodonAli(rowstrings, tree);
-	oe->setOmega(omega);
     }
+    vector<double> omegas;
+    codonevo->graphOmegaOnCodonAlis(codonAlis, tree, omegas, numThreads);
+    int a = 0;
+    for (list<OrthoExon>::iterator oe = orthoExonsList.begin(); oe != orthoExonsList.end(); ++oe, ++a)
+	oe->setOmega(omegas[a]);
 }
 
 // calculate a columnwise conservation score and output it (for each species) in wiggle format
@@ -788,3 +792,16 @@ void GeneMSA::closeOutputFiles(){
 	}
     }
 }
+
+void GeneMSA::flushOutputFiles(){
+    for (int i=0; i<tree->numSpecies(); i++) {
+	if (i < exonCands_outfiles.size() && exonCands_outfiles[i])
+	    exonCands_outfiles[i]->flush();
+	if (geneRanges_outfiles[i])
+	    geneRanges_outfiles[i]->flush();
+	if (orthoExons_outfiles[i])
+	    orthoExons_outfiles[i]->flush();
+	if (omega_outfiles[i])
+	    omega_outfiles[i]->flush();
+    }
+}
@@ -26,6 +26,11 @@
 #include <boost/graph/bellman_ford_shortest_paths.hpp>
 //#include <boost/graph/topological_sort.hpp>
 #include <unordered_set>
+#include <set>
+#include <sstream>
+#include <cstdio>
+#include <sys/stat.h>
+#include <unistd.h>
 
 using boost::graph_bundle;
 using boost::property_map;
@@ -61,23 +66,51 @@ bool cmpSigPtr(const MsaSignature *s1, const MsaSignature *s2){
     return *s1 < *s2;
 }
 
+bool readMafBlock(istream &in, vector<MafRow> &rows, streamoff &offset){
+    rows.clear();
+    bool inBlock = false;
+    string line;
+    while (true) {
+	streamoff lineStart = in.tellg();
+	if (!getline(in, line))
+	    break;
+	if (line.find_first_not_of(" \t\r") == string::npos){ // empty line
+	    if (inBlock)
+		return true;
+	    continue;
+	}
+	if (line[0] == 'a'){
+	    if (inBlock){ // next block without an empty line in between
+		in.seekg(lineStart);
+		return true;
+	    }
+	    inBlock = true;
+	    offset = lineStart;
+	} else if (line[0] == 's'){
+	    if (!inBlock){
+		inBlock = true;
+		offset = lineStart;
+	    }
+	    MafRow row;
+	    string s;
+	    istringstream linestrm(line);
+	    linestrm >> s >> row.completeName >> row.chrStart >> row.seqLen >> row.strandChar >> row.lenOfChr >> row.rowseq;
+	    if (!linestrm)
+		throw ProjectError("Error in MAF. Could not read the line\n" + line);
+	    rows.push_back(row);
+	}
+    }
+    in.clear(); // end of file, let tellg and seekg work again
+    return inBlock;
+}
+
 /*  *.maf file is read and saved into this->alignment
  *  only the species with names in the given list are considered, the rest is ignored
  */
 void GenomicMSA::readAlignment(string alignFilename) {
-    int index = 0;
-    string rowseq, buffer;
-    string completeName;
-    char strandChar;
-    AlignmentRow *row;
-    Alignment *alignBlock;
     map<string, size_t> notExistingSpecies;
-    int lenOfChr;
-    string speciesName;
-    string seqID;
-    int chrStart;
-    int seqLen; 
-    Strand strand;
+    vector<MafRow> mafrows;
+    streamoff offset;
 
     numSpecies = rsa->getNumSpecies();
     ifstream Alignmentfile;
@@ -86,88 +119,242 @@ void GenomicMSA::readAlignment(string alignFilename) {
 	string errmsg = "Could not open the alignment file " + alignFilename + ".";
         throw PropertiesError(errmsg);
     }
+    while (readMafBlock(Alignmentfile, mafrows, offset))
+	addMafBlock(mafrows, notExistingSpecies);
+    // clean up
+    Alignmentfile.close();
+    warnNotExistingSpecies(notExistingSpecies);
+}
+
+void GenomicMSA::readAlignment(string alignFilename, const MafRegion &region) {
+    map<string, size_t> notExistingSpecies;
+    vector<MafRow> mafrows;
+    streamoff offset;
+    vector<MafBin> bins;
+
+    numSpecies = rsa->getNumSpecies();
+    getMafIndex(alignFilename)->getBins(region, bins);
+    ifstream Alignmentfile;
+    Alignmentfile.open(alignFilename.c_str(), ifstream::in);
+    if (!Alignmentfile) {
+	string errmsg = "Could not open the alignment file " + alignFilename + ".";
+        throw PropertiesError(errmsg);
+    }
+    for (int i=0; i < bins.size(); i++) {
+	Alignmentfile.seekg(bins[i].begin);
+	while (Alignmentfile.tellg() < bins[i].stop && readMafBlock(Alignmentfile, mafrows, offset)) {
+	    if (mafrows.empty())
+		continue;
+	    const MafRow &first = mafrows.front();
+	    if (first.completeName == region.seqname && first.plusStart() < region.end && first.plusEnd() > region.start)
+		addMafBlock(mafrows, notExistingSpecies);
+	}
+    }
+    Alignmentfile.close();
+    warnNotExistingSpecies(notExistingSpecies);
+}
+
+vector<string> GenomicMSA::getMafSeqNames(string alignFilename){
+    return getMafIndex(alignFilename)->getSeqNames();
+}
+
+MafIndex *GenomicMSA::getMafIndex(string alignFilename){
+    if (!mafIndex)
+	mafIndex = new MafIndex(alignFilename);
+    return mafIndex;
+}
+
+/*
+ * The rows of the block are placed at the index of their species. Once a row for each species
+ * was found, the remaining rows of the .maf block form a new alignment.
+ */
+void GenomicMSA::addMafBlock(const vector<MafRow> &mafrows, map<string, size_t> &notExistingSpecies){
+    int index = 0;
+    AlignmentRow *row;
+    Alignment *alignBlock = NULL;
+    string speciesName;
+    string seqID;
+    Strand strand;
+    int numSpeciesFound = 0;
 
-    while (!Alignmentfile.eof()) {
-        Alignmentfile >> buffer;
-        int numSpeciesFound = 0;
-        if (buffer == "s") {
+    for (vector<MafRow>::const_iterator mr = mafrows.begin(); mr != mafrows.end(); ++mr) {
+	if (alignBlock && numSpeciesFound >= numSpecies) {
+	    alignment.push_back(alignBlock);
+	    alignBlock = NULL;
+	}
+	if (!alignBlock) {
 	    alignBlock = new Alignment(numSpecies); // create new empty alignment block
-            // loop over the lines of the alignment block, don't search any further if enough species were found
-            while (numSpeciesFound < numSpecies && buffer == "s" && !Alignmentfile.eof()) {
-		// reads the name of the species and the seqID from the first column
-		// TODO: may have to be checked/adjusted for general .maf files
-		Alignmentfile >> completeName >> chrStart >> seqLen >> strandChar >> lenOfChr >> rowseq >> buffer;
-		
-		// split species name and sequence ID
-		for (int i=0; i<completeName.length(); i++) {
-		    // seperator is the point '.' for example hs19.chr21, has to be changed
-		    if ((completeName[i] == '-') || (completeName[i] == '.')) { 
-			speciesName = completeName.substr(0,i);
-			seqID = completeName.substr(i+1, string::npos);
-			// some input file have a suffix "(..)" that needs to be stripped
-			string::size_type p = seqID.find_first_of("(");
-			if (p != std::string::npos)
-			    seqID = seqID.erase(p); 
-			break;
-		    }
-		    if (i == completeName.length()-1) {
-			speciesName = completeName;
-			seqID = "unknown";
-		    }
-		}
-		  
-		if (strandChar == '+') {
-		    strand = plusstrand;
-		} else if (strandChar == '-') {
-		    strand = minusstrand;
-		} else {
-		    strand = STRAND_UNKNOWN;
-		}
-		if (!alignBlock->aliLen)
-		    alignBlock->aliLen = rowseq.length();
-		else if (alignBlock->aliLen != rowseq.length()) {
-		    throw ProjectError("Error in MAF in sequence " + seqID + " at position " + itoa(chrStart) 
-				       + ". Alignment row does not agree in length.");
-		}
-		
-		row = new AlignmentRow (seqID, chrStart, strand, rowseq);
-		if (seqLen != row->getSeqLen())
-		    cerr << "Inconsistenty in .maf file: Sequence length different from number of non-gap characters in row:" 
-			 << endl << "speciesName" << "." << seqID << "\t" << chrStart << "\t" << seqLen << "\t" << rowseq << endl;
-		
-		index = rsa->getIdx(speciesName);
-		if (index >= 0) { // species name in the white list
-		    alignBlock->rows[index] = row; // place at the right position
-		    // store chrLen and check whether consistent with previous chrLen
-		    try {
-			rsa->setLength(index, row->seqID, lenOfChr);
-		    } catch (ProjectError e){
-			cerr << e.getMessage() << endl << "MAF file inconsistent." << endl;
-			throw e;
-		    }
-		    numSpeciesFound++;
-		} else {
-		    // "Species " << speciesName << " not in tree"
-		    notExistingSpecies.insert(pair<string, size_t>(speciesName, 1));
-		    delete row;
-		}
+	    numSpeciesFound = 0;
+	}
+	const string &completeName = mr->completeName;
+	// split species name and sequence ID
+	for (int i=0; i<completeName.length(); i++) {
+	    // seperator is the point '.' for example hs19.chr21, has to be changed
+	    if ((completeName[i] == '-') || (completeName[i] == '.')) { 
+		speciesName = completeName.substr(0,i);
+		seqID = completeName.substr(i+1, string::npos);
+		// some input file have a suffix "(..)" that needs to be stripped
+		string::size_type p = seqID.find_first_of("(");
+		if (p != std::string::npos)
+		    seqID = seqID.erase(p); 
+		break;
+	    }
+	    if (i == completeName.length()-1) {
+		speciesName = completeName;
+		seqID = "unknown";
+	    }
+	}
+	  
+	if (mr->strandChar == '+') {
+	    strand = plusstrand;
+	} else if (mr->strandChar == '-') {
+	    strand = minusstrand;
+	} else {
+	    strand = STRAND_UNKNOWN;
+	}
+	if (!alignBlock->aliLen)
+	    alignBlock->aliLen = mr->rowseq.length();
+	else if (alignBlock->aliLen != mr->rowseq.length()) {
+	    throw ProjectError("Error in MAF in sequence " + seqID + " at position " + itoa(mr->chrStart) 
+			       + ". Alignment row does not agree in length.");
+	}
+	
+	row = new AlignmentRow (seqID, mr->chrStart, strand, mr->rowseq);
+	if (mr->seqLen != row->getSeqLen())
+	    cerr << "Inconsistenty in .maf file: Sequence length different from number of non-gap characters in row:" 
+		 << endl << "speciesName" << "." << seqID << "\t" << mr->chrStart << "\t" << mr->seqLen << "\t" << mr->rowseq << endl;
+	
+	index = rsa->getIdx(speciesName);
+	if (index >= 0) { // species name in the white list
+	    alignBlock->rows[index] = row; // place at the right position
+	    // store chrLen and check whether consistent with previous chrLen
+	    try {
+		rsa->setLength(index, row->seqID, mr->lenOfChr);
+	    } catch (ProjectError e){
+		cerr << e.getMessage() << endl << "MAF file inconsistent." << endl;
+		throw e;
 	    }
-	    if (numSpeciesFound > 0)
-		alignment.push_back(alignBlock);
-	    else
-		delete alignBlock;
+	    numSpeciesFound++;
+	} else {
+	    // "Species " << speciesName << " not in tree"
+	    notExistingSpecies.insert(pair<string, size_t>(speciesName, 1));
+	    delete row;
 	}
     }
-    // clean up
-    Alignmentfile.close();
+    if (alignBlock && numSpeciesFound > 0)
+	alignment.push_back(alignBlock);
+    else
+	delete alignBlock;
+}
+
+void GenomicMSA::warnNotExistingSpecies(const map<string, size_t> &notExistingSpecies){
     if (!notExistingSpecies.empty()){
 	cerr << "Warning: Species ";
-	    for (map<string,size_t>::iterator it = notExistingSpecies.begin(); it != notExistingSpecies.end(); ++it)
+	    for (map<string,size_t>::const_iterator it = notExistingSpecies.begin(); it != notExistingSpecies.end(); ++it)
 		cerr << it->first << " ";
 	cerr << ((notExistingSpecies.size() > 1)? "are": "is") << " not included in the target list of species. These alignment lines are ingored." << endl;
     }
 }
 
+MafIndex::MafIndex(string alignFilename){
+    string indexFilename = alignFilename + ".idx";
+    if (!read(indexFilename, alignFilename)) {
+	cout << "building index " << indexFilename << " of the alignment file" << endl;
+	build(alignFilename);
+	write(indexFilename);
+    }
+}
+
+void MafIndex::getBins(const MafRegion &region, vector<MafBin> &result) const {
+    result.clear();
+    for (vector<MafBin>::const_iterator bin = bins.begin(); bin != bins.end(); ++bin)
+	if (bin->seqname == region.seqname && bin->start < region.end && bin->end > region.start)
+	    result.push_back(*bin);
+}
+
+/*
+ * false if there is no index file, it is older than the .maf file or of a different version
+ */
+bool MafIndex::read(string indexFilename, string alignFilename){
+    struct stat alnStat, idxStat;
+    if (stat(alignFilename.c_str(), &alnStat) != 0 || stat(indexFilename.c_str(), &idxStat) != 0
+	|| idxStat.st_mtime < alnStat.st_mtime)
+	return false;
+    ifstream idx(indexFilename.c_str());
+    string line;
+    if (!getline(idx, line) || line != "##maf index version 1")
+	return false;
+    bins.clear();
+    seqnames.clear();
+    set<string> known;
+    while (getline(idx, line)) {
+	if (line.empty() || line[0] == '#')
+	    continue;
+	MafBin bin;
+	istringstream linestrm(line);
+	linestrm >> bin.seqname >> bin.start >> bin.end >> bin.begin >> bin.stop;
+	if (!linestrm)
+	    return false;
+	bins.push_back(bin);
+	if (known.insert(bin.seqname).second)
+	    seqnames.push_back(bin.seqname);
+    }
+    return true;
+}
+
+void MafIndex::build(string alignFilename){
+    ifstream Alignmentfile(alignFilename.c_str());
+    if (!Alignmentfile)
+	throw PropertiesError("Could not open the alignment file " + alignFilename + ".");
+    bins.clear();
+    seqnames.clear();
+    set<string> known;
+    vector<MafRow> mafrows;
+    streamoff offset;
+    int numBlocks = 0; // in the last bin
+    while (readMafBlock(Alignmentfile, mafrows, offset)) {
+	if (mafrows.empty())
+	    continue;
+	if (!bins.empty())
+	    bins.back().stop = offset;
+	const MafRow &first = mafrows.front();
+	if (bins.empty() || bins.back().seqname != first.completeName || numBlocks == BINSIZE) {
+	    MafBin bin;
+	    bin.seqname = first.completeName;
+	    bin.start = first.plusStart();
+	    bin.end = first.plusEnd();
+	    bin.begin = offset;
+	    bins.push_back(bin);
+	    numBlocks = 0;
+	    if (known.insert(bin.seqname).second)
+		seqnames.push_back(bin.seqname);
+	} else {
+	    bins.back().start = min(bins.back().start, first.plusStart());
+	    bins.back().end = max(bins.back().end, first.plusEnd());
+	}
+	numBlocks++;
+    }
+    Alignmentfile.seekg(0, ios::end);
+    if (!bins.empty())
+	bins.back().stop = Alignmentfile.tellg();
+}
+
+void MafIndex::write(string indexFilename) const {
+    // write to a temporary file first, other processes may read the index at the same time
+    ostringstream tmpname;
+    tmpname << indexFilename << ".tmp" << getpid();
+    ofstream idx(tmpname.str().c_str());
+    idx << "##maf index version 1" << endl;
+    idx << "# sequence of first rows, range of first rows [start, end), byte range in file [begin, stop)" << endl;
+    for (vector<MafBin>::const_iterator bin = bins.begin(); bin != bins.end(); ++bin)
+	idx << bin->seqname << "\t" << bin->start << "\t" << bin->end << "\t" << bin->begin << "\t" << bin->stop << endl;
+    idx.close();
+    if (!idx || rename(tmpname.str().c_str(), indexFilename.c_str()) != 0) {
+	cerr << "Warning: could not write the index of the alignment file to " << indexFilename << endl;
+	remove(tmpname.str().c_str());
+    }
+}
+
 /* printMAF
  * print alignment, to stdout if outFname is empty string
  */
@@ -255,6 +442,7 @@ void GenomicMSA::findGeneRanges(){
     int uid, vid, wid;
     //int maxGeneLen = 1000000 - 2*GeneMSA::padding;
     int numAlis = alignment.size();
+    signatures.clear(); // of the alignment of a previous call
     alignment.sort(SortCriterion(0)); // sort by first species
     vector<Alignment*> nodesA(alignment.begin(), alignment.end()); // make vector copy of alignment list for random access
     list<int> nodesI; // indices to nodesA
@@ -5,6 +5,7 @@
 #include <sstream>
 #include <iomanip>
 #include <cmath>
+#include <algorithm>
 
 #include "graph.hh"
 #include "mea.hh"
@@ -92,6 +93,29 @@ void Graph::buildGraph(){
     (*node)->edges.sort(compareEdges);
 }
 
+void Graph::buildCSR(){
+
+  nodes.assign(nodelist.begin(), nodelist.end());
+  int n = nodes.size();
+  int m = 0;
+  for(int i=0; i<n; i++){
+    nodes[i]->id = i;
+    m += nodes[i]->edges.size();
+  }
+  edgeOffset.resize(n+1);
+  edgeTo.resize(m);
+  edgeScore.resize(m);
+  int k = 0;
+  for(int i=0; i<n; i++){
+    edgeOffset[i] = k;
+    for(list<Edge>::iterator edge=nodes[i]->edges.begin(); edge!=nodes[i]->edges.end(); edge++, k++){
+      edgeTo[k] = edge->to->id;
+      edgeScore[k] = edge->score;
+    }
+  }
+  edgeOffset[n] = k;
+}
+
 
 bool Graph::edgeExists(Node *e1, Node *e2){
   if(e1 == NULL || e2 == NULL)
@@ -178,30 +202,84 @@ void Graph::createNeutralLine(vector<Node*> &neutralLine){
 
 /*
  * adds introns between exons under biologically reasonable conditions
+ *
+ * sweep over the exons sorted by begin: an exon e1 can only have an intron to exons beginning behind its end.
+ * Apart from the directly adjacent exons only exons in one of the successor classes of e1 (same strand and
+ * reading frame or matching UTR exon type) can be compatible, so only these are looked at. As before, at most
+ * 11 introns leave e1 and the scan ends with the first exon beginning more than 5000 bp behind the end of e1.
  */
 
+static bool beginsBehind(int pos, Node *node){
+  return pos < node->begin;
+}
+
 void Graph::addCompatibleEdges(){
 
   statelist->sort(compareStatus);
-  map<string,Node*> processedStartNodes;
-  map<string,Node*> processedEndNodes;
-  
-  for(list<Node*>::iterator e1=nodelist.begin(); e1!=nodelist.end(); e1++){
-    if((*e1)->item != NULL && processedStartNodes[getKey(*e1)] == 0){
-      processedStartNodes[getKey(*e1)] = *e1;
-      int count = 0;
-      processedEndNodes.clear();
-      for(list<Node*>::iterator e2=e1; e2!=nodelist.end(); e2++){
-	if((*e2)->item != NULL && processedEndNodes[getKey(*e2)] == 0){
-	  processedEndNodes[getKey(*e2)] = *e2;
-	 
-	  if(compatible(*e1,*e2) && !edgeExists(*e1,*e2)){
-	    insertIntron(*e1,*e2);
-	    count++;
-	  }
-	  if(count>10 || (*e2)->begin - (*e1)->end > 5000) //TODO: max_intron_length restriction!
-	    break;	 
-	}	
+
+  vector<Node*> exons; // in the order of nodelist, i.e. sorted by begin
+  for(list<Node*>::iterator node=nodelist.begin(); node!=nodelist.end(); node++)
+    if((*node)->item != NULL)
+      exons.push_back(*node);
+  int n = exons.size();
+
+  // indices of the exons in each successor class, ascending
+  vector< vector<int> > classMembers;
+  for(int i=0; i<n; i++){
+    int c = successorClass(exons[i]);
+    if(c >= 0){
+      if(c >= (int)classMembers.size())
+	classMembers.resize(c+1);
+      classMembers[c].push_back(i);
+    }
+  }
+
+  vector<int> classes;
+  vector<int> next;
+  for(int i=0; i<n; i++){
+    Node *e1 = exons[i];
+    int count = 0;
+    int first = upper_bound(exons.begin(), exons.end(), e1->end, beginsBehind) - exons.begin();
+    int last = upper_bound(exons.begin(), exons.end(), e1->end + 5000, beginsBehind) - exons.begin(); //TODO: max_intron_length restriction!
+    if(last == n)
+      last--;
+
+    // directly adjacent exons
+    int k = first;
+    for(; k <= last && exons[k]->begin == e1->end + 1 && count <= 10; k++){
+      if(compatible(e1,exons[k]) && !edgeExists(e1,exons[k])){
+	insertIntron(e1,exons[k]);
+	count++;
+      }
+    }
+    if(count > 10)
+      continue;
+
+    // exons further downstream: merge the members of the successor classes of e1 in the order of begin
+    targetClasses(e1, classes);
+    next.clear();
+    for(size_t c=0; c<classes.size(); c++){
+      if(classes[c] < (int)classMembers.size()){
+	vector<int> &members = classMembers[classes[c]];
+	next.push_back(lower_bound(members.begin(), members.end(), k) - members.begin());
+      } else
+	next.push_back(0);
+    }
+    while(count <= 10){
+      int best = -1, bestIdx = last+1;
+      for(size_t c=0; c<classes.size(); c++){
+	if(classes[c] < (int)classMembers.size() && next[c] < (int)classMembers[classes[c]].size()
+	   && classMembers[classes[c]][next[c]] < bestIdx){
+	  best = c;
+	  bestIdx = classMembers[classes[c]][next[c]];
+	}
+      }
+      if(best < 0)
+	break;
+      next[best]++;
+      if(compatible(e1,exons[bestIdx]) && !edgeExists(e1,exons[bestIdx])){
+	insertIntron(e1,exons[bestIdx]);
+	count++;
       }
     }
   }
@@ -209,11 +287,13 @@ void Graph::addCompatibleEdges(){
 
 /*
  * adds back edges to the neutral line only if it does not cause non-neutral loops
+ * requires the node numbering of buildCSR()
  */
 
 void Graph::addBackEdges(){
 
-  map<string,Node*> inQueue;
+  vector<int> inQueue(nodelist.size(), -1); // id of the last search that queued the node
+  int search = 0;
   list<Node*> neutralNodes;
   Node *pos = head;
   while(pos != tail){
@@ -229,15 +309,25 @@ void Graph::addBackEdges(){
   }
   neutralNodes.push_back(tail);
 
+  /*
+   * nodes with a non-neutral incoming edge from a node that does not begin behind them,
+   * computed in a single pass over all edges
+   */
+  vector<bool> nonneutralIncoming(nodelist.size(), false);
+  for(list<Node*>::iterator node=nodelist.begin(); node!=nodelist.end(); node++)
+    for(list<Edge>::iterator edge=(*node)->edges.begin(); edge!=(*node)->edges.end(); edge++)
+      if(!edge->neutral && (*node)->begin <= edge->to->begin)
+	nonneutralIncoming[edge->to->id] = true;
+
   for(list<Node*>::iterator fromNeut=neutralNodes.begin(); fromNeut!=neutralNodes.end(); fromNeut++){  
-    if(nonneutralIncomingEdge(*fromNeut)){
+    if(nonneutralIncoming[(*fromNeut)->id]){
       bool nonNeutralLoop = false;
       for(list<Node*>::iterator toNeut=fromNeut; toNeut!=neutralNodes.begin(); toNeut--){   
 	if(nonNeutralLoop)
 	  break;
 	nonNeutralLoop = true;
 	queue<Node*> q;
-	inQueue.clear();
+	search++;
 	int nrNonNeutralEdges = 0;
 	for(list<Edge>::iterator edge=(*toNeut)->edges.begin(); edge!=(*toNeut)->edges.end(); edge++)
 	  if(!edge->neutral)
@@ -249,9 +339,9 @@ void Graph::addBackEdges(){
 	    Node *pos = q.front();
 	    q.pop();
 	    for(list<Edge>::iterator edge=pos->edges.begin(); edge!=pos->edges.end(); edge++){  
-	      if(inQueue[getKey(edge->to)] == 0){
+	      if(inQueue[edge->to->id] != search){
 		q.push(edge->to);
-		inQueue[getKey(edge->to)] = edge->to;
+		inQueue[edge->to->id] = search;
 	      }
 	      if(pos->item != NULL && edge->to->item == NULL && edge->to->begin <= (*fromNeut)->begin)
 		goto nextEdge;
@@ -284,19 +374,6 @@ int Graph::minInQueue(queue<Node*> *q){
   return min;
 }
 
-bool Graph::nonneutralIncomingEdge(Node *exon){
-
-  for(list<Node*>::iterator ex=nodelist.begin(); ex!=nodelist.end(); ex++){
-    if((*ex)->begin > exon->begin)
-      return false;
-    for(list<Edge>::iterator edge=(*ex)->edges.begin(); edge!=(*ex)->edges.end(); edge++){
-      if(!edge->neutral && edge->to == exon)
-	return true;
-    }
-  }
-  return false;
-}
-
 void Graph::printGraphToShell(){
   cout<<"****************GRAPH******************"<<endl<<endl;;
 for(list<Node*>::iterator node = nodelist.begin(); node != nodelist.end(); node++){
@@ -381,28 +458,27 @@ bool AugustusGraph::exonAtCodingEnd(Node *st){
 }
 
 // generates an identification key
-string AugustusGraph::getKey(Node *n){
+NodeKey AugustusGraph::getKey(Node *n){
 
   if(n->item == NULL)
-    return (itoa(n->begin) +  ":neutral");
+    return NodeKey(n->begin, -1, IR);
   else
-    return (itoa(n->begin) + ":" + itoa(n->end) + ":" + itoa( (int)((State*)n->item)->type )); 
+    return NodeKey(n->begin, n->end, ((State*)n->item)->type); 
 }
 
-string AugustusGraph::getKey(Status *st){
+NodeKey AugustusGraph::getKey(Status *st){
 
-  return (itoa(st->begin) + ":" + itoa(st->end) + ":" + itoa( (int)((State*)st->item)->type )); 
+  return NodeKey(st->begin, st->end, ((State*)st->item)->type); 
 }
 
-string AugustusGraph::getKey(State *st){
+NodeKey AugustusGraph::getKey(State *st){
 
-  return (itoa(st->begin) + ":" + itoa(st->end) + ":" + itoa( (int)(st->type)) ); 
+  return NodeKey(st->begin, st->end, st->type); 
 }
 
-string AugustusGraph::getKey(ExonCandidate* exoncand){
+NodeKey AugustusGraph::getKey(ExonCandidate* exoncand){
   
-  return (itoa(exoncand->begin) + ":" + itoa(exoncand->end) + ":" + itoa( ((ExonCandidate*)exoncand)->getStateType() )); 
-
+  return NodeKey(exoncand->begin, exoncand->end, exoncand->getStateType()); 
 }
 double AugustusGraph::getIntronScore(Status *predExon, Status *nextExon){
 
@@ -501,6 +577,59 @@ bool AugustusGraph::compatible(Node *exon1, Node *exon2){
     return false;
 }
 
+/*
+ * successor classes:
+ * 0-2: coding exons on the forward strand that do not start a CDS, by the frame at their begin
+ * 3-5: the same for the reverse strand
+ * 6-9: internal and last UTR exons (3'UTR+, 3'UTR-, 5'UTR+, 5'UTR-)
+ */
+int AugustusGraph::successorClass(Node *exon){
+
+  State *st = (State*)exon->item;
+  StateType type = st->type;
+  int length = st->end - st->begin + 1;
+
+  if(isCodingExon(type)){
+    if(exonAtCodingStart(exon))
+      return -1;
+    if(isOnFStrand(type))
+      return mod3(st->frame() - length%3);
+    else
+      return 3 + mod3(st->frame() + length%3);
+  }
+  switch(type){
+  case utr3internal: case utr3term:
+    return 6;
+  case rutr3internal: case rutr3init:
+    return 7;
+  case utr5internal: case utr5term:
+    return 8;
+  case rutr5internal: case rutr5init:
+    return 9;
+  default:
+    return -1;
+  }
+}
+
+void AugustusGraph::targetClasses(Node *exon, vector<int> &classes){
+
+  classes.clear();
+  StateType type = ((State*)exon->item)->type;
+
+  if(isCodingExon(type)){
+    if(!exonAtCodingEnd(exon))
+      classes.push_back((isOnFStrand(type)? 0 : 3) + ((State*)exon->item)->frame());
+  }
+  else if(type == utr3init || type == utr3internal)
+    classes.push_back(6);
+  else if(type == rutr3term || type == rutr3internal)
+    classes.push_back(7);
+  else if(type == utr5init || type == utr5internal)
+    classes.push_back(8);
+  else if(type == rutr5term || type == rutr5internal)
+    classes.push_back(9);
+}
+
 bool AugustusGraph::sameStrand(StateType typeA, StateType typeB){
   return(((typeA < rsingleG && typeA >= singleG) && (typeB < rsingleG && typeB >= singleG)) || ((typeA >= rsingleG && typeA < intron_type) && (typeB >= rsingleG && typeB < intron_type)));
 }
@@ -524,7 +653,7 @@ StateType typeB = ((State*)e2->item)->type;
 
 void AugustusGraph::calculateBaseScores(){
 
-  map<string,Status*> exonProcessed;
+  map<NodeKey,Status*> exonProcessed;
   for(list<Status>::iterator st=statelist->begin(); st!=statelist->end(); st++){
     if(exonProcessed[getKey(&(*st))] == 0){
       exonProcessed[getKey(&(*st))] = &(*st);
@@ -778,7 +907,7 @@ void AugustusGraph::printGraph2(string filename){
 
 void AugustusGraph::printGraph(string filename){
 
-  map<string,Node*> inQueue;
+  map<NodeKey,Node*> inQueue;
   queue<Node*> q;
   head->begin = 0;
   head->end = 0;
@@ -930,6 +1059,15 @@ ostream& operator<<(ostream& ostrm, const Edge &edge){
   return ostrm;
 }
 
+ostream& operator<<(ostream& ostrm, const NodeKey &key){
+
+  ostrm << key.begin << ":";
+  if (key.end >= 0)
+    ostrm << key.end << ":";
+  ostrm << key.type;
+  return ostrm;
+}
+
 bool AugustusGraph::mergedStopcodon(Node* exon1, Node* exon2){
 
     StateType type = exon1->castToStateType();
@@ -34,9 +34,12 @@ Integer IGenicModel::gesbasen = 0;
 vector<Integer> IGenicModel::emicount;
 PatMMGroup      IGenicModel::emiprobs("igenic emiprob");
 PatMMGroup*     IGenicModel::GCemiprobs = NULL;
+FloatEmiTable   IGenicModel::emiTable;
+const float*    IGenicModel::curEmiTable = NULL;
 int IGenicModel::lastParIndex = -1;
 vector<vector<Double> > IGenicModel::Pls;
 vector<vector<Double> >* IGenicModel::GCPls = NULL;
+const vector<vector<Double> >* IGenicModel::curPls = NULL;
 int IGenicModel::verbosity;
 double IGenicModel::geoProb = 0.9999;
 
@@ -59,22 +62,41 @@ void IGenicModel::init() {
 
 /*
  * initAlgorithms
- * this is called before running the inference algorithms and whenever the
- * gc content class changes
+ * this is called before running the inference algorithms,
+ * once for each gc content class
  */
 void IGenicModel::initAlgorithms (Matrix<Double>& trans, int cur) {
-  // set these parameters to the one of the GC content index gcIdx
+  geoProb = trans[cur][cur].doubleValue();
+}
+
+/*
+ * useGCPars
+ * this is called whenever the gc content class changes
+ */
+void IGenicModel::useGCPars() {
+  // point to the parameters of the GC content index gcIdx
   if (!Constant::tieIgenicIntron 
       || IntronModel::GCemiprobs == NULL 
       || IntronModel::GCemiprobs[gcIdx].probs.size()==0 // this happens for intronless species
       || IntronModel::k != k) {
-      emiprobs = GCemiprobs[gcIdx];
+      curEmiTable = emiTable.get(gcIdx);
   } else {// use the intron content model
-      emiprobs = IntronModel::GCemiprobs[gcIdx];
+      curEmiTable = IntronModel::emiTable.get(gcIdx);
   }
   
-  Pls = GCPls[gcIdx];
-  geoProb = trans[cur][cur].doubleValue();
+  curPls = &GCPls[gcIdx];
+}
+
+/*
+ * makeEmiTables
+ * single precision copy of the emission probabilities of all GC content classes
+ */
+void IGenicModel::makeEmiTables() {
+    if (!GCemiprobs)
+	return;
+    emiTable.init(Constant::decomp_num_steps, 1, GCemiprobs[0].probs.size());
+    for (int idx = 0; idx < Constant::decomp_num_steps; idx++)
+	emiTable.set(idx, 0, GCemiprobs[idx].probs);
 }
 
 /*
@@ -228,12 +250,13 @@ void IGenicModel::viterbiForwardAndSampling(ViterbiMatrixType& viterbi, // viter
     Double fwdsum(0.0), fwdsummand;  // for forward table
     Double emiProb = emiProbUnderModel(base, base);
     Double transEmiProb;
+    OptionsList samplingOptions;
     OptionsList *optionslist = NULL;
     
     oli.base = base - 1;    
     if (algovar == doSampling)
-	optionslist = new OptionsList();
-    for( it = ancestor.begin() ; it != ancestor.end(); ++it ){
+	optionslist = &samplingOptions;
+    for( it = ancestor->begin() ; it != ancestor->end(); ++it ){
 	transEmiProb = it->val * emiProb;
         curmax  = viterbi[base-1].get(it->pos) * transEmiProb;
 	if (needForwardTable(algovar))
@@ -265,7 +288,6 @@ void IGenicModel::viterbiForwardAndSampling(ViterbiMatrixType& viterbi, // viter
 	    cerr << "Sampling error in model for intergenic region. state=" << state << " base=" << base << endl;
 	    throw e;
 	}
-	delete optionslist;
 	return;
     } else {
 	if (max > 0)
@@ -317,7 +339,7 @@ Double IGenicModel::emiProbUnderModel(int begin, int end) const {
 	if( begin > k ){
 	    try {
 		int pn = s2i(sequence+begin-k);
-		p *= emiprobs.probs[pn];
+		p *= curEmiTable[pn];
 		if (inCRFTraining){
 		  if (Constant::tieIgenicIntron && IntronModel::GCemiprobs != NULL 
 		      && IntronModel::GCemiprobs[gcIdx].probs.size() > 0)
@@ -336,7 +358,8 @@ Double IGenicModel::emiProbUnderModel(int begin, int end) const {
 	    Seq2Int s2it( begin+1 );
 	    try {
 		int basek = s2it(sequence);
-		p *=  Pls[begin][basek]/ (Pls[begin][basek/4]+Pls[begin][basek/4+1]+Pls[begin][basek/4+2]+Pls[begin][basek/4+3]);
+		const vector<Double> &Pl = (*curPls)[begin];
+		p *=  Pl[basek]/ (Pl[basek/4]+Pl[basek/4+1]+Pl[basek/4+2]+Pl[basek/4+3]);
 	    } catch  (InvalidNucleotideError e) {
 		p *= 0.25;
 	    }
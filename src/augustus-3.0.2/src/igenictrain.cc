@@ -17,11 +17,15 @@
 #include "properties.hh"
 #include "merkmal.hh"
 #include "intronmodel.hh" // so splice sites models can be reused here
+#include "commontrain.hh"
 
 // standard C/C++ includes
 #include <fstream>
 #include <sstream>
 
+// registers the intergenic sequences for counting the patterns, see PatternCounter
+static PatternCounter patternCounter;
+
 /*
  * ===[ IGenicModel::buildModel ]=========================================
  */
@@ -99,6 +103,7 @@ void IGenicModel::buildModel( const AnnoSequence* annoseq, int parIndex ){
 	    }
 	    as = as->next;
 	}
+	patternCounter.count();
     } else { // read in the intergenic sequences from a separate training file just with ir sequences
 	string outfile = Constant::fullSpeciesPath() + seqfile;
 	if (verbosity)
@@ -111,6 +116,7 @@ void IGenicModel::buildModel( const AnnoSequence* annoseq, int parIndex ){
 		if (strncmp (buff, ">", 1) != 0) {
 		    cout << "reading in sequence of length " << strlen(buff) << endl;
 		    processSequence(buff + k, buff + strlen(buff)-1);
+		    patternCounter.count(); // buff is overwritten by the next line
 		}
 	    } while( istrm ); 
 	    istrm.clear( ios::failbit );
@@ -164,14 +170,8 @@ void IGenicModel::registerPars (Parameters* parameters){
  * ===[ IGenicModel::processSequence ]====================================
  */
 void IGenicModel::processSequence( const char* start, const char* end ){
-    Seq2Int s2i( k+1 );
-    for( ; start <= end; start++){
-	try {
-	    emicount[ s2i( start-k ) ] += gweight ;
-	    emicount[ s2i.rc( start-k ) ] += gweight ;
-	    gesbasen += 2*gweight;
-	} catch (InvalidNucleotideError e) {}
-    }
+    // counted later by patternCounter.count(), together with the reverse complement
+    patternCounter.add(&emicount, &gesbasen, start, end, k, gweight, 1, 0, true);
 }
 
 /*
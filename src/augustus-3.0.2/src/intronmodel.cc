@@ -55,6 +55,8 @@ Double*         IntronModel::GCmal = NULL;
 Integer         IntronModel::introncount = 0;
 PatMMGroup      IntronModel::emiprobs("intron emiprob");
 PatMMGroup*     IntronModel::GCemiprobs = NULL;
+FloatEmiTable   IntronModel::emiTable;
+const float*    IntronModel::curEmiTable = NULL;
 vector<Double>  IntronModel::lenDist;
 Integer         IntronModel::gesbasen = 0;
 Integer         IntronModel::ass_motif_memory = 3;
@@ -77,9 +79,14 @@ Boolean        IntronModel::hasSpliceSites = false;
 Double         IntronModel::asspseudo = .1;                  // pseudocount for patterns in acceptor splice sites
 Double         IntronModel::dsspseudo = .1;                  // pseudocount for patterns in donor splice sites 
 Double         IntronModel::dssneighborfactor = 0.01; 
-SnippetProbs*  IntronModel::snippetProbs;
-SnippetProbs*  IntronModel::rSnippetProbs;
-bool           IntronModel::initAlgorithmsCalled = false;
+SnippetProbs*  IntronModel::snippetProbs = NULL;
+SnippetProbs*  IntronModel::rSnippetProbs = NULL;
+SnippetProbs** IntronModel::GCsnippetProbs = NULL;
+SnippetProbs** IntronModel::GCrSnippetProbs = NULL;
+MotifTrack*    IntronModel::assTrack = NULL;
+MotifTrack*    IntronModel::dssTrack = NULL;
+MotifTrack**   IntronModel::GCassTracks = NULL;
+bool           IntronModel::haveGCPars = false;
 bool           IntronModel::haveSnippetProbs = false;
 int            IntronModel::lastParIndex = -1;
 Integer        IntronModel::verbosity;
@@ -102,10 +109,7 @@ IntronModel::~IntronModel( ){
       //delete assMotif;
       if (GCassMotif)
 	delete [] GCassMotif;
-      if (snippetProbs)
-	delete snippetProbs;
-      if (rSnippetProbs)
-	delete rSnippetProbs;
+      initSnippetProbs(); // deletes the snippet probs of all GC content classes
       assMotif = GCassMotif = NULL;
       snippetProbs = rSnippetProbs = NULL;
     }
@@ -176,6 +180,17 @@ void IntronModel::init() {
       GCassMotif = new Motif[Constant::decomp_num_steps];
     if (!GCemiprobs)
       GCemiprobs = new PatMMGroup[Constant::decomp_num_steps];
+    if (!GCsnippetProbs) {
+      GCsnippetProbs = new SnippetProbs*[Constant::decomp_num_steps];
+      GCrSnippetProbs = new SnippetProbs*[Constant::decomp_num_steps];
+      for (int idx = 0; idx < Constant::decomp_num_steps; idx++)
+	GCsnippetProbs[idx] = GCrSnippetProbs[idx] = NULL;
+    }
+    if (!GCassTracks) {
+      GCassTracks = new MotifTrack*[Constant::decomp_num_steps];
+      for (int idx = 0; idx < Constant::decomp_num_steps; idx++)
+	GCassTracks[idx] = NULL;
+    }
 }
 
 
@@ -426,34 +441,50 @@ void IntronModel::readAllParameters(){
 	throw ProjectError("IntronModel::readAllParameters: Couldn't open file " + filename);
 }
 
+/*
+ * IntronModel::makeEmiTables
+ * single precision copy of the emission probabilities of all GC content classes
+ */
+void IntronModel::makeEmiTables(){
+    if (!GCemiprobs)
+	return;
+    emiTable.init(Constant::decomp_num_steps, 1, GCemiprobs[0].probs.size());
+    for (int idx = 0; idx < Constant::decomp_num_steps; idx++)
+	emiTable.set(idx, 0, GCemiprobs[idx].probs);
+}
+
 /*
  * IntronModel::initSnippetProbs
+ * Forget the stored snippet and splice site probabilities of all GC content classes.
+ * They are computed again on demand for the current sequence (see useGCPars).
  */
 void IntronModel::initSnippetProbs() {
-    if (snippetProbs)
-	delete snippetProbs;
-    snippetProbs = new SnippetProbs(sequence, k);
-    if (rSnippetProbs)
-	delete rSnippetProbs;
-    rSnippetProbs = new SnippetProbs(sequence, k, false);
+    if (GCsnippetProbs) {
+	for (int idx = 0; idx < Constant::decomp_num_steps; idx++) {
+	    delete GCsnippetProbs[idx];
+	    delete GCrSnippetProbs[idx];
+	    GCsnippetProbs[idx] = GCrSnippetProbs[idx] = NULL;
+	}
+    }
+    if (GCassTracks) {
+	for (int idx = 0; idx < Constant::decomp_num_steps; idx++) {
+	    delete GCassTracks[idx];
+	    GCassTracks[idx] = NULL;
+	}
+    }
+    delete dssTrack;
+    snippetProbs = rSnippetProbs = NULL;
+    assTrack = dssTrack = NULL;
     haveSnippetProbs = true;
 }
 
 /*
  * IntronModel::initAlgorithms
  *
- * makes a correction on the transition matrix "trans" and on the vector of ancestors
+ * makes a correction on the transition matrix "trans" for the current GC content class
+ * this is called once per GC content class and sequence, after useGCPars
  */
 void IntronModel::initAlgorithms( Matrix<Double>& trans, int cur){
-    if (!initAlgorithmsCalled) {
-	seqProb(-1,0);
-	// set these parameters to the one of the GC content index
-	emiprobs = GCemiprobs[gcIdx];
-	assMotif = &GCassMotif[gcIdx];
-	probShortIntron = GCprobShortIntron[gcIdx];
-	mal = GCmal[gcIdx];
-    }
-
     /*
      * correction of the transition probabilities into lessDx and equalx (x=0,1,2)
      * which are considered parameters of the intron model
@@ -479,10 +510,8 @@ void IntronModel::initAlgorithms( Matrix<Double>& trans, int cur){
      */
     if (itype == geometric0 || itype == geometric1 || itype == geometric2 || 
 	itype == rgeometric0 || itype == rgeometric1 || itype == rgeometric2) {
-        if (mal > 0.0){
+        if (mal > 0.0)
 	    trans[cur][cur] = 1 - 1 / mal;
-  	    geoProb = trans[cur][cur].doubleValue();
-	}
 	// normalize the rest of the line
 	Double sum = 0.0;
 	for (int i = 0; i < trans.getRowSize(); i++) {
@@ -496,12 +525,43 @@ void IntronModel::initAlgorithms( Matrix<Double>& trans, int cur){
 	    }
 	}
     }
-    snippetProbs->setEmiProbs(&emiprobs.probs);
-    rSnippetProbs->setEmiProbs(&emiprobs.probs);
-    aSSProb(-1, false); // initialize ass probs
+}
 
-    initAlgorithmsCalled = true;
-    haveSnippetProbs = false;
+/*
+ * IntronModel::useGCPars
+ *
+ * switch to the parameters of the GC content index gcIdx, this is called whenever the
+ * GC content class changes. Only pointers and scalars are set. The snippet probabilities
+ * are kept separately for each GC content class of the current sequence.
+ */
+void IntronModel::useGCPars(){
+    if (!haveGCPars) {
+	seqProb(-1,0);
+	// set these parameters to the one of the GC content index
+	curEmiTable = emiTable.get(gcIdx);
+	assMotif = &GCassMotif[gcIdx];
+	probShortIntron = GCprobShortIntron[gcIdx];
+	mal = GCmal[gcIdx];
+	if (mal > 0.0)
+	    geoProb = Double(1 - 1 / mal).doubleValue();
+	if (!GCsnippetProbs[gcIdx]) {
+	    GCsnippetProbs[gcIdx] = new SnippetProbs(sequence, k);
+	    GCsnippetProbs[gcIdx]->setEmiProbs(&GCemiprobs[gcIdx].probs);
+	    GCrSnippetProbs[gcIdx] = new SnippetProbs(sequence, k, false);
+	    GCrSnippetProbs[gcIdx]->setEmiProbs(&GCemiprobs[gcIdx].probs);
+	}
+	snippetProbs = GCsnippetProbs[gcIdx];
+	rSnippetProbs = GCrSnippetProbs[gcIdx];
+	// splice site probabilities of all positions, not during CRF training, which counts the features
+	if (!inCRFTraining) {
+	    if (!GCassTracks[gcIdx])
+		GCassTracks[gcIdx] = new MotifTrack(computeASSProb, sequence, dnalen);
+	    if (!dssTrack)
+		dssTrack = new MotifTrack(computeDSSProb, sequence, dnalen);
+	}
+	assTrack = GCassTracks[gcIdx];
+    }
+    haveGCPars = true;
 }
 
 
@@ -536,9 +596,10 @@ void IntronModel::viterbiForwardAndSampling(ViterbiMatrixType& viterbi,
 	if (algovar == doBacktracking)
 	    getStatePair(state, state, substate);
     }
+    OptionsList samplingOptions;
     OptionsList *optionslist = NULL;
     if (algovar == doSampling)
-	optionslist = new OptionsList();
+	optionslist = &samplingOptions;
 
     if (itype == lessD0 || itype == lessD1 || itype == lessD2 ||
 	itype == rlessD0 || itype == rlessD1 || itype == rlessD2) {
@@ -568,17 +629,27 @@ void IntronModel::viterbiForwardAndSampling(ViterbiMatrixType& viterbi,
 	int leftMostEndOfPred = base - dStateLen;
 	if (leftMostEndOfPred < 0)
 	    leftMostEndOfPred = 0;
+	// beam pruning is done in the Viterbi variants only and not with substates
+	bool pruning = beamActive && !checkSubstates && algovar != doSampling && !needForwardTable(algovar);
+	Double beamCutoff = 0.0;
 	   
 	for (endOfPred = base-1; endOfPred >= leftMostEndOfPred; endOfPred--){
 	    ViterbiColumnType& predVit = algovar == doSampling ? forward[endOfPred] : viterbi[endOfPred];
 	    // compute the maximum over the predecessor states probs times transition probability
 	    /*
 	     * check whether the starting position has a positive entry at all
+	     * (with beam pruning: an entry within the beam)
 	     */
-	    for(it = ancestor.begin(); 
-		it != ancestor.end() && !predVit.has(it->pos);
-		++it);
-	    if (it == ancestor.end()) 
+	    if (pruning) {
+		beamCutoff = colBest[endOfPred] * beamFactor;
+		for(it = ancestor->begin(); 
+		    it != ancestor->end() && (!predVit.has(it->pos) || predVit.get(it->pos) < beamCutoff);
+		    ++it);
+	    } else
+		for(it = ancestor->begin(); 
+		    it != ancestor->end() && !predVit.has(it->pos);
+		    ++it);
+	    if (it == ancestor->end()) 
 		continue;
 	    emiProb = emiProbUnderModel(endOfPred+1, base);
 	    // every intron gets a malus, the short introns here, the long introns in the emission of the equalD state
@@ -586,7 +657,7 @@ void IntronModel::viterbiForwardAndSampling(ViterbiMatrixType& viterbi,
 	    if (seqFeatColl)
 		extrinsicQuot = seqFeatColl->collection->malus(intronF);
 	    do {
-		if (!predVit.has(it->pos)) continue;
+		if (!predVit.has(it->pos) || (pruning && predVit.get(it->pos) < beamCutoff)) continue;
 		transEmiProb = it->val * emiProb * extrinsicQuot;
 		predProb = predVit.get(it->pos, substate) * transEmiProb;
 		if (needForwardTable(algovar)) {
@@ -608,7 +679,7 @@ void IntronModel::viterbiForwardAndSampling(ViterbiMatrixType& viterbi,
 		    oli.state = it->pos;
 		    oli.base = endOfPred;
 		}
-	    } while (++it != ancestor.end());
+	    } while (++it != ancestor->end());
 	}
 
 	/*
@@ -635,7 +706,7 @@ void IntronModel::viterbiForwardAndSampling(ViterbiMatrixType& viterbi,
 			extrinsicQuot = ihint->bonus;
 		    //cout << "IntronModel extrQ=" << extrinsicQuot << " " << ihint->start << ".." << ihint->end << endl;
 		    emiProb *= extrinsicQuot; // option gets a bonus because it complies with the intron hint
-		    for( it = ancestor.begin(); it != ancestor.end(); ++it ){
+		    for( it = ancestor->begin(); it != ancestor->end(); ++it ){
 			transEmiProb = it->val * emiProb;
 			predProb = predVit.get(it->pos, substate) * transEmiProb;
 			if (needForwardTable(algovar)) {
@@ -714,14 +785,14 @@ void IntronModel::viterbiForwardAndSampling(ViterbiMatrixType& viterbi,
 	 */
 	ViterbiColumnType& predVar = algovar==doSampling? 
 	    forward[endOfPred] : viterbi[endOfPred];
-	for(it = ancestor.begin(); 
-	    it != ancestor.end() && !predVar.has(it->pos);
+	for(it = ancestor->begin(); 
+	    it != ancestor->end() && !predVar.has(it->pos);
 	    ++it);
 
 	/*
 	 * return immediately if no valid ancestor exists
 	 */
-	if (it == ancestor.end()) {
+	if (it == ancestor->end()) {
 // 	    viterbi[base].erase(state);
 // 	    if (needForwardTable(algovar)) 
 // 		forward[base].erase(state);
@@ -766,7 +837,7 @@ void IntronModel::viterbiForwardAndSampling(ViterbiMatrixType& viterbi,
 		maxPredProb = predProb;
 		oli.state = it->pos;
 	    }
-	} while (++it != ancestor.end());
+	} while (++it != ancestor->end());
 
 	if (checkSubstates && !substates.empty() && (isLongAssIntron(itype) || isRLongDssIntron(itype))) {
 	    if (substates.is_linked())
@@ -832,7 +903,6 @@ void IntronModel::viterbiForwardAndSampling(ViterbiMatrixType& viterbi,
 		cerr << "Sampling error in intron model. state=" << state << " base=" << base << endl;
 		throw e;
 	    }
-	    delete optionslist;
 	    return;
 	case doBacktracking:
 	    oli.state = getFullStateId(oli.state, substate);
@@ -843,13 +913,9 @@ void IntronModel::viterbiForwardAndSampling(ViterbiMatrixType& viterbi,
 
 Double IntronModel::emiProbUnderModel (int begin, int end) const {
     Seq2Int s2i(k+1);
-    static Double returnProb, extrinsicQuot;
-    returnProb = extrinsicQuot = 1.0;
-    if (inCRFTraining){
+    Double returnProb = 1.0, extrinsicQuot = 1.0;
+    if (inCRFTraining)
 	seqProb(-1, -1); // forget all saved information in static variables
-	if (itype == longass0 || itype == longass1 || itype == longass2 || itype == rlongass0 || itype == rlongass1 || itype == rlongass2)
-	    aSSProb(-1, false);
-    }
     // intron range for extrinsic bonus: intronic positions with (begin,end) boundaries
     int intronBegin=begin, intronEnd=end;
     switch( itype ){
@@ -883,7 +949,7 @@ Double IntronModel::emiProbUnderModel (int begin, int end) const {
 		if (begin >= k) {
 		    try {
 			int pn = s2i(sequence + begin - k);
-			returnProb *= emiprobs.probs[pn];
+			returnProb *= curEmiTable[pn];
 			if (inCRFTraining && (countEnd < 0 || (begin >= countStart && begin <= countEnd)))
 			    GCemiprobs[gcIdx].addCount(pn);
 		    } catch (InvalidNucleotideError e) {
@@ -1022,7 +1088,7 @@ Double IntronModel::seqProb(int left, int right) const {
 	if (right == oldright && left <= oldleft &&  right-left < seqProbs.size()) {  
 	    for (curpos = oldleft-1; curpos >= left; curpos--){
 		try {
-		    seqProb *= emiprobs.probs[s2i(sequence + curpos - k)];
+		    seqProb *= curEmiTable[s2i(sequence + curpos - k)];
 		} catch (InvalidNucleotideError e) {
 		    seqProb *= 0.25;
 		}
@@ -1044,7 +1110,7 @@ Double IntronModel::seqProb(int left, int right) const {
 	try {
 	    if (curpos - k >= 0){
 		int pn = s2i(sequence + curpos - k);
-		seqProb *= emiprobs.probs[pn];
+		seqProb *= curEmiTable[pn];
 		if (inCRFTraining && (countEnd < 0 || (curpos >= countStart && curpos <= countEnd)))
 		    GCemiprobs[gcIdx].addCount(pn);
 	    } else
@@ -1064,51 +1130,42 @@ Double IntronModel::seqProb(int left, int right) const {
  * base is the first position of the motif window (forward case)
  * intron ...mmmmmmmmmmmmmmmmmmmmm **AG|*** ... exon
  *            motif window         pattern
- * frequencies of (a,c,g,t) in the 30 positions before ass: (0.27, 0.211, 0.107, 0.412)
+ * Looked up in the splice site track of the current sequence if there is one.
  */
 Double IntronModel::aSSProb(int base, bool forwardStrand){
-    static char *astr = new char[Constant::ass_size()+1]; // forget the delete
-    static Seq2Int s2i(Constant::ass_size());
-    static Double patternProb(1.0), motifProb(1.0), emiProb(1.0);
-    static int oldPos=-1;
-    static bool oldFstrand=false;
+    if (assTrack && !inCRFTraining && assTrack->covers(sequence, dnalen, base))
+	return assTrack->get(base, forwardStrand);
+    return computeASSProb(base, forwardStrand);
+}
 
-    if (base < 0) {
-        // reset static values
-	// otherwise it may reuse values from the previous sequence
-	oldPos = -1;
-	emiProb= 0.0;
+/*
+ * frequencies of (a,c,g,t) in the 30 positions before ass: (0.27, 0.211, 0.107, 0.412)
+ */
+Double IntronModel::computeASSProb(int base, bool forwardStrand){
+    if (base < 0)
 	return 0.0;
-    }
-
-    if (oldPos == base && forwardStrand == oldFstrand)
-    	return emiProb;
 
-    oldFstrand = forwardStrand;
+    vector<char> astr(Constant::ass_size()+1);
+    Seq2Int s2i(Constant::ass_size());
+    Double patternProb, motifProb;
     bool nonAG;
-    if (oldFstrand) {
+    if (forwardStrand) {
 	int asspos = base + ass_upwindow_size + Constant::ass_start;
-	if (!isPossibleASS(asspos +1)) {
-	    emiProb = 0.0;
-	    oldPos = base;
-	    return emiProb;
-	}
+	if (!isPossibleASS(asspos +1))
+	    return 0.0;
 	nonAG = !onASS(sequence + asspos);
-	strncpy(astr, sequence + base + ass_upwindow_size, Constant::ass_start);
-	strncpy(astr + Constant::ass_start, sequence + asspos + ASS_MIDDLE, Constant::ass_end);
+	strncpy(&astr[0], sequence + base + ass_upwindow_size, Constant::ass_start);
+	strncpy(&astr[0] + Constant::ass_start, sequence + asspos + ASS_MIDDLE, Constant::ass_end);
 	// determine motifProb, the probability of the motif
 	motifProb = (base >= assMotif->k)  ? 
 	    assMotif->seqProb(sequence + base) : 0.0;
     } else {
 	int asspos = base + Constant::ass_end;
-	if (!isPossibleRASS(asspos)) {
-	    oldPos = base;
-	    emiProb = 0.0;
-	    return emiProb;
-	}
+	if (!isPossibleRASS(asspos))
+	    return 0.0;
 	nonAG = !onRASS(sequence + asspos);
-	putReverseComplement(astr, sequence + asspos + ASS_MIDDLE, Constant::ass_start);
-	putReverseComplement(astr + Constant::ass_start, sequence + base, Constant::ass_end);
+	putReverseComplement(&astr[0], sequence + asspos + ASS_MIDDLE, Constant::ass_start);
+	putReverseComplement(&astr[0] + Constant::ass_start, sequence + base, Constant::ass_end);
 	int motifstart =  base + Constant::ass_whole_size();
 	int motifend =  motifstart + ass_upwindow_size;
 	motifProb = motifend + assMotif->k < dnalen ? 
@@ -1117,7 +1174,7 @@ Double IntronModel::aSSProb(int base, bool forwardStrand){
     }
     astr[Constant::ass_size()] = '\0';
     try {
-	Double assprob = assprobs[ s2i(astr) ];
+	Double assprob = assprobs[ s2i(&astr[0]) ];
 	if (nonAG) assprob *= non_ag_ass_prob;
         if (assBinProbs.nbins < 1) {
             patternProb = assprob; // standard HMM probabilities
@@ -1128,48 +1185,49 @@ Double IntronModel::aSSProb(int base, bool forwardStrand){
 	    patternProb = assBinProbs.avprobs[idx];
 	}
     } catch (InvalidNucleotideError e) {
-      // cerr << "got invalid nucleotide when checking for aSS: " << astr << endl;
-      //oldPos = base;
       // TODO: use the available unmasked bases
       patternProb = 0.001 * pow(.25, (int) Constant::ass_size());
-      //was: emiProb = 0.0; don't predict splice site when there is an unknown nucleotide
-      //return emiProb;
+      //was: return 0.0; don't predict splice site when there is an unknown nucleotide
     }
-
-    emiProb = motifProb * patternProb;
-    oldPos = base;
-    return emiProb;
+    return motifProb * patternProb;
 }
 
 
 /*
  * base is the first position of the pattern
  * exon ...  ***|GT**** ...intron
+ * Looked up in the splice site track of the current sequence if there is one.
  */
 Double IntronModel::dSSProb(int base, bool forwardStrand){
-    static char *astr = new char[Constant::dss_size()+1]; // forget the delete
-    static Seq2Int s2i(Constant::dss_size());
+    if (dssTrack && !inCRFTraining && dssTrack->covers(sequence, dnalen, base))
+	return dssTrack->get(base, forwardStrand);
+    return computeDSSProb(base, forwardStrand);
+}
+
+Double IntronModel::computeDSSProb(int base, bool forwardStrand){
     if (base < 0)
 	return 0.0;
+    vector<char> astr(Constant::dss_size()+1);
+    Seq2Int s2i(Constant::dss_size());
     bool nonGT;
     if (forwardStrand) { // forward strand
 	int dsspos = base + Constant::dss_start;
 	if (!isPossibleDSS(dsspos))
 	    return 0.0;
 	nonGT = !onDSS(sequence + dsspos);
-	strncpy(astr, sequence + base, Constant::dss_start);
-	strncpy(astr + Constant::dss_start, sequence + dsspos + DSS_MIDDLE, Constant::dss_end);
+	strncpy(&astr[0], sequence + base, Constant::dss_start);
+	strncpy(&astr[0] + Constant::dss_start, sequence + dsspos + DSS_MIDDLE, Constant::dss_end);
     } else { // reverse complement
 	int dsspos = base + Constant::dss_end;
 	if (!isPossibleRDSS(dsspos + 1))
 	    return 0.0;
 	nonGT = !onRDSS(sequence + dsspos);
-	putReverseComplement(astr, sequence + dsspos + DSS_MIDDLE, Constant::dss_start);
-	putReverseComplement(astr + Constant::dss_start, sequence + base, Constant::dss_end);
+	putReverseComplement(&astr[0], sequence + dsspos + DSS_MIDDLE, Constant::dss_start);
+	putReverseComplement(&astr[0] + Constant::dss_start, sequence + base, Constant::dss_end);
     }
     astr[Constant::dss_size()] = '\0';
     try {
-	Double dssprob = dssprobs[ s2i(astr) ];
+	Double dssprob = dssprobs[ s2i(&astr[0]) ];
 	if (nonGT) dssprob *= non_gt_dss_prob;
 	if (dssBinProbs.nbins < 1)
 	    return dssprob; // standard HMM probabilities
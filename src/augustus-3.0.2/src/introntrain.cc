@@ -25,6 +25,9 @@
 #include <climits>
 #include <sstream>
 
+// registers the intron and intergenic sequences for counting the patterns, see PatternCounter
+static PatternCounter patternCounter;
+
 /*
  * IntronModel::buildModel
  */
@@ -160,15 +163,8 @@ void IntronModel::printLengthQuantiles(){
  * IntronModel::processSequence
  */
 void IntronModel::processSequence( const char* start, const char* end){
-    Seq2Int s2i(k+1);
-    for( ; start <= end; start++){
-	try {
-	    emicount[s2i(start-k)] += gweight ;
-	    emicount[s2i.rc(start-k) ] += gweight ;
-	    gesbasen += 2*gweight;
-	} catch (InvalidNucleotideError e) {
-	}  
-    }
+    // counted later by patternCounter.count(), together with the reverse complement
+    patternCounter.add(&emicount, &gesbasen, start, end, k, gweight, 1, 0, true);
 }
 
 
@@ -380,6 +376,7 @@ void IntronModel::buildProbabilities(const AnnoSequence* annoseq){
       }
       as = as->next;
     }
+    patternCounter.count();
     
     /*
      * determine emission probabilities
@@ -120,11 +120,14 @@ void buildStatusList(list<Gene> *alltranscripts, bool utr, list<Status> &stlist)
       }
       // orders list after genes and startpositions of states
       stateList.sort(compareStatus);
+      // link each state to its successor; the last state of the gene has no successor
       list<Status>::iterator st = stateList.begin();
       while(st != stateList.end()){
-	st->next = &(*(++st));
+	list<Status>::iterator succ = st;
+	succ++;
+	st->next = (succ != stateList.end())? &(*succ) : NULL;
+	st = succ;
       }
-      stateList.back().next = NULL;
    
       stlist.splice(stlist.end(),stateList);   
     }
@@ -176,11 +179,11 @@ bool compareStatus(Status first, Status second){
  * transfer nodelist of the graph representation to gene list for the AUGUSTUS output
  */
 
-void getMeaGenelist(list<Node*> meaPath, list<Gene> *meaGenes){
+void getMeaGenelist(const list<Node*> &meaPath, list<Gene> *meaGenes){
     
   Gene *currentGene = new Gene();
 
-  for(list<Node*>::reverse_iterator node=meaPath.rbegin(); node!=meaPath.rend(); node++){
+  for(list<Node*>::const_reverse_iterator node=meaPath.rbegin(); node!=meaPath.rend(); node++){
     if((*node)->item != NULL){
       State *ex = new State(*((State*)(*node)->item));
       addExonToGene(currentGene, ex);
@@ -7,61 +7,82 @@ using namespace std;
 
 void MEApath::findMEApath(){
 
+  graph->buildCSR();
   getTopologicalOrdering();
   graph->addBackEdges();
+  graph->buildCSR(); // include the back edges
   relax();   
   
   //backtracking
   backtracking();
   
   //for graphviz dot to draw path
+  vector<bool> inPath(graph->nodes.size(), false);
+  for(list<Node*>::iterator pathNode=meaPath.begin(); pathNode!=meaPath.end(); pathNode++)
+    inPath[(*pathNode)->id] = true;
   for(list<Node*>::iterator node=graph->nodelist.begin(); node!=graph->nodelist.end(); node++){
-    bool nodeInPath = false;
-    bool predInPath = false;
-    for(list<Node*>::iterator pathNode=meaPath.begin(); pathNode!=meaPath.end(); pathNode++){
-      if((*node)->pred == *pathNode)
-	predInPath = true;
-      if(*node == *pathNode)
-	nodeInPath = true;
-      if(predInPath && nodeInPath)
-	goto nextNode;
-    }
-    (*node)->pred = NULL;
-    nextNode:;
-    }
+    if(!inPath[(*node)->id] || (*node)->pred == NULL || !inPath[(*node)->pred->id])
+      (*node)->pred = NULL;
+  }
   //  graph->printGraph("/fs1.data/lizzy/species/tribolium/param_training/train_log/tmp_opt_triboliumMEA/MEA_graph.dot");
 }
 
 /*
- * deapth first search
+ * deapth first search, iterative with an explicit stack of (node, next edge) to avoid deep recursion;
+ * nodes are appended to topSort in the same order as in the recursive formulation
  */
 
-void MEApath::dfs(Node *n){
-
-  processed[graph->getKey(n)] = n;
-  for(list<Edge>::iterator edge=n->edges.begin(); edge!=n->edges.end(); edge++){
-    if(processed[graph->getKey(edge->to)]==0)
-      dfs(edge->to);
+void MEApath::dfs(int start){
+
+  const vector<int> &offset = graph->edgeOffset;
+  const vector<int> &to = graph->edgeTo;
+  vector<int> stack, nextEdge;
+
+  processed[start] = true;
+  stack.push_back(start);
+  nextEdge.push_back(offset[start]);
+  while(!stack.empty()){
+    int n = stack.back();
+    int e = nextEdge.back();
+    while(e < offset[n+1] && processed[to[e]])
+      e++;
+    if(e < offset[n+1]){
+      nextEdge.back() = e+1;
+      processed[to[e]] = true;
+      stack.push_back(to[e]);
+      nextEdge.push_back(offset[to[e]]);
+    } else {
+      topSort.push_back(n);
+      stack.pop_back();
+      nextEdge.pop_back();
+    }
   }
-  topSort.push_back(n);
 }
 
 void MEApath::relax(){
 
-  for(list<Node*>::iterator it=graph->nodelist.begin(); it!=graph->nodelist.end(); it++)
-    (*it)->score = - numeric_limits<double>::max(); // set to minimum score
-
-  graph->head->score = 0;  
+  int n = graph->nodes.size();
+  const vector<int> &offset = graph->edgeOffset;
+  const vector<int> &to = graph->edgeTo;
+  const vector<double> &edgeScore = graph->edgeScore;
+  vector<double> score(n, - numeric_limits<double>::max()); // set to minimum score
+  vector<int> pred(n, -1);
+  for(int i=0; i<n; i++)
+    if(graph->nodes[i]->pred != NULL)
+      pred[i] = graph->nodes[i]->pred->id;
+
+  score[graph->head->id] = 0;  
   bool continueRelax = true;
 
   while(continueRelax){
     bool nothingChanged = true;
     for(int i = topSort.size()-1; i >= 0; i--){
-      for(list<Edge>::iterator edge=topSort[i]->edges.begin(); edge!=topSort[i]->edges.end(); edge++){	 
-	if(topSort[i]->score + edge->score > edge->to->score){
+      int from = topSort[i];
+      for(int e = offset[from]; e < offset[from+1]; e++){	 
+	if(score[from] + edgeScore[e] > score[to[e]]){
 	  // update exon distance
-	  edge->to->score = topSort[i]->score + edge->score;
-	  edge->to->pred = topSort[i];
+	  score[to[e]] = score[from] + edgeScore[e];
+	  pred[to[e]] = from;
 	  nothingChanged = false;
 	}
       }    
@@ -76,18 +97,27 @@ void MEApath::relax(){
       continueRelax = false;
   }
 
-  for(list<Node*>::iterator node = graph->nodelist.begin(); node!=graph->nodelist.end(); node++){   
-    for(list<Edge>::iterator edge = (*node)->edges.begin(); edge != (*node)->edges.end(); edge++)
-      if(edge->to->score < (*node)->score + edge->score)
-	cerr<<"MEA (relax): wrong distance "<<edge->to->score<<" at: "<<edge->to->begin<<":"<<edge->to->end<<endl;
+  for(int i=0; i<n; i++){
+    graph->nodes[i]->score = score[i];
+    graph->nodes[i]->pred = (pred[i] >= 0)? graph->nodes[pred[i]] : NULL;
+  }
+
+  for(int i=0; i<n; i++){   
+    for(int e = offset[i]; e < offset[i+1]; e++)
+      if(score[to[e]] < score[i] + edgeScore[e])
+	cerr<<"MEA (relax): wrong distance "<<score[to[e]]<<" at: "<<graph->nodes[to[e]]->begin<<":"<<graph->nodes[to[e]]->end<<endl;
   }
 }
 
 void MEApath::getTopologicalOrdering(){
 
-  for(list<Node*>::iterator node=graph->nodelist.begin(); node!=graph->nodelist.end(); node++){   
-    if(processed[graph->getKey(*node)]==0)
-      dfs(*node);
+  int n = graph->nodes.size();
+  processed.assign(n, false);
+  topSort.clear();
+  topSort.reserve(n);
+  for(int i=0; i<n; i++){   
+    if(!processed[i])
+      dfs(i);
   }
 }
 
@@ -0,0 +1,111 @@
+/**********************************************************************
+ * benchmark of the MEA graph construction on a synthetic locus
+ * file:    meagraphbench.cc
+ * licence: Artistic Licence, see file LICENCE.TXT or
+ *          http://www.opensource.org/licenses/artistic-license.php
+ *
+ * usage:   meagraphbench [number of transcripts [number of splice site variants]]
+ *
+ * Builds a dense alternative splicing locus: overlapping genes on both strands
+ * that use random subsets of 40 exon slots, each exon boundary chosen from a few
+ * nearby splice sites. Then the AugustusGraph is built and the MEA path is searched,
+ * as in getMEAtranscripts(). Prints the size of the graph and the running times.
+ **********************************************************************/
+
+#include "graph.hh"
+#include "mea.hh"
+#include "meaPath.hh"
+
+#include <iostream>
+#include <cstdlib>
+#include <ctime>
+
+int main(int argc, char* argv[]) {
+    int numTranscripts = (argc > 1)? atoi(argv[1]) : 500;
+    int variants = (argc > 2)? atoi(argv[2]) : 6;
+    const int slots = 40, slotLen = 150, intronLen = 900;
+    const char *nucleotides = "acgt";
+
+    srand(17);
+    int seqlen = 2 * slots * (slotLen + intronLen) + 2000;
+    string dna(seqlen, 'a');
+    for (int i=0; i<seqlen; i++)
+	dna[i] = nucleotides[rand() % 4];
+
+    list<Status> stlist;
+    list<State> states; // own the items of the Status objects
+    for (int t=0; t<numTranscripts; t++) {
+	bool forward = (t % 2 == 0);
+	int offset = forward? 1000 : 1000 + slots * (slotLen + intronLen) / 2;
+	vector<int> begins, ends;
+	for (int s=0; s<slots; s++) {
+	    if (rand() % 10 < 3)
+		continue;
+	    int b = offset + s * (slotLen + intronLen) + rand() % variants;
+	    begins.push_back(b);
+	    ends.push_back(b + slotLen + rand() % variants);
+	}
+	int n = begins.size();
+	if (n < 2)
+	    continue;
+
+	// exon types with consistent reading frames
+	vector<StateType> types(n);
+	if (forward) {
+	    int frame = 0;
+	    for (int i=0; i<n; i++) {
+		if (i == n-1) {
+		    while ((frame + ends[i] - begins[i] + 1) % 3)
+			ends[i]++;
+		    types[i] = terminal;
+		} else {
+		    frame = (frame + ends[i] - begins[i] + 1) % 3;
+		    types[i] = (StateType) (((i == 0)? initial0 : internal0) + frame);
+		}
+	    }
+	} else {
+	    int frame = 2;
+	    for (int i=n-1; i>=0; i--) {
+		if (i == n-1)
+		    types[i] = rinitial;
+		else
+		    types[i] = (StateType) (((i == 0)? rterminal0 : rinternal0) + frame);
+		frame = (frame + ends[i] - begins[i] + 1) % 3;
+	    }
+	}
+
+	list<Status> gene;
+	for (int i=0; i<n; i++) {
+	    states.push_back(State(begins[i], ends[i], types[i]));
+	    gene.push_back(Status(CDS, begins[i], ends[i], 0.1 + 0.9 * rand() / RAND_MAX, &states.back()));
+	    if (i < n-1) {
+		states.push_back(State(ends[i] + 1, begins[i+1] - 1, forward? lessD0 : rlessD0));
+		gene.push_back(Status(intron, ends[i] + 1, begins[i+1] - 1, 0.1 + 0.9 * rand() / RAND_MAX, &states.back()));
+	    }
+	}
+	for (list<Status>::iterator st = gene.begin(); st != gene.end(); st++) {
+	    list<Status>::iterator succ = st;
+	    succ++;
+	    st->next = (succ != gene.end())? &(*succ) : NULL;
+	}
+	stlist.splice(stlist.end(), gene);
+    }
+
+    clock_t anfang, mitte, ende;
+    anfang = clock();
+    AugustusGraph graph(&stlist, dna.c_str());
+    graph.buildGraph();
+    mitte = clock();
+    MEApath path(&graph);
+    path.findMEApath();
+    ende = clock();
+
+    int numEdges = 0;
+    for (list<Node*>::iterator node = graph.nodelist.begin(); node != graph.nodelist.end(); node++)
+	numEdges += (*node)->edges.size();
+    cout << "transcripts " << numTranscripts << " states " << stlist.size() << " nodes " << graph.nodelist.size()
+	 << " edges " << numEdges << " path length " << path.getPath().size() << endl;
+    cout << "buildGraph time " << (double) (mitte - anfang) / CLOCKS_PER_SEC << "s" << endl;
+    cout << "findMEApath time " << (double) (ende - mitte) / CLOCKS_PER_SEC << "s" << endl;
+    return 0;
+}
@@ -21,9 +21,11 @@
 #include "gene.hh"
 #include "statemodel.hh"
 #include "utrmodel.hh"
+#include "parallel.hh"
 
 // standard C/C++ includes
 #include <fstream>
+#include <iomanip>
 
 
 vector<AnnoSequence*> CRF::evalAnnoSeqs;
@@ -310,6 +312,7 @@ void CRF::train(Parameters* startPars, vector<AnnoSequence*> trainGenes, Feature
      * TODO
      */
     evalExtrinsicFeatures = new FeatureCollection();
+    StateModel::makeEmiTables(); // the parameters may just have been trained and not read from file
 
 
     /*
@@ -331,6 +334,223 @@ void CRF::train(Parameters* startPars, vector<AnnoSequence*> trainGenes, Feature
     }
 }
 
+/*
+ * feature count vectors are passed from the worker processes in binary
+ */
+static void writeCounts(ostream &out, const vector<int> &counts){
+    size_t n = counts.size();
+    out.write((const char*) &n, sizeof(n));
+    if (n > 0)
+	out.write((const char*) &counts[0], n * sizeof(int));
+}
+
+static void readCounts(istream &in, vector<int> &counts){
+    size_t n = 0;
+    in.read((char*) &n, sizeof(n));
+    counts.resize(n);
+    if (n > 0)
+	in.read((char*) &counts[0], n * sizeof(int));
+}
+
+/*
+ * OLMExample
+ * one training gene of a chunk in the online large margin training:
+ * Viterbi path, feature counts of the Viterbi path and of the correct path and the margin b,
+ * all computed with the parameters at the start of the chunk (see runInProcesses)
+ */
+class OLMExample {
+public:
+    OLMExample(NAMGene *ng, Parameters *pars, AnnoSequence *seq, SequenceFeatureCollection *psfc, int r, int n,
+	       int nc, double sdw, double lw) :
+	namgene(ng), parameters(pars), as(seq), sfc(psfc), round(r), N(n), scorediffweight(sdw),
+	lossweight(lw), numCorrect(nc), b(0.0) {}
+    void operator()();
+    void write(ostream &out) const {
+	out.write((const char*) &numCorrect, sizeof(numCorrect));
+	out.write((const char*) &b, sizeof(b));
+	writeCounts(out, viterbiCounts);
+	writeCounts(out, correctCounts);
+    }
+    void read(istream &in){
+	in.read((char*) &numCorrect, sizeof(numCorrect));
+	in.read((char*) &b, sizeof(b));
+	readCounts(in, viterbiCounts);
+	readCounts(in, correctCounts);
+    }
+private:
+    NAMGene *namgene;
+    Parameters *parameters;
+    AnnoSequence *as;
+    SequenceFeatureCollection *sfc;
+    int round, N;
+    double scorediffweight, lossweight;
+public:
+    int numCorrect;                            // how often Viterbi was correct on this gene so far
+    double b;                                  // margin, 0 if Viterbi is correct
+    vector<int> viterbiCounts, correctCounts;  // only when Viterbi is wrong
+};
+
+void OLMExample::operator()(){
+    streamsize precision = cout.precision(); // leave cout as in a worker process
+    cout << "using training sequence " << as->seqname << " (length=" << as->length << ")." << endl;
+    /*
+     * compute Viterbi path
+     */
+    StatePath *viterbiPath = namgene->getTrainViterbiPath(as->sequence, sfc);
+    StatePath *condensedViterbiPath = StatePath::condenseStatePath(viterbiPath);
+    Gene* viterbiGenes = condensedViterbiPath->projectOntoGeneSequence("v");
+    if (viterbiGenes && round < 4)
+	printGeneList(viterbiGenes, as, false, false);
+    /*
+     * correct path
+     */
+    StatePath *correctPath = StatePath::getInducedStatePath(as->anno->genes, as->length, false);
+    if (round < 4)
+	as->anno->printGFF();
+
+    /*
+     * compare Viterbi with correct path
+     */
+    if (*correctPath == *viterbiPath){
+	cout << "Gene(s) correctly predicted in " << as->seqname << ". I don't do nothin." << endl;
+	numCorrect++;
+    } else {
+	cout << "Viterbi wrong in " << as->seqname << "." << endl;
+	// testing for now: Only count features falling in range of annotated gene(s)
+	int countFrom = as->anno->genes->geneBegin()-10000;
+	int countTo = as->anno->genes->geneEnd()+10000; //TODO: deal with multi-gene sequences
+	cout << "counting features only in region " << countFrom << ".." << countTo << endl;
+	StateModel::setCountRegion(countFrom, countTo);
+	parameters->resetCounts();
+	Double viterbiPathEmiProb = namgene->getPathEmiProb(viterbiPath, as->sequence, *sfc, countFrom, countTo);
+	viterbiCounts = parameters->getCounts();
+	double viterbiScore = viterbiPathEmiProb.log();
+	cout << "Viterbi pathEmiProb=" << viterbiPathEmiProb << " score = " << setprecision(6) << viterbiScore << endl;
+	if (round == 1){
+	    cout << "counts of viterbi path" << endl;
+	    parameters->print<int>(viterbiCounts, 5, true);
+	}
+
+	parameters->resetCounts();
+	Double correctPathEmiProb = namgene->getPathEmiProb(correctPath, as->sequence, *sfc, countFrom, countTo);
+	correctCounts = parameters->getCounts();
+	double correctScore = correctPathEmiProb.log();
+	cout << "correct pathEmiProb=" << correctPathEmiProb << " score = " << setprecision(6) << correctScore << endl;
+	if (round == 1){
+	    cout << "counts of correct path" << endl;
+	    parameters->print<int>(correctCounts, 5, true);
+	}
+	parameters->resetCounts();
+
+	if (!(correctPathEmiProb > 0.0)){
+	    cout << "Correct path IMPOSSIBLE in model. Can't do anything about this by only changing weights." << endl;
+	} else {
+	    /*
+	     * compute loss function that measures how far Viterbi is off
+	     */
+	    double loss = CRF::lossFct(as->anno->genes, viterbiGenes); // TODO
+	    if (viterbiScore < correctScore){
+		cout << "viterbi score < correct score" << endl;
+	    }
+	    b = scorediffweight * ((viterbiScore > correctScore)? (viterbiScore - correctScore) : 0) + lossweight * loss;
+	    cout << "b = scorediffweight * ((viterbiScore > correctScore)? (viterbiScore - correctScore) : 0) + lossweight * loss = "
+		 << scorediffweight << " * ( " << viterbiScore << " - " << correctScore << ") + " << lossweight
+		 << " * " << loss << " = " << b << endl;
+	}
+    } // *correctPath != *viterbiPath
+    cout << "correct: " << numCorrect << " of " << N << endl;
+    // clean up
+    delete correctPath;
+    delete viterbiPath;
+    delete condensedViterbiPath;
+    cout.precision(precision);
+}
+
+/*
+ * IISExample
+ * one training gene in a round of improved iterative scaling: feature counts of the correct path
+ * and the summed feature counts of the sampled paths
+ */
+class IISExample {
+public:
+    IISExample(NAMGene *ng, Parameters *pars, AnnoSequence *seq, SequenceFeatureCollection *psfc, int r, bool use,
+	       int s, unsigned int rs) :
+	namgene(ng), parameters(pars), as(seq), sfc(psfc), round(r), wasFeasible(use), sample(s), seed(rs),
+	pathPossible(false), sampled(false), score(0.0) {}
+    void operator()();
+    void write(ostream &out) const {
+	out.write((const char*) &pathPossible, sizeof(pathPossible));
+	out.write((const char*) &sampled, sizeof(sampled));
+	out.write((const char*) &score, sizeof(score));
+	writeCounts(out, correctCounts);
+	writeCounts(out, sampledCounts);
+    }
+    void read(istream &in){
+	in.read((char*) &pathPossible, sizeof(pathPossible));
+	in.read((char*) &sampled, sizeof(sampled));
+	in.read((char*) &score, sizeof(score));
+	readCounts(in, correctCounts);
+	readCounts(in, sampledCounts);
+    }
+private:
+    NAMGene *namgene;
+    Parameters *parameters;
+    AnnoSequence *as;
+    SequenceFeatureCollection *sfc;
+    int round;
+    bool wasFeasible;             // false for genes found infeasible in the first round, they are skipped
+    int sample;                   // number of sampled paths
+    unsigned int seed;
+public:
+    bool pathPossible;            // the correct path has a positive probability
+    bool sampled;
+    double score;                 // log probability of the correct path
+    vector<int> correctCounts;    // feature counts of the correct path
+    vector<int> sampledCounts;    // feature counts summed over the sampled paths
+};
+
+void IISExample::operator()(){
+    if (!wasFeasible) {
+	cout << "skipping infeasible seq " << as->seqname << endl;
+	return;
+    }
+    srand(seed);
+    StatePath *viterbiPath = namgene->getTrainViterbiPath(as->sequence, sfc);
+    delete viterbiPath; // we actually don't need this in this algorithm, but namgene needs the forward table..
+
+    /*
+     * in the first round compute the feature sum for all training examples
+     * this is done simultaneously because viterbi/forward/ automatically initializes for getPathEmiProb
+     */
+    StatePath *correctPath = StatePath::getInducedStatePath(as->anno->genes, as->length, false);
+    parameters->resetCounts();
+    Double pathEmiProb = namgene->getPathEmiProb(correctPath, as->sequence, *sfc);
+    delete correctPath;
+    if (pathEmiProb > 0.0){
+	pathPossible = true;
+	if (round == 1)
+	    correctCounts = parameters->getCounts();
+	score = pathEmiProb.log();
+	cout << "training seq " << as->seqname << ", score= " << score << endl;
+    } else if (round == 1) {
+	cout << "training gene structure on " << as->seqname << " not feasible. Skipping this example from now on." << endl;
+    }
+    if (round == 1 && !pathPossible)
+	return;
+    sampled = true;
+    sampledCounts.assign(parameters->size(), 0);
+    for (int j=0; j < sample; j++){
+	StatePath *sampledPath = namgene->getSampledPath(as->sequence, as->seqname);
+	parameters->resetCounts();
+	namgene->getPathEmiProb(sampledPath, as->sequence, *sfc);
+	vector<int> counts = parameters->getCounts();
+	for (int k=0; k < parameters->size(); k++)
+	    sampledCounts[k] += counts[k];
+	delete sampledPath;
+    }
+    parameters->resetCounts();
+}
+
 /*
  * onlineLargeMarginTraining (OLM)
  * 
@@ -338,9 +558,6 @@ void CRF::train(Parameters* startPars, vector<AnnoSequence*> trainGenes, Feature
 void CRF::onlineLargeMarginTraining(Parameters* parameters, vector<AnnoSequence*> trainGenes, FeatureCollection &extrinsicFeatures){
     inCRFTraining = true;
     NAMGene namgene;
-    Double viterbiPathEmiProb, correctPathEmiProb;
-    double correctScore, viterbiScore;
-    double loss; // value of loss function
     AnnoSequence* as;
     vector<int> a; // count vector of correct features minus viterbi features
     vector<double> h(parameters->size(), 0.0); // weight difference vector
@@ -350,9 +567,9 @@ void CRF::onlineLargeMarginTraining(Parameters* parameters, vector<AnnoSequence*
     int numiterations=0, u; // at most Nm
     bool termination=false;
     double target;
-    StatePath *viterbiPath, *correctPath, *condensedViterbiPath=NULL;//, *condensedCorrectPath=NULL;
     int chunksize = 100; // consider this many training genes to be one training example (will be increased a little below to fit)
     int maxTrainSeqs = -1; // use only this many training genes for CRF iterations per round (-1: use all)
+    int numThreads = getNumThreads(); // the genes of a chunk are decoded in this many processes
     vector<double> bs;
     vector< vector<int> > viterbiCounts, correctCounts; // holds all feature counts of a chunk
     vector<int> chunkViterbiCounts(parameters->size(), 0), chunkCorrectCounts(parameters->size(), 0);
@@ -425,10 +642,10 @@ void CRF::onlineLargeMarginTraining(Parameters* parameters, vector<AnnoSequence*
 	for (int i=0; i < m && (maxTrainSeqs < 0 || i < maxTrainSeqs); i += chunksize) {
 	    // reset chunk counters
 	    bs.assign(chunksize, 0.0);
-	    // loop over chunk	   
+	    // prepare the hints of the chunk, then decode its genes with the same parameters
+	    vector<OLMExample> examples;
 	    for (u = 0; u < chunksize && i + u < m; u++) {
 		as = trainGenes[i+u];
-		cout << "using training sequence " << as->seqname << " (length=" << as->length << ")." << endl;
 		if (round == 1) {
 		    SequenceFeatureCollection &sfc = extrinsicFeatures.getSequenceFeatureCollection(as->seqname);
 		    if (sfcs.size() != i+u) {
@@ -437,82 +654,16 @@ void CRF::onlineLargeMarginTraining(Parameters* parameters, vector<AnnoSequence*
 		    sfc.prepare(as, true);
 		    sfcs.push_back(&sfc);
 		}
-	    
-		/*
-		 * compute Viterbi path
-		 */
-		viterbiPath = namgene.getTrainViterbiPath(as->sequence, sfcs[i+u]);
-		condensedViterbiPath = StatePath::condenseStatePath(viterbiPath);
-		//condensedViterbiPath->print();
-		Gene* viterbiGenes = condensedViterbiPath->projectOntoGeneSequence("v");
-		if (viterbiGenes && round < 4)
-		    printGeneList(viterbiGenes, as, false, false);
-		/*
-		 * correct path
-		 */
-		correctPath = StatePath::getInducedStatePath(as->anno->genes, as->length, false);
-		//condensedCorrectPath = StatePath::condenseStatePath(correctPath);
-		//condensedCorrectPath->print();
-		if (round < 4)
-		    as->anno->printGFF();
-
-		/*
-		 * compare Viterbi with correct path
-		 */
-		if (*correctPath == *viterbiPath){
-		    cout << "Gene(s) correctly predicted in " << as->seqname << ". I don't do nothin." << endl;
-		    numCorrect[u+i]++;
-		} else {
-		    cout << "Viterbi wrong in " << as->seqname << "." << endl;
-		    // testing for now: Only count features falling in range of annotated gene(s)
-		    int countFrom = as->anno->genes->geneBegin()-10000;
-		    int countTo = as->anno->genes->geneEnd()+10000; //TODO: deal with multi-gene sequences
-		    cout << "counting features only in region " << countFrom << ".." << countTo << endl;
-		    StateModel::setCountRegion(countFrom, countTo);
-		    parameters->resetCounts();
-		    viterbiPathEmiProb = namgene.getPathEmiProb(viterbiPath, as->sequence, *sfcs[i+u], countFrom, countTo);
-		    viterbiCounts[u] = parameters->getCounts();
-		    viterbiScore = viterbiPathEmiProb.log();
-		    cout << "Viterbi pathEmiProb=" << viterbiPathEmiProb << " score = " << setprecision(6) << viterbiScore << endl;
-		    if (round == 1){
-			cout << "counts of viterbi path" << endl;
-			parameters->print<int>(viterbiCounts[u], 5, true);
-		    }
-		    
-		    parameters->resetCounts();
-		    correctPathEmiProb = namgene.getPathEmiProb(correctPath, as->sequence, *sfcs[i+u], countFrom, countTo);
-		    correctCounts[u] = parameters->getCounts();
-		    correctScore = correctPathEmiProb.log();
-		    cout << "correct pathEmiProb=" << correctPathEmiProb << " score = " << setprecision(6) << correctScore << endl;
-		    if (round == 1){
-			cout << "counts of correct path" << endl;
-			parameters->print<int>(correctCounts[u], 5, true);
-		    }
-		    parameters->resetCounts();
-		    
-		    if (!(correctPathEmiProb > 0.0)){
-			cout << "Correct path IMPOSSIBLE in model. Can't do anything about this by only changing weights." << endl;
-		    } else {
-			/*
-			 * compute loss function that measures how far Viterbi is off
-			 */
-			loss = lossFct(as->anno->genes, viterbiGenes); // TODO
-			if (viterbiScore < correctScore){
-			    cout << "viterbi score < correct score" << endl;
-			}
-			bs[u] = scorediffweight * ((viterbiScore > correctScore)? (viterbiScore - correctScore) : 0) + lossweight * loss;
-			cout << "b = scorediffweight * ((viterbiScore > correctScore)? (viterbiScore - correctScore) : 0) + lossweight * loss = " 
-			     << scorediffweight << " * ( " << viterbiScore << " - " << correctScore << ") + " << lossweight 
-			     << " * " << loss << " = " << bs[u] << endl;
-		    }
-		} // *correctPath != *viterbiPath
-		cout << "correct: " << numCorrect[u+i] << " of " << N << endl;
-		// clean up
-		delete correctPath;
-		delete viterbiPath;
-		if (condensedViterbiPath)
-		    delete condensedViterbiPath;
-	    } // end of loop over chunk elements
+		examples.push_back(OLMExample(&namgene, parameters, as, sfcs[i+u], round, N, numCorrect[i+u], scorediffweight, lossweight));
+	    }
+	    runInProcesses(examples, numThreads);
+	    // collect the margins and feature counts of the chunk
+	    for (u = 0; u < examples.size(); u++) {
+		bs[u] = examples[u].b;
+		viterbiCounts[u] = examples[u].viterbiCounts;
+		correctCounts[u] = examples[u].correctCounts;
+		numCorrect[i+u] = examples[u].numCorrect;
+	    }
 	    
 	    vector<double> bsc = capOutliers(bs);
 	    h.assign(h.size(), 0.0);
@@ -556,6 +707,7 @@ void CRF::onlineLargeMarginTraining(Parameters* parameters, vector<AnnoSequence*
 	    parameters->updatePars();
 	    parameters->smoothFeatures();
 	    parameters->updateWeights();
+	    StateModel::makeEmiTables(); // the Viterbi algorithm uses copies of the emission probabilities
 	    vector<double> endWeights = parameters->getWeights();       //TEMP
 	    CRF::compareWeights(parameters, startWeights, endWeights, 30);       //TEMP
 	    if (false){
@@ -637,13 +789,11 @@ void CRF::improvedIterativeScaling(Parameters* parameters, vector<AnnoSequence*>
     namgene.setNeedForwardTable(true); // for sampling
     int m=0; // training set size, only feasible
     int sample=100; // number of sample iterations per sequence
+    int numThreads = getNumThreads(); // the training genes are processed in this many processes
     double up = 0.0; // upper limit on the feature sum
-    double score, totalScore = 0.0, target;
+    double totalScore = 0.0, target;
     AnnoSequence* as;
     int N; // number of rounds
-    vector<int> counts;
-    StatePath *sampledPath, *correctPath, *condensedSampledPath=NULL;//, *condensedCorrectPath=NULL;
-    Double pathEmiProb;
     bool termination = false;
     vector<int> Nf(parameters->size(), 0); // actual count of features in training data
     vector<int> Sf(parameters->size(), 0); // sampled count of features in training data
@@ -688,13 +838,9 @@ void CRF::improvedIterativeScaling(Parameters* parameters, vector<AnnoSequence*>
 	for (int k=0; k < parameters->size(); k++) // reset sampled counts to 0
 	    Sf[k] = 0;
 	totalScore = 0.0;
+	vector<IISExample> examples;
 	for (int i=0; i < trainGenes.size(); i++){
 	    as = trainGenes[i];
-	    if (round > 1 && feasible.size() >i && !feasible[i]) {
-		cout << "skipping infeasible seq " << as->seqname << endl;
-		continue;
-	    }
-	    //cout << "computing expected feature counts for training example " << as->seqname << " (length=" << as->length << ")." << endl;
 	    if (round == 1) {
 		SequenceFeatureCollection &sfc = extrinsicFeatures.getSequenceFeatureCollection(as->seqname);
 		if (sfcs.size() != i) {
@@ -703,57 +849,28 @@ void CRF::improvedIterativeScaling(Parameters* parameters, vector<AnnoSequence*>
 		sfc.prepare(as, true);
 		sfcs.push_back(&sfc);
 	    }
-	    StatePath *viterbiPath = namgene.getTrainViterbiPath(as->sequence, sfcs[i]);
-	    delete viterbiPath; // we actually don't need this in this algorithm, but namgene needs the forward table..
-	    
-	    /*
-             * in the first round compute the feature sum for all training examples
-             * this is done simultaneously because viterbi/forward/ automatically initializes for getPathEmiProb
-             */
-            if (round == 1 || feasible[i]){
-                correctPath = StatePath::getInducedStatePath(as->anno->genes, as->length, false);
-                //condensedCorrectPath = StatePath::condenseStatePath(correctPath);
-                //cout << "correctPath:" << endl; condensedCorrectPath->print();
-                parameters->resetCounts();
-		//cout << "getting path emi prob" << endl << flush;
-                pathEmiProb = namgene.getPathEmiProb(correctPath, as->sequence, *sfcs[i]);
-		delete correctPath;
-		//delete condensedCorrectPath;
-                //cout << "correct pathEmiProb=" << pathEmiProb << endl;
-		if (pathEmiProb > 0.0){
-		    if (round == 1) {
-			feasible.push_back(true);
-			m++;
-			if (as->length > up)
-			    up = as->length;
-			vector<int> counts = parameters->getCounts();
-			for (int k=0; k < parameters->size(); k++)
-			    Nf[k] += counts[k];
-		    }
-		    score = pathEmiProb.log();
-		    totalScore += score;
-		    cout << "training seq no " << m << " " << as->seqname << ", score= " << score << endl;
-                } else {
-		    if (round == 1) {
-			cout << "training gene structure on " << as->seqname << " not feasible. Skipping this example from now on." << endl;
-			feasible.push_back(false);
-		    }
-		}
-            }
-	    if (feasible[i]){
-		for (int j=0; j < sample; j++){
-		    sampledPath = namgene.getSampledPath(as->sequence, as->seqname);
-		    condensedSampledPath = StatePath::condenseStatePath(sampledPath);
-		    //cout << j+1 << "th sampled path:" << endl; condensedSampledPath->print();
-		    parameters->resetCounts();
-		    namgene.getPathEmiProb(sampledPath, as->sequence, *sfcs[i]);
-		    vector<int> counts = parameters->getCounts();
+	    // each gene gets its own random seed, so the sampled paths do not depend on the number of processes
+	    examples.push_back(IISExample(&namgene, parameters, as, sfcs[i], round, round == 1 || feasible[i], sample, rand()));
+	}
+	unsigned int nextSeed = rand();
+	runInProcesses(examples, numThreads);
+	srand(nextSeed); // the examples reseeded the generator if they ran in this process
+	for (int i=0; i < examples.size(); i++){
+	    if (round == 1) {
+		feasible.push_back(examples[i].pathPossible);
+		if (examples[i].pathPossible) {
+		    m++;
+		    if (trainGenes[i]->length > up)
+			up = trainGenes[i]->length;
 		    for (int k=0; k < parameters->size(); k++)
-			Sf[k] += counts[k];
-		    delete sampledPath;
-		    delete condensedSampledPath;
+			Nf[k] += examples[i].correctCounts[k];
 		}
 	    }
+	    if (examples[i].pathPossible)
+		totalScore += examples[i].score;
+	    if (examples[i].sampled)
+		for (int k=0; k < parameters->size(); k++)
+		    Sf[k] += examples[i].sampledCounts[k];
 	}
 	if (round == 1){
 	    cout << "training set has size " << m << endl;
@@ -799,6 +916,7 @@ void CRF::improvedIterativeScaling(Parameters* parameters, vector<AnnoSequence*>
 	parameters->addWeights(h);
 	parameters->smoothFeatures();
 	parameters->updatePars();
+	StateModel::makeEmiTables();
 	vector<double> endWeights = parameters->getWeights();   //TEMP
 	CRF::compareWeights(parameters, startWeights, endWeights, 50);   //TEMP
 	cout << "updated Parameters:" << endl;
@@ -493,7 +493,7 @@ BaseCount ContentDecomposition::getBaseCount(int i){
     return zus[i];
 }
 
-int ContentDecomposition::getNearestBaseCountIndex(BaseCount bc) {
+int ContentDecomposition::getNearestBaseCountIndex(const BaseCount &bc) {
     double maxWeight = -1;
     double weight;
     int ret = -1;
@@ -549,6 +549,12 @@ void ContentStairs::computeStairs(const char* dna){
   if (win > n || win < 1)
     win = n;
   
+  if (cd.n == 1) { // only one GC content class, nothing to decide
+    for (int i=0; i < n; i++)
+      idx[i] = 0;
+    return;
+  }
+
   // first window goes from 0 to win-1
   BaseCount bc(dna, win);
   x = cd.getNearestBaseCountIndex(bc);
@@ -558,11 +564,15 @@ void ContentStairs::computeStairs(const char* dna){
   // mittle part for which the window is a proper substring of dna
   // window goes from i - int(win/2) to i + int((win+1)/2) - 1
   for (int i = int(win/2) + 1; i <= n - int((win+1)/2); i++){ // shift window by 1 to the right
-    //    cout << "i=" << i << " adding " << dna[i + int((win+1)/2) - 1] << " removing " << dna[i - int(win/2) - 1] << endl;
-    bc.addCharacter(dna[i + int((win+1)/2) - 1]);       // add new base to the right
-    bc.addCharacter(dna[i - int(win/2) - 1], true); // subtract old base to the left
-    //    bc.normalize();
-    idx[i] = x = cd.getNearestBaseCountIndex(bc);
+    char in = dna[i + int((win+1)/2) - 1], out = dna[i - int(win/2) - 1];
+    //    cout << "i=" << i << " adding " << in << " removing " << out << endl;
+    if (in != out) { // otherwise the base composition of the window and hence its class is unchanged
+      bc.addCharacter(in);        // add new base to the right
+      bc.addCharacter(out, true); // subtract old base to the left
+      //    bc.normalize();
+      x = cd.getNearestBaseCountIndex(bc);
+    }
+    idx[i] = x;
     //    cout << i << " " << bc << endl;
   }
   // last window goes from n-win to n-1
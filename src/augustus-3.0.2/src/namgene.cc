@@ -28,6 +28,7 @@
 #include "projectio.hh"  // for comment, goto_line_after
 #include "mea.hh"
 #include "exoncand.hh"
+#include "intronmodel.hh"
 
 // standard C/C++ includes
 #include <iomanip>  // for setprecision
@@ -43,6 +44,7 @@ NAMGene::NAMGene() {
    *  - read in transition probabilities
    */
   statecount = Properties::getIntProperty( "/NAMGene/statecount" );
+  GCtransitions = NULL;
   try {
       noInFrameStop = Properties::getBoolProperty("noInFrameStop");
   } catch (...) {
@@ -78,6 +80,24 @@ NAMGene::NAMGene() {
 	       << "Posterior probabilities will be only rough estimates." << endl;
       }
   }
+  try {
+      beamCheck = Properties::getBoolProperty("beamCheck");
+  } catch (...) {
+      beamCheck = false;
+  }
+  beamChecked = beamChanged = 0;
+  try {
+      exonCands = Properties::getBoolProperty("exoncand");
+  } catch (...) {
+      exonCands = false;
+  }
+  // the same splice site thresholds as for the exon candidates in comparative gene prediction
+  ecAssMotifQthresh = 0.15;
+  ecAssQthresh = 0.3;
+  ecDssQthresh = 0.7;
+  Properties::assignProperty("/CompPred/assmotifqthresh", ecAssMotifQthresh);
+  Properties::assignProperty("/CompPred/assqthresh", ecAssQthresh);
+  Properties::assignProperty("/CompPred/dssqthresh", ecDssQthresh);
   try {
       alternatives_from_sampling = Properties::getBoolProperty("alternatives-from-sampling");
   } catch (...) {
@@ -177,7 +197,7 @@ int NAMGene::getStateIndex(StateType type){
     throw NAMGeneError( errmsg);
 }
 
-void NAMGene::viterbiAndForward( const char* dna, bool useProfile){
+void NAMGene::viterbiAndForward( const char* dna, bool useProfile, bool noBeam){
  
   StateModel::setPP(useProfile ? profileModel : NULL);  
   int progress, oldprogress=0;
@@ -207,6 +227,12 @@ void NAMGene::viterbiAndForward( const char* dna, bool useProfile){
 
   curGCIdx = -1; // initialize with invalid GC content class
   prepareModels(dna, dnalen);
+  if (exonCands)
+      setExonCands(dna, dnalen);
+  // beam pruning only when neither forward variables nor substates are needed
+  StateModel::setBeamActive(!needForwardTable && !useProfile && !noBeam);
+  if (StateModel::isBeamActive())
+      setColumnBest(0);
   
 
   /*
@@ -274,6 +300,8 @@ void NAMGene::viterbiAndForward( const char* dna, bool useProfile){
 	      states[i]->viterbiForwardAndSampling(viterbi, forward, i, j, doViterbi(needForwardTable), oli);
 	  }
       }
+      if (StateModel::isBeamActive())
+	  setColumnBest(j);
       if (j % 1000 == 0) {
 #ifdef DEBUG 
 	  cerr << "[" << j;
@@ -434,6 +462,79 @@ StatePath* NAMGene::getSampledPath(const char *dna, const char* seqname){
   return sampledPath;
 }
 
+/*
+ * NAMGene::printBeamCheck
+ * report how often beam pruning changed the Viterbi path (option beamCheck)
+ */
+void NAMGene::printBeamCheck(){
+  if (!beamCheck || !StateModel::hasBeam())
+      return;
+  cout << "# beam pruning changed the Viterbi path in " << beamChanged << " of " << beamChecked
+       << " DNA pieces";
+  if (beamChecked > 0)
+      cout << " (" << 100.0 * beamChanged / beamChecked << "%)";
+  cout << endl;
+}
+
+/*
+ * NAMGene::getExonCands
+ * The splice site scores depend on the GC content class, so the candidates are
+ * searched once per class occurring in dna with the models of that class.
+ * A candidate is kept if its right end lies in a region of that class, as the
+ * exon state ending there is evaluated with the same parameters.
+ * The result does not depend on the class that was used last.
+ */
+list<ExonCandidate*> *NAMGene::getExonCands(const char *dna, int minLen, double assmotifqthresh, double assqthresh, double dssqthresh){
+  int dnalen = strlen(dna);
+  cs.computeStairs(dna);
+  vector<bool> hasGCIdx(Constant::decomp_num_steps, false);
+  for (int j = 0; j < dnalen; j++)
+      hasGCIdx[cs.idx[j]] = true;
+  list<ExonCandidate*> *cands = new list<ExonCandidate*>;
+  for (int idx = 0; idx < Constant::decomp_num_steps; idx++) {
+      if (!hasGCIdx[idx])
+	  continue;
+      initAlgorithms(idx);
+      list<ExonCandidate*> *idxCands = findExonCands(dna, minLen, assmotifqthresh, assqthresh, dssqthresh);
+      for (list<ExonCandidate*>::iterator it = idxCands->begin(); it != idxCands->end(); ++it) {
+	  int end = (*it)->end;
+	  if (end >= 0 && end < dnalen && cs.idx[end] == idx)
+	      cands->push_back(*it);
+	  else
+	      delete *it;
+      }
+      delete idxCands;
+  }
+  cands->sort(compBegin); // same order as from findExonCands, GeneMSA::createOrthoExons relies on it
+  curGCIdx = -1; // the Viterbi loop switches to the class at the sequence start
+  return cands;
+}
+
+/*
+ * NAMGene::setExonCands
+ * compute the exon candidates of dna and restrict the exon states to them
+ */
+void NAMGene::setExonCands(const char* dna, int dnalen){
+  list<ExonCandidate*> *cands = getExonCands(dna, 1, ecAssMotifQthresh, ecAssQthresh, ecDssQthresh);
+  ExonModel::setExonCands(new ExonCandIndex(cands, dnalen));
+  for (list<ExonCandidate*>::iterator it = cands->begin(); it != cands->end(); ++it)
+      delete *it;
+  delete cands;
+}
+
+/*
+ * NAMGene::setColumnBest
+ * store the largest Viterbi variable of column j for beam pruning
+ */
+void NAMGene::setColumnBest(int j){
+  Double best = 0.0;
+  const ViterbiColumnType& col = viterbi[j];
+  for (int i = 0; i < statecount; i++)
+      if (col.get(i) > best)
+	  best = col.get(i);
+  StateModel::setColumnBest(j, best);
+}
+
 /*
  * NAMGene::getViterbiPath
  * Create the Viterbi-Path
@@ -520,8 +621,6 @@ Gene *NAMGene::doViterbiPiecewise(SequenceFeatureCollection& sfc, AnnoSequence *
   Gene *genes=NULL;
   list<AltGene> *geneList = new list<AltGene>;
   char *dna = annoseq->sequence;
-  char *curdna;
-  AnnoSequence *curAnnoSeq;
   char *seqname = annoseq->seqname;
   vector<Double> *origInitProbs;
   vector<Double> *origTermProbs;
@@ -529,7 +628,6 @@ Gene *NAMGene::doViterbiPiecewise(SequenceFeatureCollection& sfc, AnnoSequence *
 //  SequenceFeatureCollection *partSFC;
   static int geneid = 1; // made this static so gene numbering goes across sequences and is unique
   int transcriptid;
-  int curdnalen;
   
   bool singlestrand = false; // singlestrand = no shadow states
   try {
@@ -539,6 +637,7 @@ Gene *NAMGene::doViterbiPiecewise(SequenceFeatureCollection& sfc, AnnoSequence *
   int maxstep = 1000000;
   int endPos, beginPos;
   int seqlen = strlen(dna);
+  StrandedDNA strandedDNA(dna, seqlen); // pieces are views on this, reverse complement only built when needed
   try {
     maxstep = Properties::getIntProperty( "maxDNAPieceSize" );
   } catch (...) {}
@@ -584,13 +683,6 @@ Gene *NAMGene::doViterbiPiecewise(SequenceFeatureCollection& sfc, AnnoSequence *
 #ifdef DEBUG
       cout << "# examining piece " << beginPos + annoseq->offset + 1<< ".." << endPos + annoseq->offset + 1 << " (" << (endPos-beginPos+1) << " bp)" << endl;
 #endif
-    curAnnoSeq = new AnnoSequence();
-    curdnalen = endPos-beginPos+1;
-    curAnnoSeq->length = curdnalen;
-    curdna = newstrcpy(dna+beginPos, curdnalen);
-    curAnnoSeq->sequence = curdna;
-    curAnnoSeq->offset = annoseq->offset + beginPos;
-
     /*
      * Set the initial and terminal probabilities.
      */
@@ -608,20 +700,20 @@ Gene *NAMGene::doViterbiPiecewise(SequenceFeatureCollection& sfc, AnnoSequence *
     list<AltGene> *pieceGenes = new list<AltGene>;
 
     if (!singlestrand) {
+	DNAView piece(strandedDNA, beginPos, endPos, plusstrand, annoseq->offset + beginPos);
 	SequenceFeatureCollection partSFC(sfc, beginPos, endPos);
-	pieceGenes = getStepGenes(curAnnoSeq, partSFC, strand);
+	pieceGenes = getStepGenes(piece, partSFC, strand);
     } else {
 	if (strand == plusstrand || strand == bothstrands){
+	    DNAView piece(strandedDNA, beginPos, endPos, plusstrand, annoseq->offset + beginPos);
 	    SequenceFeatureCollection partSFC(sfc, beginPos, endPos);
-	    pieceGenes = getStepGenes(curAnnoSeq, partSFC, plusstrand);
+	    pieceGenes = getStepGenes(piece, partSFC, plusstrand);
 	}
 	if (strand == minusstrand || strand == bothstrands) {
 	    list<AltGene> *pieceForwardGenes, *pieceReverseGenes;
-	    char *reverseDNA = reverseComplement(curdna);
-	    delete [] curAnnoSeq->sequence;
-	    curAnnoSeq->sequence = reverseDNA;
+	    DNAView reversePiece(strandedDNA, beginPos, endPos, minusstrand, annoseq->offset + beginPos);
 	    SequenceFeatureCollection partSFC(sfc, beginPos, endPos, true);
-	    pieceForwardGenes = getStepGenes(curAnnoSeq, partSFC, plusstrand);
+	    pieceForwardGenes = getStepGenes(reversePiece, partSFC, plusstrand);
 	    pieceReverseGenes = reverseGeneList(pieceForwardGenes, endPos-beginPos);
 	    pieceGenes->splice(pieceGenes->end(), *pieceReverseGenes);
 	}
@@ -661,9 +753,7 @@ Gene *NAMGene::doViterbiPiecewise(SequenceFeatureCollection& sfc, AnnoSequence *
     // append pieceGenes to geneList
     geneList->splice(geneList->end(), *pieceGenes);
 
-    
-	
-    delete curAnnoSeq;
+
     beginPos = endPos + 1;
   } while (beginPos < seqlen);
 
@@ -686,13 +776,11 @@ Gene *NAMGene::doViterbiPiecewise(SequenceFeatureCollection& sfc, AnnoSequence *
 /*
  * NAMGene::getStepGenes
  */
-list<AltGene> *NAMGene::getStepGenes(AnnoSequence *annoseq, SequenceFeatureCollection& sfc, Strand strand, bool onlyViterbi){
+list<AltGene> *NAMGene::getStepGenes(const DNAView &piece, SequenceFeatureCollection& sfc, Strand strand, bool onlyViterbi){
     list<AltGene> *genesAllHints, *genesPartialHints, *genes;
     list<list<AltGene> *> *results;
-    const char *dna = annoseq->sequence;
-    char *curdna;
-    int curdnalen;
-    int n = strlen(dna);
+    const char *dna = piece.getSequence();
+    int n = piece.getLength();
     bool uniqueCDS; 
     try {
 	uniqueCDS = Properties::getBoolProperty("uniqueCDS");
@@ -711,14 +799,14 @@ list<AltGene> *NAMGene::getStepGenes(AnnoSequence *annoseq, SequenceFeatureColle
      */
     genesAllHints = findGenes(dna, strand, onlyViterbi);
 #ifdef DEBUG
-    // printGeneList(genesAllHints, annoseq, false, false, false);
+    // printGeneList(genesAllHints, NULL, false, false, false);
 #endif
     results = new list<list<AltGene> *>;
     results->push_back(genesAllHints);
     sfc.createPredictionScheme(genesAllHints);
     PredictionScheme *scheme  = sfc.predictionScheme;
 #ifdef DEBUG
-    //scheme->print(annoseq->offset);
+    //scheme->print(piece.getOffset());
 #endif
     /*
      * Then make further runs with certain hintgroups deactivated.
@@ -733,8 +821,9 @@ list<AltGene> *NAMGene::getStepGenes(AnnoSequence *annoseq, SequenceFeatureColle
 	cout << "Make run ";
 	rit->print();
 #endif
-	curdnalen = rit->end - rit->begin + 1;
-	curdna = newstrcpy(dna + rit->begin, curdnalen);
+	DNAView runPiece(piece, rit->begin, rit->end);
+	const char *curdna = runPiece.getSequence();
+	int curdnalen = runPiece.getLength();
 	sfc.setActiveFlag(rit->omittedGroups, false);
 	sfc.shift(-rit->begin);
 	sfc.setSeqLen(curdnalen);
@@ -745,17 +834,16 @@ list<AltGene> *NAMGene::getStepGenes(AnnoSequence *annoseq, SequenceFeatureColle
 	for (list<AltGene>::iterator agit = genesPartialHints->begin(); agit != genesPartialHints->end(); ++agit)
 	    agit->shiftCoordinates(rit->begin);
 #ifdef DEBUG
-	printGeneList(genesPartialHints, annoseq, false, false, false);
+	printGeneList(genesPartialHints, NULL, false, false, false);
 #endif
 	results->push_back(genesPartialHints);
 	sfc.setSeqLen(n);
 	sfc.shift(rit->begin); // shift back
 	sfc.setActiveFlag(rit->omittedGroups, true);
-	delete [] curdna;
     }
     genes = sfc.joinGenesFromPredRuns(results, maxtracks, uniqueCDS);
     // TODO: delete results 
-    postProcessGenes(genes, annoseq); // truncate masked UTRs
+    postProcessGenes(genes, dna); // truncate masked UTRs
     return genes;
 }
 
@@ -797,6 +885,15 @@ list<AltGene> *NAMGene::findGenes(const char *dna, Strand strand, bool onlyViter
    * add the viterbi transcripts to the list of genes
    */
   viterbiPath = getViterbiPath(dna, "");
+  if (beamCheck && StateModel::isBeamActive()) {
+      // compare with the exact Viterbi path
+      viterbiAndForward(dna, false, true);
+      StatePath *exactPath = getViterbiPath(dna, "");
+      beamChecked++;
+      if (!(*exactPath == *viterbiPath))
+	  beamChanged++;
+      delete exactPath;
+  }
   //getPathEmiProb(viterbiPath, dna); // for testing
   condensedViterbiPath = StatePath::condenseStatePath(viterbiPath);
   //condensedViterbiPath->print(); // for testing
@@ -1304,7 +1401,7 @@ Double NAMGene::getPathEmiProb(StatePath *path, const char *dna, SequenceFeature
 	
 	if (laststate && curstate->begin >= countStart && curstate->end <= countEnd) {
 	    // multiply also by the transition probability of the transition "laststate->curstate"
-	    pathemi *= transitions[getStateIndex(laststate->type)][stateidx];
+	    pathemi *= GCtransitions[curGCIdx][getStateIndex(laststate->type)][stateidx];
 	} else { 
 	    // first state: multiply also by the initial probability
 	    /*
@@ -1559,11 +1656,31 @@ void NAMGene::createStateModels( ){
     }
 }
 
+/*
+ * NAMGene::initAlgorithms
+ * switch the states to the parameters of GC content class idx
+ * The corrected transition matrix and the lists of predecessors are
+ * set up only on the first use of a GC content class for the current sequence.
+ * Later switches to the same class merely exchange pointers.
+ */
 void NAMGene::initAlgorithms(int idx){
   StateModel::resetPars();
   StateModel::setGCIdx(idx);
+  for( int i = 0; i < statecount; ++i )
+    states[i]->useGCPars();
+  if (!GCtransitions) {
+    GCtransitions = new Matrix<Double>[Constant::decomp_num_steps];
+    haveGCtransitions.assign(Constant::decomp_num_steps, false);
+  }
+  if (haveGCtransitions[idx]) {
+    for( int i = 0; i < statecount; i++ )
+      states[i]->usePredecessors();
+    return;
+  }
+  Matrix<Double> &trans = GCtransitions[idx];
+  trans = transitions; // corrections of the states start from the original matrix
   for( int i = 0; i < statecount; ++i ){
-    states[i]->initAlgorithms(transitions, i);
+    states[i]->initAlgorithms(trans, i);
   }
   /*
    * give the states the possibly implicitly changed transition matrix above 
@@ -1571,10 +1688,12 @@ void NAMGene::initAlgorithms(int idx){
    *
    */
   for( int i = 0; i < statecount; i++ )
-    states[i]->initPredecessors(transitions, i);
+    states[i]->initPredecessors(trans, i);
+  haveGCtransitions[idx] = true;
 }
 
 void NAMGene::prepareModels(const char* dna, int dnalen) {
+    haveGCtransitions.assign(haveGCtransitions.size(), false);
     StateModel::prepareViterbi(dna, dnalen, stateMap);
 #ifdef DEBUG
     PP::ExonScorer::transitions = &transitions;
@@ -15,6 +15,11 @@
 #include "contTimeMC.hh"
 #include "mea.hh"
 
+// standard C/C++ includes
+#include <algorithm>
+#include <boost/unordered_map.hpp>
+#include <boost/thread/mutex.hpp>
+
 using namespace std;
 
 PhyloTree *OrthoGraph::tree = NULL;
@@ -265,20 +270,38 @@ double OrthoGraph::pruningAlgor(list<OrthoExon> &orthoex, ExonEvo &evo){
     double tree_score = 0;
     Evo *evo_base = &evo;
 
-    for(list<OrthoExon>::iterator ortho = orthoex.begin(); ortho != orthoex.end(); ortho++){
-
+    // the label patterns that are not in the cache are scored in one batch
+    vector<double> patternScores(orthoex.size());
+    vector<int> batchIdx(orthoex.size(), -1); // index of the tuple, if the pattern was not cached
+    vector<string> newpatterns;
+    vector<vector<int> > tuples;
+    map<string, int> pending;
+    int t = 0;
+    for(list<OrthoExon>::iterator ortho = orthoex.begin(); ortho != orthoex.end(); ortho++, t++){
 	string labelpattern = getLabelpattern(*ortho);
-	if(cache::inHash(labelpattern)){
-	    tree_score += cache::getScore(labelpattern);
+	if(cache::lookup(labelpattern, patternScores[t]))
+	    continue;
+	map<string, int>::iterator it = pending.find(labelpattern);
+	if(it == pending.end()){
+	    it = pending.insert(make_pair(labelpattern, (int) tuples.size())).first;
+	    newpatterns.push_back(labelpattern);
+	    vector<int> tuple(labelpattern.size());
+	    for (int i=0; i<labelpattern.size(); i++)
+		tuple[i] = labelpattern[i] - '0';
+	    tuples.push_back(tuple);
 	}
-	else{
-	    PhyloTree temp(*tree);
-	    double score = temp.pruningAlgor(labelpattern, evo_base);
-	    score=score * evo.getPhyloFactor();
-	    cache::addToHash(labelpattern, score);
-	    tree_score += score;
+	batchIdx[t] = it->second;
+    }
+    vector<double> scores;
+    if(!tuples.empty()){
+	tree->pruningAlgor(tuples, evo_base, scores);
+	for(int i=0; i<newpatterns.size(); i++){
+	    scores[i] = scores[i] * evo.getPhyloFactor();
+	    cache::addToHash(newpatterns[i], scores[i]);
 	}
     }
+    for(t=0; t<patternScores.size(); t++)
+	tree_score += (batchIdx[t] < 0)? patternScores[t] : scores[batchIdx[t]];
     return tree_score;
 }
 
@@ -291,7 +314,7 @@ string OrthoGraph::getLabelpattern(OrthoExon &ex){
 	    labelpattern += "2";
 	}
 	else {
-	    map<string, Node*>::iterator it = graphs.at(i)->existingNodes.find(graphs.at(i)->getKey(ex.orthoex.at(i)));
+	    map<NodeKey, Node*>::iterator it = graphs.at(i)->existingNodes.find(graphs.at(i)->getKey(ex.orthoex.at(i)));
 	    if (it != graphs.at(i)->existingNodes.end()){
 		bool label = it->second->label;
 		if (label == 1){
@@ -302,7 +325,7 @@ string OrthoGraph::getLabelpattern(OrthoExon &ex){
 		}
 	    }
 	    else
-		throw ProjectError("Error in OrthoExon::getKey: exon " + graphs.at(i)->getKey(ex.orthoex.at(i)) +" not in graph!");
+		throw ProjectError("Error in OrthoExon::getKey: exon " + to_string(graphs.at(i)->getKey(ex.orthoex.at(i))) +" not in graph!");
 	}
     }
     if ( ex.labelpattern != labelpattern){
@@ -379,27 +402,173 @@ vector<Move*> OrthoGraph::majorityRuleMove(OrthoExon &orthoex, int shift_size){
     return orthomove;
 }
 
-map<string, Score> cache::labelscore; //stores score of prunning algorithm for each pattern (leaf labeling)
+namespace cache{
+
+    /*
+     * one part of the cache: the patterns in the order of their last use (most recent first)
+     * and a hash table from the keys to their positions in that list
+     */
+    struct Shard{
+	typedef list<pair<Key, Score> > EntryList;
+	boost::mutex mutex;
+	EntryList entries;
+	boost::unordered_map<Key, EntryList::iterator> index;
+	long hits, misses, evictions;
+	Shard() : hits(0), misses(0), evictions(0) {}
+    };
+
+    Shard shards[NUMSHARDS];
+    size_t patternLength = 0;
+    size_t maxShardSize = 1000000/NUMSHARDS;
+
+    // false if the pattern does not fit into a key
+    bool getKey(const string &labelpattern, Key &key){
+	if(labelpattern.size() > MAXSPECIES)
+	    return false;
+	key = 0;
+	for(int i=0; i<labelpattern.size(); i++)
+	    key |= (Key)(labelpattern[i] - '0') << (2*i);
+	return true;
+    }
+
+    string getLabelpattern(Key key){
+	string labelpattern(patternLength, '0');
+	for(int i=0; i<patternLength; i++)
+	    labelpattern[i] += (key >> (2*i)) & 3;
+	return labelpattern;
+    }
+
+    // multiplicative hashing, the keys use only 3 of the 4 values of each 2 bits
+    Shard &getShard(Key key){
+	return shards[((key * 0x9E3779B97F4A7C15ULL) >> 32) % NUMSHARDS];
+    }
+
+    bool comparePatterns(const pair<string, Score> &a, const pair<string, Score> &b){
+	return a.first < b.first;
+    }
+}
+
+void cache::init(size_t numSpecies, size_t maxSize){
+    patternLength = numSpecies;
+    maxShardSize = (maxSize + NUMSHARDS - 1)/NUMSHARDS;
+    if(maxShardSize < 1)
+	maxShardSize = 1;
+    if(numSpecies > MAXSPECIES)
+	cerr << "Warning: label patterns of more than " << MAXSPECIES << " species are not cached." << endl;
+}
 
 bool cache::inHash(string labelpattern){
-    return ( labelscore.find(labelpattern) != labelscore.end() );
+    double score;
+    return lookup(labelpattern, score);
+}
+
+bool cache::lookup(string labelpattern, double &score){
+    Key key;
+    if(!getKey(labelpattern, key))
+	return false;
+    Shard &shard = getShard(key);
+    boost::mutex::scoped_lock lock(shard.mutex);
+    boost::unordered_map<Key, Shard::EntryList::iterator>::iterator it = shard.index.find(key);
+    if(it == shard.index.end()){
+	shard.misses++;
+	return false;
+    }
+    shard.hits++;
+    shard.entries.splice(shard.entries.begin(), shard.entries, it->second); // most recently used
+    score = it->second->second.treescore;
+    return true;
 }
 
 void cache::addToHash(string labelpattern, double score){
+    Key key;
+    if(!getKey(labelpattern, key))
+	return;
+    Shard &shard = getShard(key);
+    boost::mutex::scoped_lock lock(shard.mutex);
+    boost::unordered_map<Key, Shard::EntryList::iterator>::iterator it = shard.index.find(key);
+    if(it != shard.index.end()){
+	it->second->second = Score();
+	it->second->second.treescore = score;
+	shard.entries.splice(shard.entries.begin(), shard.entries, it->second);
+	return;
+    }
+    if(shard.entries.size() >= maxShardSize){ // remove the least recently used pattern
+	shard.index.erase(shard.entries.back().first);
+	shard.entries.pop_back();
+	shard.evictions++;
+    }
     Score s;
     s.treescore = score;
-    labelscore[labelpattern] = s;
-
+    shard.entries.push_front(make_pair(key, s));
+    shard.index[key] = shard.entries.begin();
 }
 
 void cache::resetCounter(){
 
-    for(map<string, Score>::iterator it = labelscore.begin(); it != labelscore.end(); it++){
-	it->second.count = 0;
+    for(int i=0; i<NUMSHARDS; i++){
+	boost::mutex::scoped_lock lock(shards[i].mutex);
+	for(Shard::EntryList::iterator it = shards[i].entries.begin(); it != shards[i].entries.end(); it++){
+	    it->second.count = 0;
+	}
     }
 
 }
 
+double cache::getScore(string labelpattern){
+    double score = 0;
+    lookup(labelpattern, score);
+    return score;
+}
+
+void cache::incrementCounter(string labelpattern){
+    Key key;
+    if(!getKey(labelpattern, key))
+	return;
+    Shard &shard = getShard(key);
+    boost::mutex::scoped_lock lock(shard.mutex);
+    boost::unordered_map<Key, Shard::EntryList::iterator>::iterator it = shard.index.find(key);
+    if(it != shard.index.end())
+	it->second->second.count++;
+}
+
+void cache::getEntries(vector<pair<string, Score> > &entries){
+    entries.clear();
+    for(int i=0; i<NUMSHARDS; i++){
+	boost::mutex::scoped_lock lock(shards[i].mutex);
+	for(Shard::EntryList::iterator it = shards[i].entries.begin(); it != shards[i].entries.end(); it++){
+	    entries.push_back(make_pair(getLabelpattern(it->first), it->second));
+	}
+    }
+    sort(entries.begin(), entries.end(), comparePatterns);
+}
+
+void cache::getStatistics(long &hits, long &misses, long &evictions){
+    hits = misses = evictions = 0;
+    for(int i=0; i<NUMSHARDS; i++){
+	boost::mutex::scoped_lock lock(shards[i].mutex);
+	hits += shards[i].hits;
+	misses += shards[i].misses;
+	evictions += shards[i].evictions;
+    }
+}
+
+void cache::setStatistics(long hits, long misses, long evictions){
+    for(int i=0; i<NUMSHARDS; i++){
+	boost::mutex::scoped_lock lock(shards[i].mutex);
+	shards[i].hits = shards[i].misses = shards[i].evictions = 0;
+    }
+    shards[0].hits = hits;
+    shards[0].misses = misses;
+    shards[0].evictions = evictions;
+}
+
+void cache::printStatistics(){
+    long hits, misses, evictions;
+    getStatistics(hits, misses, evictions);
+    cout << "# label pattern cache: " << hits << " hits, " << misses << " misses, "
+	 << evictions << " evictions" << endl;
+}
+
 
 void OrthoGraph::printCache(list<OrthoExon> &ortho){
 
@@ -417,7 +586,9 @@ void OrthoGraph::printCache(list<OrthoExon> &ortho){
     cout.width(12); cout << "score";
     cout.width(4); cout << "#" << endl;
 
-    for(map<string, Score>::iterator it = cache::labelscore.begin(); it != cache::labelscore.end(); it++){
+    vector<pair<string, Score> > entries;
+    cache::getEntries(entries);
+    for(vector<pair<string, Score> >::iterator it = entries.begin(); it != entries.end(); it++){
 
 	cout.width(4); cout << it->first;
 	cout.width(12); cout << it->second.treescore;
@@ -427,12 +598,6 @@ void OrthoGraph::printCache(list<OrthoExon> &ortho){
     cout << "*************************************************************************" << endl;
 }
 
-double cache::getScore(string labelpattern){
-    return labelscore[labelpattern].treescore;
-}
-void cache::incrementCounter(string labelpattern){
-    labelscore[labelpattern].count++;
-}
 
 
 vector<ofstream*> initOutputFiles(string extension){
@@ -475,6 +640,13 @@ void closeOutputFiles(vector<ofstream*> filestreams){
     }
 }
 
+void flushOutputFiles(const vector<ofstream*> &filestreams){
+    for(size_t pos = 0; pos < filestreams.size(); pos++){
+	if(filestreams[pos])
+	    filestreams[pos]->flush();
+    }
+}
+
 void OrthoGraph::printHTMLgBrowse(OrthoExon &ex){
 
     for (int j=0; j<ex.orthoex.size(); j++) {
@@ -634,10 +806,18 @@ double OrthoGraph::treeMAPInf(ExonEvo &evo){
     double score=0;
     double k =evo.getPhyloFactor(); //scaling factor 
 
+    vector<vector<int> > labels;
+    vector<vector<double> > weights;
     for(list<OrthoExon>::iterator hects = all_orthoex.begin(); hects != all_orthoex.end(); hects++){
-	PhyloTree temp(*tree);
-	Evo *evo_base = &evo;
-	score += temp.MAP(hects->labels, hects->weights, evo_base, k);
+	labels.push_back(hects->labels);
+	weights.push_back(hects->weights);
+    }
+    vector<double> scores;
+    tree->MAP(labels, weights, &evo, scores, k);
+    int t = 0;
+    for(list<OrthoExon>::iterator hects = all_orthoex.begin(); hects != all_orthoex.end(); hects++, t++){
+	hects->labels = labels[t];
+	score += scores[t];
     }
     return score;
 }
@@ -647,18 +827,22 @@ double OrthoGraph::makeConsistent(ExonEvo &evo){
     double score = 0;
     double k =evo.getPhyloFactor(); //scaling factor 
 
+    vector<vector<int> > labels;
+    vector<vector<double> > weights;
     for(list<OrthoExon>::iterator hects = all_orthoex.begin(); hects != all_orthoex.end(); hects++){
-	PhyloTree temp(*tree);
-	Evo *evo_base = &evo;
-	vector<int> labels(numSpecies,2);
+	labels.push_back(vector<int>(numSpecies,2));
 	for(int pos=0; pos < hects->orthonode.size(); pos++){
 	    if(hects->orthonode[pos])
-		labels[pos] = hects->orthonode[pos]->label;
+		labels.back()[pos] = hects->orthonode[pos]->label;
 	}
-	score += temp.MAP(labels, hects->weights, evo_base, k, true);
+	weights.push_back(hects->weights);
     }
+    vector<double> scores;
+    tree->MAP(labels, weights, &evo, scores, k, true);
+    for(int t=0; t<scores.size(); t++)
+	score += scores[t];
     return score;
-}	
+}
 
 void OrthoGraph::printSummary(){
     map<string,int> mymap;
@@ -270,6 +270,87 @@ double PhyloTree::pruningAlgor(vector<int> &tuple, Evo *evo, int u){
     return log(tree_score);
 }
 
+void PhyloTree::getNodeArray(vector<Treenode*> &nodes, vector<vector<int> > &children) const {
+    nodes.assign(treenodes.begin(), treenodes.end());
+    map<const Treenode*, int> index;
+    for(int v=0; v<nodes.size(); v++)
+	index[nodes[v]] = v;
+    children.assign(nodes.size(), vector<int>());
+    for(int v=0; v<nodes.size(); v++){
+	for(list<Treenode*>::const_iterator it = nodes[v]->children.begin(); it != nodes[v]->children.end(); it++){
+	    children[v].push_back(index[*it]);
+	}
+    }
+}
+
+void PhyloTree::pruningAlgor(const vector<vector<int> > &tuples, Evo *evo, vector<double> &loglik, int u){
+    int states = evo->getNumStates();
+    int n = tuples.size();
+    loglik.assign(n, 0.0);
+    if(n == 0 || treenodes.empty())
+	return;
+    vector<Treenode*> nodes;
+    vector<vector<int> > children;
+    getNodeArray(nodes, children);
+
+    vector<double> tables(nodes.size() * states * n, 0.0); // [node][state][tuple]
+    vector<double> P(states * states);
+    vector<double> sum(n);
+    for(int v=0; v<nodes.size(); v++){
+	double *table = &tables[v * states * n];
+	if(nodes[v]->isLeaf()){
+	    // initialization
+	    int pos = rsa->getIdx(nodes[v]->getSpecies());
+	    for(int t=0; t<n; t++){
+		int c = tuples[t][pos];
+		if(c >= states || c < 0){ // in the case of unknown characters, we sum over all possibilities
+		    for(int i=0; i<states; i++)
+			table[i * n + t] = 1;
+		}
+		else{
+		    table[c * n + t] = 1;
+		}
+	    }
+	}
+	else{
+	    //recursion for the interior nodes
+	    for(int i=0; i<states * n; i++)
+		table[i] = 1.0;
+	    for(int ch=0; ch<children[v].size(); ch++){
+		int w = children[v][ch];
+		const double *childTable = &tables[w * states * n];
+		gsl_matrix *M = evo->getSubMatrixP(u, nodes[w]->getDist());
+		for(int i=0; i<states; i++)
+		    for(int j=0; j<states; j++)
+			P[i * states + j] = gsl_matrix_get(M, i, j);
+		for(int i=0; i<states; i++){
+		    for(int t=0; t<n; t++)
+			sum[t] = 0;
+		    for(int j=0; j<states; j++){
+			double p = P[i * states + j];
+			const double *c = childTable + j * n;
+			for(int t=0; t<n; t++)
+			    sum[t] += p * c[t];
+		    }
+		    double *score = table + i * n;
+		    for(int t=0; t<n; t++)
+			score[t] *= sum[t];
+		}
+	    }
+	}
+    }
+    //in the root, we take the weighted average over all states
+    const double *root = &tables[(nodes.size()-1) * states * n];
+    vector<double> tree_score(n, 0.0);
+    for(int i=0; i<states; i++){
+	double pi = evo->getPi(i);
+	for(int t=0; t<n; t++)
+	    tree_score[t] += pi * root[i * n + t];
+    }
+    for(int t=0; t<n; t++)
+	loglik[t] = log(tree_score[t]);
+}
+
 void PhyloTree::printRecursionTable() const{
 
     cout<<"+-------------------------------------------------------------------+\n";
@@ -461,6 +542,141 @@ void PhyloTree::MAPbacktrack(vector<int> &labels, Treenode* root, int bestAssign
     }
 }
 
+void PhyloTree::MAP(vector<vector<int> > &labels, const vector<vector<double> > &weights, Evo *evo,
+		    vector<double> &scores, double k, bool fixLeafLabels){
+
+    int states = evo->getNumStates();
+    scores.assign(labels.size(), -std::numeric_limits<double>::max());
+    // group the tuples by the species whose exon does not exist
+    map<vector<bool>, vector<int> > groups;
+    for(int t=0; t<labels.size(); t++){
+	vector<bool> missing(labels[t].size());
+	for(int pos=0; pos<labels[t].size(); pos++)
+	    missing[pos] = (labels[t][pos] >= states || labels[t][pos] < 0);
+	groups[missing].push_back(t);
+    }
+    for(map<vector<bool>, vector<int> >::iterator g = groups.begin(); g != groups.end(); g++){
+	// remove their leaves from a copy of the tree in the same order as MAP() of a single tuple
+	PhyloTree temp(*this);
+	vector<Treenode*> drops;
+	for(list<Treenode*>::iterator node = temp.treenodes.begin(); node != temp.treenodes.end(); node++){
+	    if((*node)->isLeaf() && g->first[rsa->getIdx((*node)->getSpecies())])
+		drops.push_back(*node);
+	}
+	for(int d=0; d<drops.size(); d++)
+	    temp.drop(drops[d], evo);
+	temp.MAP(g->second, labels, weights, evo, scores, k, fixLeafLabels);
+    }
+}
+
+void PhyloTree::MAP(const vector<int> &group, vector<vector<int> > &labels, const vector<vector<double> > &weights,
+		    Evo *evo, vector<double> &scores, double k, bool fixLeafLabels){
+
+    int states = evo->getNumStates();
+    int n = group.size();
+    if(n == 0 || treenodes.empty())
+	return;
+    vector<Treenode*> nodes;
+    vector<vector<int> > children;
+    getNodeArray(nodes, children);
+
+    vector<double> tables(nodes.size() * states * n); // [node][state][tuple]
+    vector<int> bestAssign(nodes.size() * states * n, -1); // [child][state of the parent][tuple]
+    vector<double> logP(states * states);
+    vector<double> maxScore(n);
+    for(int v=0; v<nodes.size(); v++){
+	double *table = &tables[v * states * n];
+	if(nodes[v]->isLeaf()){
+	    // initialization
+	    int pos = rsa->getIdx(nodes[v]->getSpecies());
+	    for(int t=0; t<n; t++){
+		double weight = weights[group[t]][pos];
+		if(fixLeafLabels){
+		    int c = labels[group[t]][pos];
+		    for(int i=0; i<states; i++)
+			table[i * n + t] = -std::numeric_limits<double>::max();
+		    table[c * n + t] = weight*c;
+		}
+		else{
+		    for(int i=0; i<states; i++)
+			table[i * n + t] = 0;
+		    table[1 * n + t] = weight;
+		}
+	    }
+	}
+	else{
+	    //recursion for the interior nodes
+	    for(int i=0; i<states * n; i++)
+		table[i] = 0.0;
+	    for(int ch=0; ch<children[v].size(); ch++){
+		int w = children[v][ch];
+		const double *childTable = &tables[w * states * n];
+		gsl_matrix *M = evo->getSubMatrixLogP(0, nodes[w]->getDist());
+		for(int i=0; i<states; i++)
+		    for(int j=0; j<states; j++)
+			logP[i * states + j] = k*gsl_matrix_get(M, i, j);
+		for(int i=0; i<states; i++){
+		    int *best = &bestAssign[(w * states + i) * n];
+		    for(int t=0; t<n; t++)
+			maxScore[t] = -std::numeric_limits<double>::max();
+		    for(int j=0; j<states; j++){
+			double p = logP[i * states + j];
+			const double *c = childTable + j * n;
+			for(int t=0; t<n; t++){
+			    double branch_score = p + c[t];
+			    if(maxScore[t] < branch_score){
+				maxScore[t] = branch_score;
+				best[t] = j;
+			    }
+			}
+		    }
+		    double *score = table + i * n;
+		    for(int t=0; t<n; t++)
+			score[t] += maxScore[t];
+		}
+	    }
+	}
+    }
+
+    int root = nodes.size() - 1;
+    const double *rootTable = &tables[root * states * n];
+    vector<int> stack; // of nodes
+    vector<int> assign(nodes.size());
+    for(int t=0; t<n; t++){
+	double max = -std::numeric_limits<double>::max();
+	int rootAssign = -1;
+	for(int i=0; i<states; i++){
+	    double root_score = (k*evo->getLogPi(i)) + rootTable[i * n + t];
+	    if(max < root_score){
+		max = root_score;
+		rootAssign = i;
+	    }
+	}
+	scores[group[t]] = max;
+	// backtracking to assign leaf nodes to the MAP labels
+	vector<int> &tupleLabels = labels[group[t]];
+	assign[root] = rootAssign;
+	stack.push_back(root);
+	while(!stack.empty()){
+	    int v = stack.back();
+	    stack.pop_back();
+	    if(nodes[v]->isLeaf()){
+		int pos = rsa->getIdx(nodes[v]->getSpecies());
+		if(fixLeafLabels && assign[v] != tupleLabels[pos])
+		    throw ProjectError("in MAP: fixLeafNodes is one but different node labels");
+		tupleLabels[pos] = assign[v];
+	    }
+	    else{
+		for(int ch=0; ch<children[v].size(); ch++){
+		    int w = children[v][ch];
+		    assign[w] = bestAssign[(w * states + assign[v]) * n + t];
+		    stack.push_back(w);
+		}
+	    }
+	}
+    }
+}
+
 // calculate diversity (sum of branch lengths) of the subtree induced by a HECT
 double PhyloTree::sumBranches(OrthoExon &oe){
 
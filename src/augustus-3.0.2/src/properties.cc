@@ -44,6 +44,8 @@ const char* Properties::parameternames[NUMPARNAMES]=
 "/augustus/verbosity",
 "/BaseCount/weighingType",
 "/BaseCount/weightMatrixFile",
+"beam",
+"beamCheck",
 "bridge_genicpart_bonus",
 "canCauseAltSplice",
 "capthresh",
@@ -67,6 +69,14 @@ const char* Properties::parameternames[NUMPARNAMES]=
 "/CompPred/phylo_factor",
 "/CompPred/dd_factor",
 "/CompPred/dualdecomp",
+"/CompPred/labelCacheSize",
+"/CompPred/matrixCacheDir",
+"/CompPred/mafRegion",
+"/CompPred/mafBySeq",
+"/CompPred/speciesThreads",
+"/CompPred/seqCacheSize",
+"/CompPred/omega",
+"/CompPred/omegaThreads",
 "/Constant/almost_identical_maxdiff",
 "/Constant/amberprob",
 "/Constant/ass_end",
@@ -102,6 +112,7 @@ const char* Properties::parameternames[NUMPARNAMES]=
 "CRFtrainSS",
 "CRFtrainUTR",
 "CRFtrainTIS",
+"cv",
 "dbaccess",
 "dbhints",
 "/EHMMTraining/state00",
@@ -225,6 +236,7 @@ SINGLESTRAND_KEY,
 "stopCodonExcludedFromCDS",
 "strand",
 "temperature",
+"threads",
 "tieIgenicIntron",
 "translation_table",
 "treefile",
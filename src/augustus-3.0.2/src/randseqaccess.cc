@@ -19,7 +19,9 @@
 #include <iostream>
 #include <iomanip> 
 #include <fstream>
+#include <set>
 #include <types.hh>
+#include <boost/thread.hpp>
 
 #ifdef AMYSQL
 #include <table_structure.h>
@@ -226,6 +228,12 @@ int RandSeqAccess::getChrLen(int idx, string chrName){
     }
 }
 
+void RandSeqAccess::getSeqs(const vector<SeqWindow> &windows, vector<AnnoSequence*> &seqs){
+    seqs.clear();
+    for (int i=0; i < windows.size(); i++)
+	seqs.push_back(getSeq(windows[i].speciesname, windows[i].chrName, windows[i].start, windows[i].end, windows[i].strand));
+}
+
 void RandSeqAccess::printStats(){
     cout << "number of species" << numSpecies << endl;
     for (int s=0; s<numSpecies; s++){
@@ -255,6 +263,16 @@ MemSeqAccess::MemSeqAccess(){
     /*
      * reading in exintrinsic evidence into memory
      */
+    vector<string> completeNames;
+    for(map<string, char*>::iterator it = sequences.begin(); it != sequences.end(); it++)
+	completeNames.push_back(it->first);
+    readHints(completeNames);
+}
+
+/*
+ * reads the hints file, if any, and reports on which of the sequences there are hints
+ */
+void RandSeqAccess::readHints(const vector<string> &completeNames){
     const char *extrinsicfilename;
     try {
 	extrinsicfilename =  Properties::getProperty("hintsfile");
@@ -269,8 +287,8 @@ MemSeqAccess::MemSeqAccess(){
 	// print Seqs for which hints are given
 	cout << "We have hints for"<<endl;
 	bool seqsWithInfo = false;
-	for(map<string, char*>::iterator it = sequences.begin(); it != sequences.end(); it++){
-	    string completeName=it->first;
+	for(int i=0; i < completeNames.size(); i++){
+	    string completeName=completeNames[i];
 	    size_t pos = completeName.find('.');
 	    string speciesname = completeName.substr(0,pos);
 	    FeatureCollection *fc = extrinsicFeatures.getFeatureCollection(speciesname);
@@ -307,7 +325,13 @@ AnnoSequence* MemSeqAccess::getSeq(string speciesname, string chrName, int start
 }
 
 SequenceFeatureCollection* MemSeqAccess::getFeatures(string speciesname, string chrName, int start, int end, Strand strand){
+    return getHints(speciesname, chrName, start, end, strand);
+}
 
+/*
+ * the hints in [start,end] from the hints file, the same for all types of RandSeqAccess that read it
+ */
+SequenceFeatureCollection* RandSeqAccess::getHints(string speciesname, string chrName, int start, int end, Strand strand){
     string key = speciesname + "." + chrName;
     FeatureCollection *fc = extrinsicFeatures.getFeatureCollection(speciesname);
     SequenceFeatureCollection *c=fc->getSequenceFeatureCollection(key);
@@ -322,6 +346,377 @@ SequenceFeatureCollection* MemSeqAccess::getFeatures(string speciesname, string
     return sfc;
 }
 
+TwoBitSeqAccess::TwoBitSeqAccess(){
+    cout << "reading in file names for species from " << Constant::speciesfilenames << endl;
+    map<string,string> filenames = getFileNames (Constant::speciesfilenames);
+    map<string,TwoBitFile*> byFilename;
+    map<TwoBitFile*,int> numSpeciesOfFile;
+    try {
+	for(map<string, string>::iterator it = filenames.begin(); it != filenames.end(); it++){
+	    map<string,TwoBitFile*>::iterator fit = byFilename.find(it->second);
+	    if (fit == byFilename.end()) {
+		cout << "mapping " << it->second << " into memory" << endl;
+		TwoBitFile *file = new TwoBitFile(it->second);
+		distinctFiles.push_back(file);
+		fit = byFilename.insert(pair<string,TwoBitFile*>(it->second, file)).first;
+	    }
+	    files[it->first] = fit->second;
+	    numSpeciesOfFile[fit->second]++;
+	}
+    } catch (...) {
+	for (int i=0; i < distinctFiles.size(); i++)
+	    delete distinctFiles[i];
+	throw;
+    }
+    /*
+     * reading in exintrinsic evidence into memory
+     */
+    vector<string> completeNames;
+    for(map<string, TwoBitFile*>::iterator it = files.begin(); it != files.end(); it++){
+	vector<string> seqnames;
+	it->second->getSeqNames(seqnames);
+	string prefix = it->first + ".";
+	for (int i=0; i < seqnames.size(); i++){
+	    if (seqnames[i].compare(0, prefix.length(), prefix) == 0)
+		completeNames.push_back(seqnames[i]);
+	    else if (numSpeciesOfFile[it->second] == 1)
+		completeNames.push_back(prefix + seqnames[i]);
+	}
+    }
+    readHints(completeNames);
+}
+
+TwoBitSeqAccess::~TwoBitSeqAccess(){
+    for (int i=0; i < distinctFiles.size(); i++)
+	delete distinctFiles[i];
+}
+
+/*
+ * name of the sequence in the .2bit file of the species, empty if there is none
+ */
+string TwoBitSeqAccess::getSeqKey(string speciesname, string chrName, TwoBitFile* &file){
+    map<string,TwoBitFile*>::iterator it = files.find(speciesname);
+    if (it == files.end())
+	return "";
+    file = it->second;
+    string key = speciesname + "." + chrName;
+    if (file->hasSeq(key))
+	return key;
+    if (file->hasSeq(chrName))
+	return chrName;
+    return "";
+}
+
+AnnoSequence* TwoBitSeqAccess::getSeq(string speciesname, string chrName, int start, int end, Strand strand){
+    TwoBitFile *file = NULL;
+    string key = getSeqKey(speciesname, chrName, file);
+    if (key.empty())
+	return NULL;
+    AnnoSequence *annoseq = new AnnoSequence();
+    annoseq->sequence = new char[end - start + 2];
+    if (!file->getSeq(key, start, end, annoseq->sequence)) { // range not within the sequence
+	delete annoseq;
+	return NULL;
+    }
+    annoseq->seqname = newstrcpy(chrName);
+    annoseq->length = end - start + 1;
+    annoseq->offset = start;
+    if(strand == minusstrand){
+	char *reverseDNA = reverseComplement(annoseq->sequence);
+	delete [] annoseq->sequence;
+	annoseq->sequence = reverseDNA;
+    }
+    return annoseq;
+}
+
+SequenceFeatureCollection* TwoBitSeqAccess::getFeatures(string speciesname, string chrName, int start, int end, Strand strand){
+    return getHints(speciesname, chrName, start, end, strand);
+}
+
+bool TwoBitSeqAccess::isTwoBitList(string listfile){
+    map<string,string> filenames = getFileNames(listfile);
+    int numTwoBit = 0;
+    for(map<string, string>::iterator it = filenames.begin(); it != filenames.end(); it++)
+	if (TwoBitFile::isTwoBit(it->second))
+	    numTwoBit++;
+    if (numTwoBit > 0 && numTwoBit < filenames.size())
+	throw ProjectError(listfile + " lists both .2bit and other genome files. Please convert all genomes with fa2twobit.");
+    return numTwoBit > 0;
+}
+
+bool CachedSeqAccess::ChunkKey::operator<(const ChunkKey &other) const {
+    if (hints != other.hints)
+	return hints < other.hints;
+    if (speciesIdx != other.speciesIdx)
+	return speciesIdx < other.speciesIdx;
+    if (chunk != other.chunk)
+	return chunk < other.chunk;
+    return chrName < other.chrName;
+}
+
+CachedSeqAccess::CachedSeqAccess(RandSeqAccess *backend, size_t maxBytes) :
+    backend(backend), maxBytes(maxBytes), usedBytes(0), prefetcher(NULL), prefetchHints(false),
+    seqHits(0), seqMisses(0), hintHits(0), hintMisses(0), numPrefetched(0), numEvicted(0) {}
+
+CachedSeqAccess::~CachedSeqAccess(){
+    waitForPrefetch();
+    delete backend;
+}
+
+/*
+ * true if the window lies on a sequence of known length, so that it can be split into chunks
+ */
+bool CachedSeqAccess::inChunks(string speciesname, string chrName, int start, int end, int &speciesIdx){
+    speciesIdx = getIdx(speciesname);
+    if (speciesIdx < 0 || start < 0 || end < start)
+	return false;
+    map<string,int>::iterator it = chrLen[speciesIdx].find(chrName);
+    return it != chrLen[speciesIdx].end() && end < it->second;
+}
+
+int CachedSeqAccess::chunkEnd(const ChunkKey &key){
+    return min((key.chunk + 1) * CHUNKSIZE, chrLen[key.speciesIdx][key.chrName]) - 1;
+}
+
+/*
+ * the chunk from the cache, it becomes the most recently used one
+ */
+CachedSeqAccess::Chunk *CachedSeqAccess::findChunk(const ChunkKey &key){
+    map<ChunkKey, list<Chunk>::iterator>::iterator it = chunkIndex.find(key);
+    if (it == chunkIndex.end())
+	return NULL;
+    chunks.splice(chunks.begin(), chunks, it->second);
+    return &chunks.front();
+}
+
+/*
+ * moves the content of a fetched chunk into the cache and removes the least recently used
+ * chunks while the memory budget is exceeded
+ */
+CachedSeqAccess::Chunk *CachedSeqAccess::addChunk(Chunk &chunk){
+    chunks.push_front(Chunk(chunk.key));
+    Chunk &added = chunks.front();
+    added.ok = chunk.ok;
+    added.dna.swap(chunk.dna);
+    added.hints.swap(chunk.hints);
+    added.collection = chunk.collection;
+    added.bytes = sizeof(Chunk) + added.key.chrName.size() + added.dna.size();
+    for (int type = 0; type < added.hints.size(); type++)
+	added.bytes += added.hints[type].size() * (sizeof(Feature) + 64); // 64: rough size of the strings of a hint
+    chunkIndex[added.key] = chunks.begin();
+    usedBytes += added.bytes;
+    while (usedBytes > maxBytes && chunks.size() > 1) {
+	usedBytes -= chunks.back().bytes;
+	chunkIndex.erase(chunks.back().key);
+	chunks.pop_back();
+	numEvicted++;
+    }
+    return &added;
+}
+
+/*
+ * the sequence chunks of the windows that are not cached are fetched with one call of the backend
+ */
+void CachedSeqAccess::fetchSeqChunks(const vector<SeqWindow> &windows, bool prefetching){
+    vector<ChunkKey> missing;
+    vector<SeqWindow> chunkWindows;
+    set<ChunkKey> requested;
+    for (int i=0; i < windows.size(); i++) {
+	const SeqWindow &w = windows[i];
+	int speciesIdx;
+	if (!inChunks(w.speciesname, w.chrName, w.start, w.end, speciesIdx))
+	    continue;
+	for (int c = w.start / CHUNKSIZE; c <= w.end / CHUNKSIZE; c++) {
+	    ChunkKey key(false, speciesIdx, w.chrName, c);
+	    if (findChunk(key)) {
+		if (!prefetching)
+		    seqHits++;
+	    } else if (requested.insert(key).second) {
+		missing.push_back(key);
+		chunkWindows.push_back(SeqWindow(w.speciesname, w.chrName, c * CHUNKSIZE, chunkEnd(key)));
+	    }
+	}
+    }
+    if (missing.empty())
+	return;
+    if (prefetching)
+	numPrefetched += missing.size();
+    else
+	seqMisses += missing.size();
+    vector<AnnoSequence*> seqs;
+    backend->getSeqs(chunkWindows, seqs);
+    for (int i=0; i < missing.size(); i++) {
+	Chunk chunk(missing[i]);
+	if (seqs[i]) {
+	    chunk.dna = seqs[i]->sequence;
+	    chunk.ok = true;
+	    delete seqs[i];
+	}
+	addChunk(chunk);
+    }
+}
+
+/*
+ * the sequence of a window from the cached chunks, NULL if a chunk is not there (any more) or failed
+ */
+AnnoSequence *CachedSeqAccess::assembleSeq(const SeqWindow &w, int speciesIdx){
+    string dna;
+    dna.reserve(w.end - w.start + 1);
+    for (int c = w.start / CHUNKSIZE; c <= w.end / CHUNKSIZE; c++) {
+	Chunk *chunk = findChunk(ChunkKey(false, speciesIdx, w.chrName, c));
+	if (!chunk || !chunk->ok)
+	    return NULL;
+	int from = max(w.start, c * CHUNKSIZE);
+	int to = min(w.end, (c+1) * CHUNKSIZE - 1);
+	dna.append(chunk->dna, from - c * CHUNKSIZE, to - from + 1);
+    }
+    AnnoSequence *annoseq = new AnnoSequence();
+    annoseq->seqname = newstrcpy(w.chrName);
+    annoseq->sequence = newstrcpy(dna);
+    annoseq->length = w.end - w.start + 1;
+    annoseq->offset = w.start;
+    if(w.strand == minusstrand){
+	char *reverseDNA = reverseComplement(annoseq->sequence);
+	delete [] annoseq->sequence;
+	annoseq->sequence = reverseDNA;
+    }
+    return annoseq;
+}
+
+/*
+ * the hints of a chunk from the cache or, if they are not there, from the backend
+ * A chunk keeps all hints the backend returns for it: those that end in the chunk or, if the
+ * backend returns overlapping hints, also those that reach into the chunk from either side.
+ */
+CachedSeqAccess::Chunk *CachedSeqAccess::getHintChunk(const ChunkKey &key, bool prefetching){
+    Chunk *cached = findChunk(key);
+    if (cached) {
+	if (!prefetching)
+	    hintHits++;
+	return cached;
+    }
+    if (prefetching)
+	numPrefetched++;
+    else
+	hintMisses++;
+    Chunk chunk(key);
+    string speciesname = getSname(key.speciesIdx);
+    int chunkStart = key.chunk * CHUNKSIZE;
+    int end = chunkEnd(key);
+    SequenceFeatureCollection *sfc = backend->getFeatures(speciesname, key.chrName, chunkStart, end, plusstrand);
+    if (sfc) {
+	sfc->sortFeatureLists();
+	chunk.collection = sfc->collection;
+	chunk.hints.resize(NUM_FEATURE_TYPES);
+	for (int type = 0; type < NUM_FEATURE_TYPES; type++) {
+	    for (list<Feature>::iterator it = sfc->featureLists[type].begin(); it != sfc->featureLists[type].end(); it++) {
+		Feature f = *it;
+		f.start += chunkStart; // back to positions on the chromosome
+		f.end += chunkStart;
+		chunk.hints[type].push_back(f);
+	    }
+	}
+	chunk.ok = true;
+	delete sfc;
+    }
+    return addChunk(chunk);
+}
+
+AnnoSequence* CachedSeqAccess::getSeq(string speciesname, string chrName, int start, int end, Strand strand){
+    vector<SeqWindow> windows(1, SeqWindow(speciesname, chrName, start, end, strand));
+    vector<AnnoSequence*> seqs;
+    getSeqs(windows, seqs);
+    return seqs[0];
+}
+
+void CachedSeqAccess::getSeqs(const vector<SeqWindow> &windows, vector<AnnoSequence*> &seqs){
+    waitForPrefetch();
+    fetchSeqChunks(windows, false);
+    seqs.assign(windows.size(), NULL);
+    for (int i=0; i < windows.size(); i++) {
+	const SeqWindow &w = windows[i];
+	int speciesIdx;
+	if (inChunks(w.speciesname, w.chrName, w.start, w.end, speciesIdx))
+	    seqs[i] = assembleSeq(w, speciesIdx);
+	if (!seqs[i]) // let the backend handle or report it
+	    seqs[i] = backend->getSeq(w.speciesname, w.chrName, w.start, w.end, w.strand);
+    }
+}
+
+/*
+ * the same hints as the backend would return for the window
+ */
+SequenceFeatureCollection* CachedSeqAccess::getFeatures(string speciesname, string chrName, int start, int end, Strand strand){
+    waitForPrefetch();
+    int speciesIdx;
+    if (!inChunks(speciesname, chrName, start, end, speciesIdx))
+	return backend->getFeatures(speciesname, chrName, start, end, strand);
+    bool overlap = backend->featuresOverlap();
+    bool rc = (strand == minusstrand);
+    int firstChunk = start / CHUNKSIZE;
+    SequenceFeatureCollection *inWindow = NULL;
+    for (int c = firstChunk; c <= end / CHUNKSIZE; c++) {
+	Chunk *chunk = getHintChunk(ChunkKey(true, speciesIdx, chrName, c), false);
+	if (!chunk->ok) {
+	    delete inWindow;
+	    return backend->getFeatures(speciesname, chrName, start, end, strand);
+	}
+	if (!inWindow)
+	    inWindow = new SequenceFeatureCollection(chunk->collection);
+	for (int type = 0; type < NUM_FEATURE_TYPES; type++)
+	    for (list<Feature>::iterator it = chunk->hints[type].begin(); it != chunk->hints[type].end(); it++)
+		if (overlap) {
+		    // a hint is in every chunk it overlaps, take it from the first one in the window
+		    if (it->start <= end && it->end >= start && max(firstChunk, it->start / CHUNKSIZE) == c) {
+			Feature f = *it;
+			f.shiftCoordinates(start, end, rc); // positions in the window, as from the backend
+			inWindow->addFeature(f);
+		    }
+		} else if (it->end >= start && it->end <= end) // a hint is in the chunk where it ends
+		    inWindow->addFeature(*it);
+    }
+    if (overlap)
+	return inWindow;
+    SequenceFeatureCollection *sfc = new SequenceFeatureCollection(*inWindow, start, end, rc);
+    delete inWindow;
+    return sfc;
+}
+
+void CachedSeqAccess::prefetch(const vector<SeqWindow> &windows, bool withHints){
+    waitForPrefetch();
+    prefetchWindows = windows;
+    prefetchHints = withHints;
+    prefetcher = new boost::thread(&CachedSeqAccess::runPrefetch, this);
+}
+
+void CachedSeqAccess::runPrefetch(){
+    try {
+	fetchSeqChunks(prefetchWindows, true);
+	for (int i=0; prefetchHints && i < prefetchWindows.size(); i++) {
+	    const SeqWindow &w = prefetchWindows[i];
+	    int speciesIdx;
+	    if (!inChunks(w.speciesname, w.chrName, w.start, w.end, speciesIdx))
+		continue;
+	    for (int c = w.start / CHUNKSIZE; c <= w.end / CHUNKSIZE; c++)
+		getHintChunk(ChunkKey(true, speciesIdx, w.chrName, c), true);
+	}
+    } catch (...) {} // the request of the window will fail again and report the error
+}
+
+void CachedSeqAccess::waitForPrefetch(){
+    if (prefetcher) {
+	prefetcher->join();
+	delete prefetcher;
+	prefetcher = NULL;
+    }
+}
+
+void CachedSeqAccess::printStatistics(){
+    waitForPrefetch();
+    cout << "# sequence cache: " << seqHits << " hits, " << seqMisses << " misses (sequence chunks), "
+	 << hintHits << " hits, " << hintMisses << " misses (hint chunks), " << numPrefetched
+	 << " chunks prefetched, " << numEvicted << " evictions" << endl;
+}
 
 map<string,string> getFileNames (string listfile){
     map<string,string> filenames;
@@ -350,6 +745,7 @@ map<string,string> getFileNames (string listfile){
 
 DbSeqAccess::DbSeqAccess(){
 #ifdef AMYSQL
+    pool = NULL;
     dbaccess = Constant::dbaccess;
     split_dbaccess();
     if(Constant::MultSpeciesMode)
@@ -378,6 +774,12 @@ DbSeqAccess::DbSeqAccess(){
 #endif
 }
 
+DbSeqAccess::~DbSeqAccess(){
+#ifdef AMYSQL
+    delete pool;
+#endif
+}
+
 #ifndef AMYSQL
 AnnoSequence* DbSeqAccess::getSeq(string speciesname, string chrName, int start, int end, Strand strand){
     return NULL;
@@ -386,28 +788,10 @@ AnnoSequence* DbSeqAccess::getSeq(string speciesname, string chrName, int start,
 #else // AMYSQL
 
 /*
- * retrieve sequence directly from table genomes(seqid, dnaseq, seqname, start, end, species)
- * arguments and columns start and end are 0-based.
- *
- * database chunks:   |-------------||-------------||-------------||-------------||-------------|
- * requested segment:                      |--------------------------|
- *                                   |   start                       end
- *                             g[0].start                          | 
+ * cuts the segment start..end out of the database chunks g that overlap it, sorted by start
  */
-AnnoSequence* DbSeqAccess::getSeq(string speciesname, string chrName, int start, int end, Strand strand){
-    mysqlpp::StoreQueryResult store_res;
-    string dna, querystr;
-    mysqlpp::Query query = con.query();
-    query << "SELECT dnaseq,start,end FROM genomes as G,speciesnames as S,seqnames as N WHERE speciesname='" << speciesname << "' AND seqname='"
-	  << chrName << "' AND G.speciesid=S.speciesid AND S.speciesid=N.speciesid AND G.seqnr=N.seqnr AND start <= " << end << " AND end >= " << start << " ORDER BY start ASC";
-    querystr = query.str();
-    //cout << "Executing" << endl << querystr << endl;
-    vector<genomes> g;
-    query.storein(g);
-    
-    
-    AnnoSequence* annoseq = new AnnoSequence();
-    annoseq->seqname = newstrcpy(chrName);
+static AnnoSequence* assembleDbSeq(vector<genomes> &g, string chrName, int start, int end, Strand strand, string querystr){
+    string dna;
     if (g.empty())
 	throw ProjectError("Could not retrieve sequence from database using query:" + querystr);
     else if (g.size() == 1){ // segment overlaps a single dna chunk
@@ -451,12 +835,71 @@ AnnoSequence* DbSeqAccess::getSeq(string speciesname, string chrName, int start,
 	    }
 	}
     }
+    AnnoSequence* annoseq = new AnnoSequence();
+    annoseq->seqname = newstrcpy(chrName);
     annoseq->sequence = newstrcpy((strand == minusstrand)? reverseComplement(dna.c_str()) : dna.c_str());
     annoseq->length = end - start + 1;
     annoseq->offset = start;
     return annoseq;
 }
 
+/*
+ * retrieve sequence directly from table genomes(seqid, dnaseq, seqname, start, end, species)
+ * arguments and columns start and end are 0-based.
+ *
+ * database chunks:   |-------------||-------------||-------------||-------------||-------------|
+ * requested segment:                      |--------------------------|
+ *                                   |   start                       end
+ *                             g[0].start                          | 
+ */
+AnnoSequence* DbSeqAccess::getSeq(string speciesname, string chrName, int start, int end, Strand strand){
+    string querystr;
+    mysqlpp::ScopedConnection con(*getPool(), true);
+    mysqlpp::Query query = con->query();
+    query << "SELECT dnaseq,start,end FROM genomes as G,speciesnames as S,seqnames as N WHERE speciesname='" << speciesname << "' AND seqname='"
+	  << chrName << "' AND G.speciesid=S.speciesid AND S.speciesid=N.speciesid AND G.seqnr=N.seqnr AND start <= " << end << " AND end >= " << start << " ORDER BY start ASC";
+    querystr = query.str();
+    //cout << "Executing" << endl << querystr << endl;
+    vector<genomes> g;
+    query.storein(g);
+    return assembleDbSeq(g, chrName, start, end, strand, querystr);
+}
+
+/*
+ * retrieves the sequences of several windows with a single query, e.g. the windows of all species
+ * of a gene range or the chunks a CachedSeqAccess is missing, instead of one round trip per window
+ */
+void DbSeqAccess::getSeqs(const vector<SeqWindow> &windows, vector<AnnoSequence*> &seqs){
+    seqs.assign(windows.size(), NULL);
+    if (windows.empty())
+	return;
+    mysqlpp::ScopedConnection con(*getPool(), true);
+    mysqlpp::Query query = con->query();
+    query << "SELECT speciesname,seqname,dnaseq,start,end FROM genomes as G,speciesnames as S,seqnames as N WHERE "
+	  << "G.speciesid=S.speciesid AND S.speciesid=N.speciesid AND G.seqnr=N.seqnr AND (";
+    for (int i=0; i < windows.size(); i++) {
+	const SeqWindow &w = windows[i];
+	if (i > 0)
+	    query << " OR ";
+	query << "(speciesname='" << w.speciesname << "' AND seqname='" << w.chrName << "' AND start <= " << w.end << " AND end >= " << w.start << ")";
+    }
+    query << ") ORDER BY speciesname,seqname,start ASC";
+    string querystr = query.str();
+    mysqlpp::StoreQueryResult res = query.store();
+    // each window gets the database chunks that overlap it, sorted by start
+    vector<vector<genomes> > g(windows.size());
+    for (size_t r=0; r < res.num_rows(); r++) {
+	string species(res[r]["speciesname"].c_str()), seqname(res[r]["seqname"].c_str());
+	int chunkstart = res[r]["start"], chunkend = res[r]["end"];
+	for (int i=0; i < windows.size(); i++)
+	    if (windows[i].speciesname == species && windows[i].chrName == seqname
+		&& chunkstart <= windows[i].end && chunkend >= windows[i].start)
+		g[i].push_back(genomes(0, res[r]["dnaseq"].c_str(), seqname, chunkstart, chunkend, species));
+    }
+    for (int i=0; i < windows.size(); i++)
+	seqs[i] = assembleDbSeq(g[i], windows[i].chrName, windows[i].start, windows[i].end, windows[i].strand, querystr);
+}
+
 
 /*
  * coord_id is an identifier in table 'seq_region'.
@@ -470,7 +913,8 @@ AnnoSequence* DbSeqAccess::getSeq2(string speciesname, string chrName, int start
     AnnoSequence* annoseq = NULL;
     int coord_id, seq_region_id, seq_region_length; 
     vector<assembly> asm_query_region;
-    mysqlpp::Query detect_coord_id = con.query();
+    mysqlpp::ScopedConnection con(*getPool(), true);
+    mysqlpp::Query detect_coord_id = con->query();
     detect_coord_id << "select seq_region_id,coord_system_id,length from seq_region where name=\""
 		    << chrName << "\"";
     store_res = detect_coord_id.store();
@@ -537,7 +981,8 @@ SequenceFeatureCollection* DbSeqAccess::getFeatures(string speciesname, string c
     FeatureCollection* fc = extrinsicFeatures.getFeatureCollection(speciesname);
     SequenceFeatureCollection* sfc = new SequenceFeatureCollection(fc);
     if(extrinsicFeatures.withEvidence(speciesname)){ // only retrieve hints for the species specified in the extrinsicCfgFile
-	mysqlpp::Query query = con.query();
+	mysqlpp::ScopedConnection con(*getPool(), true);
+	mysqlpp::Query query = con->query();
 	query << "SELECT source,start,end,score,type,strand,frame,priority,grp,mult,esource FROM hints as H, speciesnames as S,seqnames as N WHERE speciesname='"
 	      << speciesname << "' AND seqname='" << chrName << "' AND H.speciesid=S.speciesid AND S.speciesid=N.speciesid AND H.seqnr=N.seqnr AND start <= "
 	      << end << " AND end >= " << start;
@@ -596,26 +1041,38 @@ int DbSeqAccess::split_dbaccess(){
 }
 
 void DbSeqAccess::connect_db(ostream& out){
-    const  char* db_name = db_information[0].c_str();
-    const  char* host = db_information[1].c_str();
-    const  char* user = db_information[2].c_str();
-    const  char* passwd = db_information[3].c_str();
+    if (db_information.size() < 4)
+	throw ProjectError("--dbaccess must be given as dbname,host,user,passwd, not " + dbaccess);
     try {
 	out << "# Opening database connection using connection data \"" << Constant::dbaccess << "\"...\t";
-	con.connect(db_name,host,user,passwd);
+	if (!pool)
+	    pool = new DbConnectionPool(db_information); // before any thread uses it
+	mysqlpp::ScopedConnection con(*getPool(), true); // the first connection, it stays open in the pool
+	if (!con)
+	    throw ProjectError("Could not connect to the database.");
 	out << "DB connection OK." << endl;
     }
-    catch(const mysqlpp::BadQuery& er){
-	out << "Query error: " << er.what() << endl;
+    catch(const mysqlpp::Exception& er){
+	throw ProjectError(string("Could not connect to the database: ") + er.what());
     }
 }
 
+/*
+ * the connections to the database. The pool is created in connect_db, before
+ * any other thread exists, so the threads only share it here.
+ */
+DbConnectionPool* DbSeqAccess::getPool(){
+    mysqlpp::Connection::thread_start(); // resources of the client library for this thread, if not there yet
+    return pool;
+}
+
 
 template<class T>
 AnnoSequence* DbSeqAccess::getNextDBSequence(string chrName,int start,int end,vector<T>& asm_query_region)
 {
     AnnoSequence* annoseq = new AnnoSequence();
-    mysqlpp::Query fetchseq_query=con.query();
+    mysqlpp::ScopedConnection con(*getPool(), true);
+    mysqlpp::Query fetchseq_query=con->query();
     mysqlpp::StoreQueryResult mysqlseq; // store the chunk in a StoreQueryResult container.
 
     //step1: concatenate all the chunks to a single sequence.
@@ -674,7 +1131,8 @@ AnnoSequence* DbSeqAccess::getNextDBSequence(string chrName,int start,int end,ve
  */
 template<class T>
 int DbSeqAccess::get_region_coord(int seq_region_id,int start,int end,vector<T> &asm_query_region){
-    mysqlpp::Query get_region_coord=con.query();
+    mysqlpp::ScopedConnection con(*getPool(), true);
+    mysqlpp::Query get_region_coord=con->query();
     try{
 	get_region_coord<<"select * from assembly where asm_seq_region_id=\""<<seq_region_id<<"\""
 			<<" and asm_start <= "<<end
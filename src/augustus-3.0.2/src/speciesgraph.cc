@@ -287,7 +287,7 @@ list<NodeType> SpeciesGraph::fromNeutralLine(Node *node){
 	}
     }
     else
-	throw ProjectError("in SpeciesGraph::fromNeutralLine(): node " + getKey(node)); 
+	throw ProjectError("in SpeciesGraph::fromNeutralLine(): node " + to_string(getKey(node))); 
     return fromTypes;
 }
 
@@ -328,7 +328,7 @@ NodeType SpeciesGraph::toNeutralLine(Node *node){
 	}
     }
     else
-	throw ProjectError("in SpeciesGraph::toNeutralLine(): node " +  getKey(node)); 
+	throw ProjectError("in SpeciesGraph::toNeutralLine(): node " +  to_string(getKey(node))); 
     return NOT_KNOWN;
 }
 
@@ -557,12 +557,12 @@ Node* SpeciesGraph::getNextExonOnPath(Node *node, size_t step){
  return node;
 }
 
-string SpeciesGraph::getKey(Node *n){
+NodeKey SpeciesGraph::getKey(Node *n){
 
     if(n->item == NULL)
-	return (itoa(n->begin) +  ":" + itoa((n->n_type)));
+	return NodeKey(n->begin, -1, n->n_type);
     else
-	return (itoa(n->begin) + ":" + itoa(n->end) + ":" + itoa( (int)(n->castToStateType()) )); 
+	return NodeKey(n->begin, n->end, n->castToStateType()); 
 }
 
 
@@ -39,17 +39,25 @@ const vector<StateType>*   StateModel::stateMap = NULL;
 int                        StateModel::activeWinLen = 1;
 int                        StateModel::gcIdx = 0;
 ContentStairs*             StateModel::cs = NULL;
+Double                     StateModel::beamFactor = 0.0;
+bool                       StateModel::beamActive = false;
+vector<Double>             StateModel::colBest;
 
 /* --- StateModel methods ------------------------------------------ */
 
 /*
  * initPredecessors
+ * build the list of predecessors for the current GC content class from the
+ * transition matrix of that class and make it the current one
  */
 void StateModel::initPredecessors(Matrix<Double>& trans, int self) {
-    ancestor.clear();
+    if (!GCancestor)
+	GCancestor = new vector<Ancestor>[Constant::decomp_num_steps];
+    usePredecessors();
+    ancestor->clear();
     for( int i = 0; i < trans.getColSize(); i++ )
         if( trans[i][self] != 0 ) 
-	    ancestor.push_back(Ancestor(i, trans[i][self]));
+	    ancestor->push_back(Ancestor(i, trans[i][self]));
 }
 
 /*
@@ -65,6 +73,12 @@ void StateModel::init() {
     // equalD state + MAX_LINKCOUNT times geometric states + splicesite states
     // add this to the maximum exon length
     activeWinLen = ExonModel::getMaxStateLen() + IntronModel::getD() + MAX_LINKCOUNT;
+
+    try {
+	double beam = Properties::getdoubleProperty("beam");
+	if (beam > 0.0)
+	    beamFactor = LLDouble::exp(-beam);
+    } catch (KeyNotFoundError &) {}
 }
 
 /**
@@ -199,6 +213,10 @@ void StateModel::prepareViterbi(const char* dna, int len,
     sequence = dna;
     dnalen = len;
     stateMap = &smap; // needed in exonmodel to determine predecessor type
+    IntronModel::clearSnippetProbs();
+    UtrModel::clearSnippetProbs();
+    if (hasBeam())
+	colBest.assign(len, 0.0);
     if (profileModel) {
 	PP::DNA::initSeq(dna, len);
 	profileModel->initScores();
@@ -214,6 +232,17 @@ void StateModel::readProbabilities(int newParIndex) {
     UtrModel::readProbabilities(newParIndex);
 }
 
+/*
+ * makeEmiTables
+ * (re)build the single precision emission tables from the current parameters
+ * must be called whenever the GC content dependent emission probabilities change
+ */
+void StateModel::makeEmiTables(){
+    ExonModel::makeEmiTables();
+    IntronModel::makeEmiTables();
+    IGenicModel::makeEmiTables();
+}
+
 void StateModel::resetPars(){
     ExonModel::resetPars();
     UtrModel::resetPars();
@@ -226,6 +255,7 @@ void StateModel::readAllParameters(){
   IntronModel::readAllParameters();
   IGenicModel::readAllParameters();
   UtrModel::readAllParameters();
+  makeEmiTables();
 }
 
 void StateModel::storeGCPars(int idx){
@@ -299,6 +329,41 @@ Double SnippetProbs::getElemSeqProb(int base, int len){
     return seqProb;
 }
 
+/*
+ * FloatEmiTable::init
+ */
+void FloatEmiTable::init(int numGC, int numFrames, int size){
+    delete [] probs;
+    this->numGC = numGC;
+    this->numFrames = numFrames;
+    this->size = size;
+    probs = new float[numGC * numFrames * size];
+    for (int i = 0; i < numGC * numFrames * size; i++)
+	probs[i] = 0.0;
+}
+
+/*
+ * FloatEmiTable::set
+ */
+void FloatEmiTable::set(int gcIdx, int frame, const vector<Double> &p){
+    if (gcIdx < 0 || gcIdx >= numGC || frame < 0 || frame >= numFrames || p.size() > size)
+	throw ProjectError("FloatEmiTable::set: Index out of range.");
+    float *f = probs + (gcIdx * numFrames + frame) * size;
+    for (int pn = 0; pn < p.size(); pn++)
+	f[pn] = (float) Double(p[pn]).doubleValue();
+}
+
+/*
+ * MotifTrack::MotifTrack
+ */
+MotifTrack::MotifTrack(Double (*prob)(int, bool), const char *dna, int n) : seq(dna), len(n) {
+    for (int strand = 0; strand < 2; strand++) {
+	probs[strand].resize(n);
+	for (int pos = 0; pos < n; pos++)
+	    probs[strand][pos] = prob(pos, strand == 0);
+    }
+}
+
 Double SnippetProbs::getSeqProb(int base, int len){
     Double p;
     if (len == 0)
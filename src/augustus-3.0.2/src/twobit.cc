@@ -0,0 +1,307 @@
+/**********************************************************************
+ * file:    twobit.cc
+ * licence: Artistic Licence, see file LICENCE.TXT or
+ *          http://www.opensource.org/licenses/artistic-license.php
+ * descr.:  genomes packed with 2 bits per base in a file of the UCSC .2bit format
+ *
+ **********************************************************************/
+
+#include "twobit.hh"
+
+// standard C/C++ includes
+#include <algorithm>
+#include <cstring>
+#include <cstdio>
+#include <sstream>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/*
+ * the 4 bases of each possible byte
+ */
+struct TwoBitDecodeTable {
+    TwoBitDecodeTable() {
+	static const char bases[] = "tcag";
+	for (int b=0; b < 256; b++)
+	    for (int i=0; i < 4; i++)
+		chars[b][i] = bases[(b >> (6 - 2*i)) & 3];
+    }
+    char chars[256][4];
+};
+static const TwoBitDecodeTable decodeTable;
+
+/*
+ * the file is written and read in the byte order of the machine, the signature
+ * tells whether a file was written on a machine with a different one
+ */
+static inline uint32_t get32(const unsigned char *p){
+    uint32_t v;
+    memcpy(&v, p, 4);
+    return v;
+}
+
+static inline uint64_t get64(const unsigned char *p){
+    uint64_t v;
+    memcpy(&v, p, 8);
+    return v;
+}
+
+static inline void put32(ostream &out, uint32_t v){
+    out.write((const char*) &v, 4);
+}
+
+static inline void put64(ostream &out, uint64_t v){
+    out.write((const char*) &v, 8);
+}
+
+static uint32_t swapBytes(uint32_t v){
+    return (v >> 24) | ((v >> 8) & 0xff00) | ((v << 8) & 0xff0000) | (v << 24);
+}
+
+TwoBitFile::TwoBitFile(string filename) : filename(filename), data(NULL), size(0) {
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0)
+	throw ProjectError("Could not open the .2bit file " + filename + ".");
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < 16) {
+	::close(fd);
+	throw ProjectError(filename + " is not a .2bit file.");
+    }
+    size = st.st_size;
+    void *m = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd); // the mapping remains
+    if (m == MAP_FAILED)
+	throw ProjectError("Could not map the .2bit file " + filename + " into memory.");
+    data = (unsigned char*) m;
+
+    try {
+	const unsigned char *p = data;
+	uint32_t signature = get32(p);
+	if (signature == swapBytes(SIGNATURE))
+	    throw ProjectError(filename + " was written on a machine with a different byte order. "
+			       "Please convert it again on this machine.");
+	if (signature != SIGNATURE)
+	    throw ProjectError(filename + " is not a .2bit file.");
+	uint32_t version = get32(p + 4);
+	if (version > 1)
+	    throw ProjectError(filename + " is of .2bit version " + itoa(version) + ", only versions 0 and 1 are supported.");
+	uint32_t seqCount = get32(p + 8);
+	p += 16;
+	// index: name and offset of the record of each sequence
+	for (uint32_t i=0; i < seqCount; i++) {
+	    checkRange(p, 1);
+	    int nameSize = *p++;
+	    checkRange(p, nameSize + (version == 0 ? 4 : 8));
+	    string name((const char*) p, nameSize);
+	    p += nameSize;
+	    uint64_t offset;
+	    if (version == 0) {
+		offset = get32(p);
+		p += 4;
+	    } else {
+		offset = get64(p);
+		p += 8;
+	    }
+	    if (offset >= size)
+		throw ProjectError(filename + " is truncated or not a .2bit file.");
+	    if (records.find(name) != records.end())
+		throw ProjectError(filename + " contains the sequence " + name + " more than once.");
+	    readRecord(data + offset, records[name]);
+	}
+    } catch (...) {
+	munmap(data, size);
+	throw;
+    }
+}
+
+TwoBitFile::~TwoBitFile(){
+    if (data)
+	munmap(data, size);
+}
+
+/*
+ * reads the header of a sequence record: length, N-blocks and mask blocks (ignored)
+ * the packed bases follow it
+ */
+const unsigned char *TwoBitFile::readRecord(const unsigned char *p, Record &rec) const {
+    checkRange(p, 8);
+    rec.dnaSize = get32(p);
+    uint32_t nBlockCount = get32(p + 4);
+    p += 8;
+    checkRange(p, 8 * (size_t) nBlockCount + 4);
+    rec.nStarts.resize(nBlockCount);
+    rec.nSizes.resize(nBlockCount);
+    for (uint32_t b=0; b < nBlockCount; b++) {
+	rec.nStarts[b] = get32(p + 4*b);
+	rec.nSizes[b] = get32(p + 4*(nBlockCount + b));
+    }
+    p += 8 * (size_t) nBlockCount;
+    uint32_t maskBlockCount = get32(p);
+    p += 4;
+    checkRange(p, 8 * (size_t) maskBlockCount + 4);
+    p += 8 * (size_t) maskBlockCount + 4; // mask blocks and reserved word
+    checkRange(p, (rec.dnaSize + 3) / 4);
+    rec.packed = p;
+    return p + (rec.dnaSize + 3) / 4;
+}
+
+void TwoBitFile::checkRange(const unsigned char *p, size_t len) const {
+    if (p < data || p + len > data + size)
+	throw ProjectError(filename + " is truncated or not a .2bit file.");
+}
+
+int TwoBitFile::getSeqLen(string seqname) const {
+    map<string, Record>::const_iterator it = records.find(seqname);
+    if (it == records.end())
+	return -1;
+    return it->second.dnaSize;
+}
+
+void TwoBitFile::getSeqNames(vector<string> &seqnames) const {
+    seqnames.clear();
+    for (map<string, Record>::const_iterator it = records.begin(); it != records.end(); ++it)
+	seqnames.push_back(it->first);
+}
+
+bool TwoBitFile::getSeq(string seqname, int start, int end, char *dna) const {
+    map<string, Record>::const_iterator it = records.find(seqname);
+    if (it == records.end() || start < 0 || end < start || end >= it->second.dnaSize)
+	return false;
+    const Record &rec = it->second;
+    char *d = dna;
+    int pos = start;
+    // decode byte by byte, partial bytes at both ends
+    for (; pos <= end && (pos & 3); pos++)
+	*d++ = decodeTable.chars[rec.packed[pos >> 2]][pos & 3];
+    for (; pos + 3 <= end; pos += 4, d += 4)
+	memcpy(d, decodeTable.chars[rec.packed[pos >> 2]], 4);
+    for (; pos <= end; pos++)
+	*d++ = decodeTable.chars[rec.packed[pos >> 2]][pos & 3];
+    *d = '\0';
+
+    // overwrite the N-blocks that overlap the range
+    int b = upper_bound(rec.nStarts.begin(), rec.nStarts.end(), start) - rec.nStarts.begin();
+    if (b > 0 && rec.nStarts[b-1] + rec.nSizes[b-1] > start)
+	b--;
+    for (; b < rec.nStarts.size() && rec.nStarts[b] <= end; b++) {
+	int from = max(rec.nStarts[b], start);
+	int to = min(rec.nStarts[b] + rec.nSizes[b] - 1, end);
+	if (from <= to)
+	    memset(dna + from - start, 'n', to - from + 1);
+    }
+    return true;
+}
+
+bool TwoBitFile::isTwoBit(string filename){
+    ifstream in(filename.c_str(), ios::binary);
+    unsigned char buf[4];
+    if (!in.read((char*) buf, 4))
+	return false;
+    uint32_t signature = get32(buf);
+    return signature == SIGNATURE || signature == swapBytes(SIGNATURE);
+}
+
+TwoBitWriter::TwoBitWriter(string filename) : filename(filename), numBases(0), closed(false) {
+    ostringstream name;
+    name << filename << ".tmp" << getpid();
+    tmpname = name.str();
+    tmp.open(tmpname.c_str(), ios::binary);
+    if (!tmp)
+	throw ProjectError("Could not write the temporary file " + tmpname + ".");
+}
+
+TwoBitWriter::~TwoBitWriter(){
+    if (!closed) {
+	tmp.close();
+	remove(tmpname.c_str());
+    }
+}
+
+/*
+ * appends the record of a sequence to the temporary file
+ */
+void TwoBitWriter::addSeq(string seqname, const char *dna, int len){
+    if (seqname.empty() || seqname.length() > 255)
+	throw ProjectError("Sequence name '" + seqname + "' is empty or longer than 255 characters.");
+    vector<uint32_t> nStarts, nSizes;
+    string packed((len + 3) / 4, '\0');
+    for (int i=0; i < len; i++) {
+	int code;
+	switch (dna[i]) {
+	    case 't': case 'T': code = 0; break;
+	    case 'c': case 'C': code = 1; break;
+	    case 'a': case 'A': code = 2; break;
+	    case 'g': case 'G': code = 3; break;
+	    default: // unknown base, packed as t
+		code = 0;
+		if (!nStarts.empty() && nStarts.back() + nSizes.back() == i)
+		    nSizes.back()++;
+		else {
+		    nStarts.push_back(i);
+		    nSizes.push_back(1);
+		}
+	}
+	packed[i >> 2] |= code << (6 - 2*(i & 3));
+    }
+    put32(tmp, len);
+    put32(tmp, nStarts.size());
+    for (int b=0; b < nStarts.size(); b++)
+	put32(tmp, nStarts[b]);
+    for (int b=0; b < nSizes.size(); b++)
+	put32(tmp, nSizes[b]);
+    put32(tmp, 0); // no mask blocks, the sequences are in lower case anyway
+    put32(tmp, 0); // reserved
+    tmp.write(packed.data(), packed.size());
+    if (!tmp)
+	throw ProjectError("Could not write the temporary file " + tmpname + ".");
+    names.push_back(seqname);
+    recordSizes.push_back(16 + 8 * (uint64_t) nStarts.size() + packed.size());
+    numBases += len;
+}
+
+/*
+ * The index precedes the records and holds their offsets, so it can only be
+ * written when all sequences are known.
+ */
+void TwoBitWriter::close(){
+    tmp.close();
+    uint64_t recordsSize = 0, indexSize = 0;
+    for (int i=0; i < names.size(); i++) {
+	recordsSize += recordSizes[i];
+	indexSize += 1 + names[i].length() + 4;
+    }
+    uint32_t version = 0;
+    if (16 + indexSize + recordsSize > 0xffffffffUL) {
+	version = 1; // 64 bit offsets
+	indexSize += 4 * names.size();
+    }
+    ofstream out(filename.c_str(), ios::binary);
+    if (!out)
+	throw ProjectError("Could not write the .2bit file " + filename + ".");
+    put32(out, TwoBitFile::SIGNATURE);
+    put32(out, version);
+    put32(out, names.size());
+    put32(out, 0); // reserved
+    uint64_t offset = 16 + indexSize;
+    for (int i=0; i < names.size(); i++) {
+	unsigned char nameSize = names[i].length();
+	out.write((const char*) &nameSize, 1);
+	out.write(names[i].data(), nameSize);
+	if (version == 0)
+	    put32(out, offset);
+	else
+	    put64(out, offset);
+	offset += recordSizes[i];
+    }
+    ifstream in(tmpname.c_str(), ios::binary);
+    if (recordsSize > 0)
+	out << in.rdbuf();
+    in.close();
+    out.close();
+    remove(tmpname.c_str());
+    closed = true;
+    if (!out)
+	throw ProjectError("Could not write the .2bit file " + filename + ".");
+}
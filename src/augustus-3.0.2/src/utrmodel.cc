@@ -78,8 +78,8 @@ vector<Double>  UtrModel::lenDist3Initial;    // Length distribution of initial
 vector<Double>  UtrModel::lenDist3Internal;   // Length distribution of internal exons 
 vector<Double>  UtrModel::lenDist3Terminal;   // Length distribution of terminal exons 
 vector<Double>  UtrModel::tailLenDist3Single; // Tail probabilities of the length distribution of single exons
-vector<Double>  UtrModel::tssProbsPlus;        // to store tss probabilities
-vector<Double>  UtrModel::tssProbsMinus;      // to store tss probabilities
+Double*         UtrModel::tssProbsPlus = NULL;  // to store tss probabilities
+Double*         UtrModel::tssProbsMinus = NULL; // to store tss probabilities
 Integer         UtrModel::max_exon_length;
 Integer         UtrModel::max3singlelength;
 Integer         UtrModel::max3termlength;
@@ -113,7 +113,12 @@ SnippetProbs*   UtrModel::rInitSnippetProbs5 = NULL;
 SnippetProbs*   UtrModel::rSnippetProbs5 = NULL;
 SnippetProbs*   UtrModel::rSnippetProbs3 = NULL;
 SnippetProbs*   UtrModel::intronSnippetProbs = NULL;
-bool            UtrModel::initAlgorithmsCalled = false;
+UtrGCCache*     UtrModel::GCcache = NULL;
+const PatMMGroup* UtrModel::curUtr5init_emiprobs = NULL;
+const PatMMGroup* UtrModel::curUtr5_emiprobs = NULL;
+const PatMMGroup* UtrModel::curUtr3_emiprobs = NULL;
+const vector<Double>* UtrModel::curTssup_emiprobs = NULL;
+bool            UtrModel::haveGCPars = false;
 bool            UtrModel::haveSnippetProbs = false;
 vector<Integer> UtrModel::aataaa_count;
 vector<Double>  UtrModel::aataaa_probs;
@@ -130,6 +135,7 @@ double          UtrModel::prUtr5Intron = 0.999;
 double          UtrModel::prUtr3Intron = 0.999;
 Double*         UtrModel::ttsProbPlus = NULL;
 Double*         UtrModel::ttsProbMinus = NULL;
+const Double*   UtrModel::cumEmiProbs[3][2] = {{NULL, NULL}, {NULL, NULL}, {NULL, NULL}};
 vector<Integer> UtrModel::distCountTata; // to model the distance distribution tata-box <-> tss
 int             UtrModel::lastParIndex = -1;
 int             UtrModel::verbosity;
@@ -152,17 +158,7 @@ UtrModel::~UtrModel( ){
 	delete tssMotifTATA;
 	delete ttsMotif;
 	delete tataMotif;
-	if (snippetProbs5) 
-	    delete snippetProbs5;
-	if (rInitSnippetProbs5)
-	    delete rInitSnippetProbs5;
-	if (rSnippetProbs5)
-	    delete rSnippetProbs5;
-	if (rSnippetProbs3)
-	    delete rSnippetProbs3;
-	if (intronSnippetProbs)
-	    delete intronSnippetProbs;
-
+	initSnippetProbs(); // deletes the caches of all GC content classes
     }
 }
 
@@ -286,6 +282,8 @@ void UtrModel::init() {
       GCtataMotif = new Motif[Constant::decomp_num_steps];
     if (!GCttsMotif)
       GCttsMotif = new Motif[Constant::decomp_num_steps];
+    if (!GCcache)
+      GCcache = new UtrGCCache[Constant::decomp_num_steps];
 }
 
 
@@ -735,37 +733,47 @@ void UtrModel::readAllParameters(){
   }
 }
 
+/*
+ * UtrGCCache::clear
+ */
+void UtrGCCache::clear() {
+    delete initSnippetProbs5;
+    delete snippetProbs5;
+    delete rInitSnippetProbs5;
+    delete rSnippetProbs5;
+    delete rSnippetProbs3;
+    delete intronSnippetProbs;
+    initSnippetProbs5 = snippetProbs5 = rInitSnippetProbs5 = rSnippetProbs5 = rSnippetProbs3 = intronSnippetProbs = NULL;
+    tssProbsPlus.clear();
+    tssProbsMinus.clear();
+    ttsProbPlus.clear();
+    ttsProbMinus.clear();
+    for (int t=0; t<3; t++)
+	for (int r=0; r<2; r++)
+	    cumEmiProbs[t][r].clear();
+}
+
 /*
  * UtrModel::initSnippetProbs
+ * Forget the snippet probabilities and the tss and tts probabilities of all GC content classes.
+ * They are computed again on demand for the current sequence (see useGCPars).
  */
 void UtrModel::initSnippetProbs() {
-    if (initSnippetProbs5)
-	delete initSnippetProbs5;
-    if (snippetProbs5) 
-	delete snippetProbs5;
-    if (rInitSnippetProbs5)
-	delete rInitSnippetProbs5;
-    if (rSnippetProbs5)
-	delete rSnippetProbs5;
-    if (rSnippetProbs3)
-	delete rSnippetProbs3;
-    if (intronSnippetProbs)
-	delete intronSnippetProbs;
-
-    initSnippetProbs5 = new SnippetProbs(sequence, k);
-    snippetProbs5 = new SnippetProbs(sequence, k);
-    rInitSnippetProbs5 = new SnippetProbs(sequence, k, false);
-    rSnippetProbs5 = new SnippetProbs(sequence, k, false);
-    rSnippetProbs3 = new SnippetProbs(sequence, k, false);
-    intronSnippetProbs = new SnippetProbs(sequence, IntronModel::k);
+    if (GCcache)
+	for (int idx = 0; idx < Constant::decomp_num_steps; idx++)
+	    GCcache[idx].clear();
+    initSnippetProbs5 = snippetProbs5 = rInitSnippetProbs5 = rSnippetProbs5 = rSnippetProbs3 = intronSnippetProbs = NULL;
+    tssProbsPlus = tssProbsMinus = ttsProbPlus = ttsProbMinus = NULL;
+    for (int t=0; t<3; t++)
+	cumEmiProbs[t][0] = cumEmiProbs[t][1] = NULL;
     haveSnippetProbs = true;
 }
 
 /*
  * UtrModel::initAlgorithms
  *
- * makes a correction on the transition matrix "trans" and the vector of ancestors
- * this is called after initViterbiAlgorithms
+ * reads the UTR intron self transitions from the transition matrix "trans"
+ * of the current GC content class
  */
 void UtrModel::initAlgorithms( Matrix<Double>& trans, int cur){
     if (utype == utr5intron)
@@ -777,42 +785,66 @@ void UtrModel::initAlgorithms( Matrix<Double>& trans, int cur){
     if (utype == rutr3intron)
 	prUtr3Intron = trans[cur][cur].doubleValue();;
 
-    if (!initAlgorithmsCalled) {
+}
+
+/*
+ * UtrModel::useGCPars
+ *
+ * switch to the parameters of the GC content index gcIdx. The snippet probabilities
+ * and the tss and tts probabilities are computed only on the first use of a
+ * GC content class for the current sequence.
+ */
+void UtrModel::useGCPars(){
+    if (!haveGCPars) {
       // assign GC content dependent variables to the stored values corresponding to GC content
-      utr5init_emiprobs = GCutr5init_emiprobs[gcIdx];
-      utr5_emiprobs = GCutr5_emiprobs[gcIdx];
-      utr3_emiprobs = GCutr3_emiprobs[gcIdx];
-      tssup_emiprobs = GCtssup_emiprobs[gcIdx];
+      curUtr5init_emiprobs = &GCutr5init_emiprobs[gcIdx];
+      curUtr5_emiprobs = &GCutr5_emiprobs[gcIdx];
+      curUtr3_emiprobs = &GCutr3_emiprobs[gcIdx];
+      curTssup_emiprobs = &GCtssup_emiprobs[gcIdx];
       tssMotif = &GCtssMotif[gcIdx];
       ttsMotif = &GCttsMotif[gcIdx];
       tssMotifTATA = &GCtssMotifTATA[gcIdx];
       tataMotif = &GCtataMotif[gcIdx];
-      
 
       seqProb(-1,-1, false, -1);
-      if (tssProbsPlus.size() != dnalen+1){
-	tssProbsPlus.assign(dnalen+1, -1.0);
-	tssProbsMinus.assign(dnalen+1, -1.0);
-      } 
-      for (int i=0; i <= dnalen; i++)
-	tssProbsPlus[i] = tssProbsMinus[i] = -1.0;
-      if (ttsProbPlus)
-	delete [] ttsProbPlus;
-      ttsProbPlus = new Double[dnalen+1];
-      if (ttsProbMinus)
-	delete [] ttsProbMinus;
-      ttsProbMinus = new Double[dnalen+1];
-      computeTtsProbs();
-      
-      initSnippetProbs5->setEmiProbs(&utr5init_emiprobs.probs);
-      snippetProbs5->setEmiProbs(&utr5_emiprobs.probs);
-      rInitSnippetProbs5->setEmiProbs(&utr5init_emiprobs.probs);
-      rSnippetProbs5->setEmiProbs(&utr5_emiprobs.probs);
-      rSnippetProbs3->setEmiProbs(&utr3_emiprobs.probs);
-      intronSnippetProbs->setEmiProbs(&IntronModel::emiprobs.probs);
+      UtrGCCache &c = GCcache[gcIdx];
+      bool firstUse = c.empty();
+      if (firstUse) {
+	c.initSnippetProbs5 = new SnippetProbs(sequence, k);
+	c.initSnippetProbs5->setEmiProbs(&GCutr5init_emiprobs[gcIdx].probs);
+	c.snippetProbs5 = new SnippetProbs(sequence, k);
+	c.snippetProbs5->setEmiProbs(&GCutr5_emiprobs[gcIdx].probs);
+	c.rInitSnippetProbs5 = new SnippetProbs(sequence, k, false);
+	c.rInitSnippetProbs5->setEmiProbs(&GCutr5init_emiprobs[gcIdx].probs);
+	c.rSnippetProbs5 = new SnippetProbs(sequence, k, false);
+	c.rSnippetProbs5->setEmiProbs(&GCutr5_emiprobs[gcIdx].probs);
+	c.rSnippetProbs3 = new SnippetProbs(sequence, k, false);
+	c.rSnippetProbs3->setEmiProbs(&GCutr3_emiprobs[gcIdx].probs);
+	c.intronSnippetProbs = new SnippetProbs(sequence, IntronModel::k);
+	c.intronSnippetProbs->setEmiProbs(&IntronModel::GCemiprobs[gcIdx].probs);
+	c.tssProbsPlus.assign(dnalen+1, -1.0);
+	c.tssProbsMinus.assign(dnalen+1, -1.0);
+	c.ttsProbPlus.resize(dnalen+1);
+	c.ttsProbMinus.resize(dnalen+1);
+	computeCumEmiProbs(c);
+      }
+      initSnippetProbs5 = c.initSnippetProbs5;
+      snippetProbs5 = c.snippetProbs5;
+      rInitSnippetProbs5 = c.rInitSnippetProbs5;
+      rSnippetProbs5 = c.rSnippetProbs5;
+      rSnippetProbs3 = c.rSnippetProbs3;
+      intronSnippetProbs = c.intronSnippetProbs;
+      tssProbsPlus = &c.tssProbsPlus[0];
+      tssProbsMinus = &c.tssProbsMinus[0];
+      ttsProbPlus = &c.ttsProbPlus[0];
+      ttsProbMinus = &c.ttsProbMinus[0];
+      for (int t=0; t<3; t++)
+	for (int r=0; r<2; r++)
+	  cumEmiProbs[t][r] = &c.cumEmiProbs[t][r][0];
+      if (firstUse)
+	computeTtsProbs();
     }
-    initAlgorithmsCalled = true;
-    haveSnippetProbs = false;
+    haveGCPars = true;
 }
 
 /*
@@ -831,6 +863,7 @@ void UtrModel::viterbiForwardAndSampling( ViterbiMatrixType& viterbi,
    *  predProb   |         notEndPartProb                 | endPartProb  |
    *              <--------------------- lenPartProb -------------------->
    */ 
+    OptionsList samplingOptions;
     OptionsList *optionslist = NULL;
     Feature* extrinsicexons = NULL;
     int endOfPred, leftMostEndOfPred, rightMostEndOfPred, beginOfEndPart, endOfBioExon;
@@ -841,7 +874,7 @@ void UtrModel::viterbiForwardAndSampling( ViterbiMatrixType& viterbi,
     maxPredProb = fwdsum = 0.0;
     extrinsicQuot = 1.0;
     if (algovar==doSampling)
-	optionslist = new OptionsList();
+	optionslist = &samplingOptions;
     
     getEndPositions(base, beginOfEndPart, endOfBioExon);
     switch (utype) {
@@ -983,8 +1016,8 @@ void UtrModel::viterbiForwardAndSampling( ViterbiMatrixType& viterbi,
 	    /*
 	     * check whether the starting position has a positive entry at all
 	     */
-	    for (it = ancestor.begin(); it != ancestor.end() && predVit[it->pos]==0; ++it);
-	    if (it == ancestor.end()) continue;
+	    for (it = ancestor->begin(); it != ancestor->end() && predVit[it->pos]==0; ++it);
+	    if (it == ancestor->end()) continue;
 	    notEndPartProb = notEndPartEmiProb(endOfPred+1, beginOfEndPart-1, endOfBioExon, extrinsicexons);
 	    if (notEndPartProb <= 0.0) continue;
 	    emiProb = notEndPartProb * endPartProb;
@@ -1006,7 +1039,7 @@ void UtrModel::viterbiForwardAndSampling( ViterbiMatrixType& viterbi,
 		    oli.state = it->pos;
 		    oli.base = endOfPred;
 		}
-	    } while (++it != ancestor.end());
+	    } while (++it != ancestor->end());
 	}
     } else if (seqFeatColl){
 	/*
@@ -1039,7 +1072,7 @@ void UtrModel::viterbiForwardAndSampling( ViterbiMatrixType& viterbi,
 	    else 
 		extrinsicQuot = ihint->bonus;
 	    emiProb *= extrinsicQuot; // option gets a bonus because it complies with the intron hint
-	    for( it = ancestor.begin(); it != ancestor.end(); ++it ){
+	    for( it = ancestor->begin(); it != ancestor->end(); ++it ){
 		transEmiProb = it->val * emiProb;
 		predProb = predVit[it->pos] * transEmiProb;
 		if (needForwardTable(algovar)) {
@@ -1069,7 +1102,6 @@ void UtrModel::viterbiForwardAndSampling( ViterbiMatrixType& viterbi,
 		cerr << "Sampling error in UTR model. state=" << state << " base=" << base << endl;
 		throw e;
 	    }
-	    delete optionslist;
 	    return;
 	case doViterbiAndForward:
 	    if (fwdsum > 0)
@@ -1271,7 +1303,7 @@ Double UtrModel::notEndPartEmiProb(int begin, int endOfMiddle, int endOfBioExon,
 	    for (int pos = begin; pos <= endOfMiddle; pos++)
 		if (pos-k >= 0)
 		    try {
-			middlePartProb *= IntronModel::emiprobs.probs[s2i_intron(sequence + pos - k)]; // strand does not matter!
+			middlePartProb *= IntronModel::curEmiTable[s2i_intron(sequence + pos - k)]; // strand does not matter!
 		    } catch (InvalidNucleotideError e) {
 			middlePartProb *= 0.25;
 		    }
@@ -1394,7 +1426,7 @@ Double UtrModel::notEndPartEmiProb(int begin, int endOfMiddle, int endOfBioExon,
 	    for (int pos = begin; pos <= endOfMiddle; pos++)
 		if (pos-k >= 0)
 		    try {
-			middlePartProb = IntronModel::emiprobs.probs[s2i_intron(sequence + pos - k)]; // strand does not matter!
+			middlePartProb = IntronModel::curEmiTable[s2i_intron(sequence + pos - k)]; // strand does not matter!
 		    } catch (InvalidNucleotideError e) {
 			middlePartProb = 0.25;
 		    }
@@ -1678,6 +1710,8 @@ Double UtrModel::seqProb(int left, int right, bool reverse, int type) const {
 	seqProb = rSnippetProbs3->getSeqProb(right, right-left+1);
 	return seqProb;
     }
+    if (type >= 0 && type < 3 && left >= 0 && right < dnalen && !inCRFTraining)
+	return cumEmiProbs[type][reverse][right+1] / cumEmiProbs[type][reverse][left];
 
     //  if (utype == rutr5internal)
 //	return rSnippetProbs->getSeqProb(right, right-left+1);
@@ -1689,13 +1723,13 @@ Double UtrModel::seqProb(int left, int right, bool reverse, int type) const {
 		else {
 		    pn = reverse? s2i.rc(sequence+curpos) : s2i(sequence+curpos-k);
 		    if (type == 0){
-		      seqProb *= utr5init_emiprobs.probs[pn];
+		      seqProb *= curUtr5init_emiprobs->probs[pn];
 		    } else if (type == 1){
-			seqProb *= utr5_emiprobs.probs[pn];
+			seqProb *= curUtr5_emiprobs->probs[pn];
 		    } else if (type == 2) {
-			seqProb *= utr3_emiprobs.probs[pn];
+			seqProb *= curUtr3_emiprobs->probs[pn];
 		    } else {
-			seqProb *= IntronModel::emiprobs.probs[pn]; //for testing purposes
+			seqProb *= IntronModel::curEmiTable[pn]; //for testing purposes
 		    }
 		}
 	    } catch (InvalidNucleotideError e) {
@@ -1715,13 +1749,13 @@ Double UtrModel::seqProb(int left, int right, bool reverse, int type) const {
 	    else {
 		pn = reverse? s2i.rc(sequence+curpos) : s2i(sequence+curpos-k);
 		if (type == 0)
-		    seqProb *= utr5init_emiprobs.probs[pn];
+		    seqProb *= curUtr5init_emiprobs->probs[pn];
 		else if (type == 1)
-		    seqProb *= utr5_emiprobs.probs[pn];
+		    seqProb *= curUtr5_emiprobs->probs[pn];
 		else if (type == 2)
-		    seqProb *= utr3_emiprobs.probs[pn];
+		    seqProb *= curUtr3_emiprobs->probs[pn];
 		else
-		    seqProb *= IntronModel::emiprobs.probs[pn]; //for testing purposes
+		    seqProb *= IntronModel::curEmiTable[pn]; //for testing purposes
 		if (inCRFTraining && (countEnd < 0 || (curpos >= countStart && curpos <= countEnd))){
 		  if (type == 0)
 		    GCutr5init_emiprobs[gcIdx].addCount(pn);
@@ -1744,6 +1778,41 @@ Double UtrModel::seqProb(int left, int right, bool reverse, int type) const {
     return seqProb;
 }
 
+/*
+ * UtrModel::computeCumEmiProbs
+ * Precompute for each of the 3 UTR content models and both strands the products
+ * c[i] of the emission probabilities of the positions 0,...,i-1, so that the
+ * emission probability of any segment left..right is c[right+1]/c[left].
+ */
+void UtrModel::computeCumEmiProbs(UtrGCCache &c){
+    const vector<Double> *probs[3] = {&GCutr5init_emiprobs[gcIdx].probs, &GCutr5_emiprobs[gcIdx].probs,
+				      &GCutr3_emiprobs[gcIdx].probs};
+    Seq2Int s2i(k+1);
+    // pattern indices of the positions, -1 for undefined patterns
+    vector<int> fpn(dnalen, -1), rpn(dnalen, -1);
+    for (int pos = 0; pos < dnalen; pos++) {
+	try {
+	    if (pos-k >= 0)
+		fpn[pos] = s2i(sequence+pos-k);
+	} catch (InvalidNucleotideError &) {}
+	try {
+	    if (pos+k < dnalen)
+		rpn[pos] = s2i.rc(sequence+pos);
+	} catch (InvalidNucleotideError &) {}
+    }
+    for (int t=0; t<3; t++){
+	const vector<Double> &p = *probs[t];
+	for (int r=0; r<2; r++){
+	    const vector<int> &pn = r? rpn : fpn;
+	    vector<Double> &cum = c.cumEmiProbs[t][r];
+	    cum.resize(dnalen+1);
+	    cum[0] = 1.0;
+	    for (int pos = 0; pos < dnalen; pos++)
+		cum[pos+1] = cum[pos] * (pn[pos] >= 0 ? p[pn[pos]] : Double(0.25));
+	}
+    }
+}
+
 Double UtrModel::tssupSeqProb (int left, int right, bool reverse) const {
     static Double seqProb;
     static int curpos;
@@ -1753,9 +1822,9 @@ Double UtrModel::tssupSeqProb (int left, int right, bool reverse) const {
     for (curpos = right; curpos >= left; curpos--) {
 	try {
 	    if (!reverse && curpos-tssup_k >= 0)
-		seqProb *= tssup_emiprobs[s2i(sequence+curpos-tssup_k)];
+		seqProb *= (*curTssup_emiprobs)[s2i(sequence+curpos-tssup_k)];
 	    else if (reverse && curpos >= 0 && curpos + tssup_k < dnalen)
-		seqProb *= tssup_emiprobs[s2i.rc(sequence+curpos)];
+		seqProb *= (*curTssup_emiprobs)[s2i.rc(sequence+curpos)];
 	    else 
 		seqProb *= 0.25;
 	} catch (InvalidNucleotideError e) {
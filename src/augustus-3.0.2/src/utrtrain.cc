@@ -28,6 +28,9 @@
 #include <iomanip>
 #include <sstream>
 
+// registers the UTR sequences for counting the patterns, see PatternCounter
+static PatternCounter patternCounter;
+
 
 /*
  * UtrModel::buildModel
@@ -129,6 +132,7 @@ void UtrModel::buildProbabilities(const AnnoSequence* annoseq){
 	  }*/
 	as = as->next;
     }
+    patternCounter.count();
     
     /*
      * determine emission probabilities
@@ -199,6 +203,7 @@ void UtrModel::buildTSSModel(const AnnoSequence* annoseq){
     }
     annoseq = annoseq->next;
   }
+  patternCounter.count();
   /*
    * determine emission probabilities of tss_upwindow
    */
@@ -786,56 +791,28 @@ void UtrModel::computeLengthDistributions( ){
  * UtrModel::processSequence
  */
 void UtrModel::process5InitSequence( const char* start, const char* end){
-  Seq2Int s2i(k+1);
-  for( ; start <= end; start++){
-      try {
-	  utr5init_emicount[s2i(start-k)] += gweight;
-	  utr5init_gesbasen += gweight;
-      } catch (InvalidNucleotideError e) {
-      }
-  }
+  patternCounter.add(&utr5init_emicount, &utr5init_gesbasen, start, end, k, gweight);
 }
 
 /*
  * UtrModel::process5Sequence
  */
 void UtrModel::process5Sequence( const char* start, const char* end){
-  Seq2Int s2i(k+1);
-  for( ; start <= end; start++){
-      try {
-	  utr5_emicount[s2i(start-k)] += gweight ;
-	  utr5_gesbasen += gweight;
-      } catch (InvalidNucleotideError e) {
-      }  
-  }
+  patternCounter.add(&utr5_emicount, &utr5_gesbasen, start, end, k, gweight);
 }
 
 /*
  * UtrModel::process3Sequence
  */
 void UtrModel::process3Sequence( const char* start, const char* end){
-  Seq2Int s2i(k+1);
-  for( ; start <= end; start++){
-      try {
-	  utr3_emicount[s2i(start-k)] += gweight ;
-	  utr3_gesbasen += gweight;
-      } catch (InvalidNucleotideError e) {
-      }  
-  }
+  patternCounter.add(&utr3_emicount, &utr3_gesbasen, start, end, k, gweight);
 }
 
 /*
  * UtrModel::processTssupSequence
  */
 void UtrModel::processTssupSequence( const char* start, const char* end){
-  Seq2Int s2i(tssup_k+1);
-  for( ; start <= end; start++){
-    try {
-      tssup_emicount[s2i(start-tssup_k)] += 1 ;
-      tssup_gesbasen += 1;
-    } catch (InvalidNucleotideError e) {
-    }  
-  }
+  patternCounter.add(&tssup_emicount, &tssup_gesbasen, start, end, tssup_k, 1);
 }
 
 /*
@@ -299,7 +299,7 @@ OptionListItem OptionsList::sample() {	if (size() == 0)
     OptionListItem oli;
     Double z = Double((double) rand() / RAND_MAX) * cumprob * 0.99999; // last factor because of computer arithmetic errors
     Double cumsum = 0.0;
-    list<OptionListItem>::iterator it = options.begin();
+    vector<OptionListItem>::iterator it = options.begin();
     bool found = false;
     while (!found && it != options.end()) {
 	cumsum += it->probability;